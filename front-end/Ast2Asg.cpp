@@ -1,13 +1,13 @@
 #include "Ast2Asg.hpp"
-#include <unordered_map>
+#include "Symtbl.hpp"
 
 #define self (*this)
 
 namespace asg
 {
 
-// 符号表，保存当前作用域的所有声明
-struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl *>
+/// Ast2Asg 使用的符号表，构造时成为 Ast2Asg 的当前符号表，析构时恢复
+struct Ast2Asg::Symtbl : asg::Symtbl
 {
     Ast2Asg &m;
     Symtbl *mPrev;
@@ -21,30 +21,15 @@ struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl *>
     {
         m.mSymtbl = mPrev;
     }
-
-    Decl *resolve(const std::string &name);
 };
 
-Decl *Ast2Asg::Symtbl::resolve(const std::string &name)
-{
-    auto iter = find(name);
-    if (iter != end())
-        return iter->second;
-    if (!mPrev)
-    {
-        std::cerr << "can't resolve indentifier \"" << name << "\n" << '\n';
-        ABORT();
-    }
-    return mPrev->resolve(name);
-}
-
 TranslationUnit *Ast2Asg::operator()(ast::TranslationUnitContext *ctx)
 {
     auto ret = make<asg::TranslationUnit>();
     if (ctx == nullptr)
         return ret;
 
-    Symtbl localDecls(self);
+    Symtbl symtbl(self);
 
     for (auto &&i : ctx->externalDeclaration())
     {
@@ -61,7 +46,7 @@ TranslationUnit *Ast2Asg::operator()(ast::TranslationUnitContext *ctx)
             ret->decls.push_back(funcDecl);
 
             // 添加到声明表
-            localDecls[funcDecl->name] = funcDecl;
+            symtbl.declare(funcDecl->name, funcDecl);
         }
 
         else
@@ -112,22 +97,22 @@ Ast2Asg::SpecQual Ast2Asg::operator()(ast::DeclarationSpecifiersContext *ctx)
     return ret;
 }
 
-std::pair<TypeExpr *, std::string> Ast2Asg::operator()(ast::DeclaratorContext *ctx, TypeExpr *sub)
+std::pair<TypeExpr *, Ident> Ast2Asg::operator()(ast::DeclaratorContext *ctx, TypeExpr *sub)
 {
     return self(ctx->directDeclarator(), sub);
 }
 
-static int eval_arrlen(Expr *expr)
+int eval_arrlen(Expr *expr)
 {
-    if (auto p = expr->dcst<IntegerLiteral>())
+    if (auto p = kcst<IntegerLiteral>(expr))
         return p->val;
 
-    if (auto p = expr->dcst<DeclRefExpr>())
+    if (auto p = kcst<DeclRefExpr>(expr))
     {
         if (p->decl == nullptr)
             ABORT();
 
-        auto var = p->decl->dcst<VarDecl>();
+        auto var = kcst<VarDecl>(p->decl);
         if (!var || !var->type->qual.const_)
             ABORT(); // 数组长度必须是编译期常量
 
@@ -144,7 +129,7 @@ static int eval_arrlen(Expr *expr)
         }
     }
 
-    if (auto p = expr->dcst<UnaryExpr>())
+    if (auto p = kcst<UnaryExpr>(expr))
     {
         auto sub = eval_arrlen(p->sub);
 
@@ -161,7 +146,7 @@ static int eval_arrlen(Expr *expr)
         }
     }
 
-    if (auto p = expr->dcst<BinaryExpr>())
+    if (auto p = kcst<BinaryExpr>(expr))
     {
         auto lft = eval_arrlen(p->lft);
         auto rht = eval_arrlen(p->rht);
@@ -179,7 +164,7 @@ static int eval_arrlen(Expr *expr)
         }
     }
 
-    if (auto p = expr->dcst<InitListExpr>())
+    if (auto p = kcst<InitListExpr>(expr))
     {
         if (p->list.empty())
             return 0;
@@ -189,45 +174,33 @@ static int eval_arrlen(Expr *expr)
     ABORT();
 }
 
-std::pair<TypeExpr *, std::string> Ast2Asg::operator()(ast::DirectDeclaratorContext *ctx, TypeExpr *sub)
+std::pair<TypeExpr *, Ident> Ast2Asg::operator()(ast::DirectDeclaratorContext *ctx, TypeExpr *sub)
 {
     if (auto p = ctx->Identifier())
-        return {sub, p->getText()};
+        return {sub, Ident(p->getText())};
 
     if (ctx->LeftBracket())
     {
-        auto arrayType = make<ArrayType>();
-        arrayType->sub = sub;
-
+        std::uint32_t len = ArrayType::kUnLen;
         if (auto p = ctx->assignmentExpression())
-            arrayType->len = eval_arrlen(self(p));
-        else
-            arrayType->len = ArrayType::kUnLen;
+            len = eval_arrlen(self(p));
 
-        return self(ctx->directDeclarator(), arrayType);
+        return self(ctx->directDeclarator(), mTypeCache.array(len, sub));
     }
 
     if (ctx->LeftParen())
     {
         if (auto params = ctx->parameterTypeList())
         {
-            auto funcType = make<FunctionType>();
-            funcType->sub = sub;
-
+            std::vector<const Type *> paramTypes;
             for (auto &&paramDecl : params->parameterList()->parameterDeclaration())
             {
-                auto paramType = make<Type>();
-                funcType->params.push_back(paramType);
-
                 auto sq = self(paramDecl->declarationSpecifiers());
-                paramType->spec = sq.first;
-                paramType->qual = sq.second;
-
                 auto [texp, name] = self(paramDecl->declarator(), nullptr);
-                paramType->texp = texp;
+                paramTypes.push_back(mTypeCache(sq.first, sq.second, texp));
             }
 
-            return self(ctx->directDeclarator(), funcType);
+            return self(ctx->directDeclarator(), mTypeCache.function(sub, std::move(paramTypes)));
         }
         else if (auto idents = ctx->identifierList())
         {
@@ -235,9 +208,7 @@ std::pair<TypeExpr *, std::string> Ast2Asg::operator()(ast::DirectDeclaratorCont
         }
         else
         {
-            auto funcType = make<FunctionType>();
-            funcType->sub = sub;
-            return self(ctx->directDeclarator(), funcType);
+            return self(ctx->directDeclarator(), mTypeCache.function(sub, {}));
         }
 
         ABORT();
@@ -559,9 +530,8 @@ Expr *Ast2Asg::operator()(ast::PrimaryExpressionContext *ctx)
 
     if (auto p = ctx->Identifier())
     {
-        auto name = p->getText();
         auto ret = make<DeclRefExpr>();
-        ret->decl = mSymtbl->resolve(name);
+        ret->decl = mSymtbl->resolve(Ident(p->getText()));
         return ret;
     }
 
@@ -609,7 +579,7 @@ Expr *Ast2Asg::operator()(ast::InitializerContext *ctx)
         {
             // 将初始化列表展平
             auto expr = self(i);
-            if (auto p = expr->dcst<InitListExpr>())
+            if (auto p = kcst<InitListExpr>(expr))
             {
                 for (auto &&sub : p->list)
                     ret->list.push_back(sub);
@@ -659,7 +629,7 @@ CompoundStmt *Ast2Asg::operator()(ast::CompoundStatementContext *ctx)
 
     if (auto p = ctx->blockItemList())
     {
-        Symtbl localDecls(self);
+        Symtbl::Scope localDecls(*mSymtbl);
 
         for (auto &&i : p->blockItem())
         {
@@ -716,11 +686,25 @@ Stmt *Ast2Asg::operator()(ast::IterationStatementContext *ctx)
     {
         auto whileStmt = make<WhileStmt>();
         whileStmt->cond = self(ctx->expression());
-        whileStmt->body = self(ctx->statement());
+        // 循环体内的 break/continue 指向本循环，出了循环体后恢复为外层的循环
+        auto outer = mCurrentIter;
         mCurrentIter = whileStmt;
+        whileStmt->body = self(ctx->statement());
+        mCurrentIter = outer;
         return whileStmt;
     }
 
+    if (ctx->Do())
+    {
+        auto doStmt = make<DoStmt>();
+        auto outer = mCurrentIter;
+        mCurrentIter = doStmt;
+        doStmt->body = self(ctx->statement());
+        mCurrentIter = outer;
+        doStmt->cond = self(ctx->expression());
+        return doStmt;
+    }
+
     ABORT();
 }
 
@@ -777,19 +761,14 @@ FunctionDecl *Ast2Asg::operator()(ast::FunctionDefinitionContext *ctx)
     auto ret = make<FunctionDecl>();
     mCurrentFunc = ret;
 
-    auto type = make<Type>();
-    ret->type = type;
-
     auto sq = self(ctx->declarationSpecifiers());
-    type->spec = sq.first, type->qual = sq.second;
-
     auto [funcType, name] = self(ctx->declarator(), nullptr);
-    type->texp = funcType;
-    ret->name = std::move(name);
+    ret->type = mTypeCache(sq.first, sq.second, funcType);
+    ret->name = name;
 
-    Symtbl localDecls(self);
+    Symtbl::Scope localDecls(*mSymtbl);
     // 函数定义在签名之后就加入符号表，以允许递归调用
-    (*mSymtbl)[ret->name] = ret;
+    mSymtbl->declare(ret->name, ret);
 
     // 每个参数的 declarator 会被解析两次
     // 一次在解析 FunctionDefinitionContext 或 InitDeclaratorContext 时，仅获取结果的 name
@@ -799,16 +778,16 @@ FunctionDecl *Ast2Asg::operator()(ast::FunctionDefinitionContext *ctx)
     {
         auto paramDecls = paramTypeListCtx->parameterList()->parameterDeclaration();
         auto paramDeclIter = paramDecls.begin();
-        for (auto p : funcType->dcst<FunctionType>()->params)
+        for (auto p : kcst<FunctionType>(funcType)->params)
         {
             auto paramDecl = make<VarDecl>();
             ret->params.push_back(paramDecl);
             paramDecl->type = p;
 
             auto [texp, name] = self((*paramDeclIter++)->declarator(), nullptr);
-            paramDecl->name = std::move(name);
+            paramDecl->name = name;
 
-            (*mSymtbl)[paramDecl->name] = paramDecl;
+            mSymtbl->declare(paramDecl->name, paramDecl);
         }
     }
 
@@ -822,17 +801,11 @@ Decl *Ast2Asg::operator()(ast::InitDeclaratorContext *ctx, SpecQual sq)
     auto [texp, name] = self(ctx->declarator(), nullptr);
     Decl *ret;
 
-    if (auto funcType = texp->dcst<FunctionType>())
+    if (auto funcType = kcst<FunctionType>(texp))
     {
         auto fdecl = make<FunctionDecl>();
-        auto type = make<Type>();
-        fdecl->type = type;
-
-        type->spec = sq.first;
-        type->qual = sq.second;
-        type->texp = funcType;
-
-        fdecl->name = std::move(name);
+        fdecl->type = mTypeCache(sq.first, sq.second, funcType);
+        fdecl->name = name;
 
         if (auto paramTypeListCtx = ctx->declarator()->directDeclarator()->parameterTypeList())
         {
@@ -845,7 +818,7 @@ Decl *Ast2Asg::operator()(ast::InitDeclaratorContext *ctx, SpecQual sq)
                 paramDecl->type = p;
 
                 auto [texp, name] = self((*paramDeclIter++)->declarator(), nullptr);
-                paramDecl->name = std::move(name);
+                paramDecl->name = name;
             }
         }
 
@@ -859,13 +832,8 @@ Decl *Ast2Asg::operator()(ast::InitDeclaratorContext *ctx, SpecQual sq)
     else
     {
         auto vdecl = make<VarDecl>();
-        auto type = make<Type>();
-        vdecl->type = type;
-
-        type->spec = sq.first;
-        type->qual = sq.second;
-        type->texp = texp;
-        vdecl->name = std::move(name);
+        vdecl->type = mTypeCache(sq.first, sq.second, texp);
+        vdecl->name = name;
 
         if (auto p = ctx->initializer())
             vdecl->init = self(p);
@@ -876,7 +844,7 @@ Decl *Ast2Asg::operator()(ast::InitDeclaratorContext *ctx, SpecQual sq)
     }
 
     // 这个实现允许符号重复定义，新定义会取代旧定义
-    (*mSymtbl)[ret->name] = ret;
+    mSymtbl->declare(ret->name, ret);
     return ret;
 }
 
@@ -8,12 +8,16 @@ namespace asg
 
 using ast = CParser;
 
+/// 求数组长度表达式的值，表达式只能由整数字面量、整型常量、正负号和加减法组成
+int eval_arrlen(Expr *expr);
+
 class Ast2Asg
 {
   public:
     Obj::Mgr &mMgr;
+    Type::Cache &mTypeCache;
 
-    Ast2Asg(Obj::Mgr &mgr) : mMgr(mgr)
+    Ast2Asg(Obj::Mgr &mgr, Type::Cache &typeCache) : mMgr(mgr), mTypeCache(typeCache)
     {
     }
 
@@ -27,9 +31,9 @@ class Ast2Asg
 
     SpecQual operator()(ast::DeclarationSpecifiersContext *ctx);
 
-    std::pair<TypeExpr *, std::string> operator()(ast::DeclaratorContext *ctx, TypeExpr *sub);
+    std::pair<TypeExpr *, Ident> operator()(ast::DeclaratorContext *ctx, TypeExpr *sub);
 
-    std::pair<TypeExpr *, std::string> operator()(ast::DirectDeclaratorContext *ctx, TypeExpr *sub);
+    std::pair<TypeExpr *, Ident> operator()(ast::DirectDeclaratorContext *ctx, TypeExpr *sub);
 
     //============================================================================
     // 表达式
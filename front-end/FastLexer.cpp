@@ -0,0 +1,867 @@
+#include "FastLexer.hpp"
+#include "antlr/CLexer.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+/// 输入末尾补零的字节数，SIMD 扫描每次读 16 字节，可能越过末尾
+constexpr std::size_t kPadding = 16;
+
+//==============================================================================
+// 字符分类
+//==============================================================================
+
+enum : std::uint8_t
+{
+    kNondigit = 1 << 0, /// [a-zA-Z_]
+    kDigit = 1 << 1,    /// [0-9]
+    kHex = 1 << 2,      /// [0-9a-fA-F]
+    kOct = 1 << 3,      /// [0-7]
+    kBin = 1 << 4,      /// [01]
+};
+
+constexpr std::array<std::uint8_t, 256> make_char_class()
+{
+    std::array<std::uint8_t, 256> ret{};
+    for (int c = 'a'; c <= 'z'; ++c)
+        ret[c] |= kNondigit;
+    for (int c = 'A'; c <= 'Z'; ++c)
+        ret[c] |= kNondigit;
+    ret['_'] |= kNondigit;
+    for (int c = '0'; c <= '9'; ++c)
+        ret[c] |= kDigit | kHex;
+    for (int c = 'a'; c <= 'f'; ++c)
+        ret[c] |= kHex;
+    for (int c = 'A'; c <= 'F'; ++c)
+        ret[c] |= kHex;
+    for (int c = '0'; c <= '7'; ++c)
+        ret[c] |= kOct;
+    ret['0'] |= kBin, ret['1'] |= kBin;
+    return ret;
+}
+
+constexpr auto kCharClass = make_char_class();
+
+bool is(char c, std::uint8_t cls)
+{
+    return kCharClass[std::uint8_t(c)] & cls;
+}
+
+/// 从 \p p 开始连续属于 \p cls 的字节数
+std::size_t span(const char *p, std::uint8_t cls)
+{
+    auto q = p;
+    while (is(*q, cls))
+        ++q;
+    return q - p;
+}
+
+//==============================================================================
+// 关键字的完美哈希
+//==============================================================================
+
+struct Keyword
+{
+    std::string_view text;
+    std::size_t type;
+};
+
+constexpr Keyword kKeywords[] = {
+    {"__extension__", CLexer::T__0},
+    {"__builtin_va_arg", CLexer::T__1},
+    {"__builtin_offsetof", CLexer::T__2},
+    {"__m128", CLexer::T__3},
+    {"__m128d", CLexer::T__4},
+    {"__m128i", CLexer::T__5},
+    {"__typeof__", CLexer::T__6},
+    {"__inline__", CLexer::T__7},
+    {"__stdcall", CLexer::T__8},
+    {"__declspec", CLexer::T__9},
+    {"__cdecl", CLexer::T__10},
+    {"__clrcall", CLexer::T__11},
+    {"__fastcall", CLexer::T__12},
+    {"__thiscall", CLexer::T__13},
+    {"__vectorcall", CLexer::T__14},
+    {"__asm", CLexer::T__15},
+    {"__attribute__", CLexer::T__16},
+    {"__asm__", CLexer::T__17},
+    {"__volatile__", CLexer::T__18},
+    {"auto", CLexer::Auto},
+    {"break", CLexer::Break},
+    {"case", CLexer::Case},
+    {"char", CLexer::Char},
+    {"const", CLexer::Const},
+    {"continue", CLexer::Continue},
+    {"default", CLexer::Default},
+    {"do", CLexer::Do},
+    {"double", CLexer::Double},
+    {"else", CLexer::Else},
+    {"enum", CLexer::Enum},
+    {"extern", CLexer::Extern},
+    {"float", CLexer::Float},
+    {"for", CLexer::For},
+    {"goto", CLexer::Goto},
+    {"if", CLexer::If},
+    {"inline", CLexer::Inline},
+    {"int", CLexer::Int},
+    {"long", CLexer::Long},
+    {"register", CLexer::Register},
+    {"restrict", CLexer::Restrict},
+    {"return", CLexer::Return},
+    {"short", CLexer::Short},
+    {"signed", CLexer::Signed},
+    {"sizeof", CLexer::Sizeof},
+    {"static", CLexer::Static},
+    {"struct", CLexer::Struct},
+    {"switch", CLexer::Switch},
+    {"typedef", CLexer::Typedef},
+    {"union", CLexer::Union},
+    {"unsigned", CLexer::Unsigned},
+    {"void", CLexer::Void},
+    {"volatile", CLexer::Volatile},
+    {"while", CLexer::While},
+    {"_Alignas", CLexer::Alignas},
+    {"_Alignof", CLexer::Alignof},
+    {"_Atomic", CLexer::Atomic},
+    {"_Bool", CLexer::Bool},
+    {"_Complex", CLexer::Complex},
+    {"_Generic", CLexer::Generic},
+    {"_Imaginary", CLexer::Imaginary},
+    {"_Noreturn", CLexer::Noreturn},
+    {"_Static_assert", CLexer::StaticAssert},
+    {"_Thread_local", CLexer::ThreadLocal},
+};
+
+constexpr std::size_t kKeywordMinLen = 2, kKeywordMaxLen = 18;
+
+/**
+ * @brief 关键字的哈希函数，对所有关键字无冲突（由下面的 static_assert 保证）。
+ *
+ * 各字符的系数是离线搜索得到的，只取长度、第 2、3 个字符和最后两个字符，在
+ * 8 位无符号数上运算，结果直接作为 256 项表的下标。
+ */
+constexpr std::uint8_t keyword_hash(const char *s, std::size_t len)
+{
+    return std::uint8_t(len * 249 + std::uint8_t(s[1]) * 183 + std::uint8_t(s[len - 1]) * 94 +
+                        std::uint8_t(s[len - 2]) * 134 + (len > 2 ? std::uint8_t(s[2]) : 0) * 159);
+}
+
+/// 哈希值到 kKeywords 下标加一的映射，0 表示不是关键字
+constexpr std::array<std::uint8_t, 256> make_keyword_table()
+{
+    std::array<std::uint8_t, 256> ret{};
+    for (std::size_t i = 0; i < std::size(kKeywords); ++i)
+        ret[keyword_hash(kKeywords[i].text.data(), kKeywords[i].text.size())] = i + 1;
+    return ret;
+}
+
+constexpr auto kKeywordTable = make_keyword_table();
+
+constexpr bool keyword_hash_is_perfect()
+{
+    for (std::size_t i = 0; i < std::size(kKeywords); ++i)
+    {
+        auto &kw = kKeywords[i];
+        if (kw.text.size() < kKeywordMinLen || kw.text.size() > kKeywordMaxLen)
+            return false;
+        if (kKeywordTable[keyword_hash(kw.text.data(), kw.text.size())] != i + 1)
+            return false;
+    }
+    return true;
+}
+
+static_assert(keyword_hash_is_perfect(), "关键字哈希有冲突，需要重新搜索系数");
+
+std::size_t keyword_or_identifier(const char *s, std::size_t len)
+{
+    if (len < kKeywordMinLen || len > kKeywordMaxLen)
+        return CLexer::Identifier;
+    auto i = kKeywordTable[keyword_hash(s, len)];
+    if (i != 0 && kKeywords[i - 1].text == std::string_view(s, len))
+        return kKeywords[i - 1].type;
+    return CLexer::Identifier;
+}
+
+//==============================================================================
+// SIMD 扫描，都依赖输入末尾的补零，可以越过 end 读取
+//==============================================================================
+
+/// 找第一个等于 Cs 之一的字节，找不到时返回 \p end
+template <char... Cs> const char *find_any(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    for (; p < end; p += 16)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto eq = _mm_setzero_si128();
+        ((eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, _mm_set1_epi8(Cs)))), ...);
+        if (auto m = _mm_movemask_epi8(eq))
+            return std::min(p + __builtin_ctz(m), end);
+    }
+    return end;
+#else
+    while (p < end && ((*p != Cs) && ...))
+        ++p;
+    return p;
+#endif
+}
+
+/// 找第一对相邻的 A B，返回 A 的位置，找不到时返回 \p end
+template <char A, char B> const char *find_pair(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    for (; p < end; p += 16)
+    {
+        auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+        auto eq = _mm_and_si128(_mm_cmpeq_epi8(v0, _mm_set1_epi8(A)), _mm_cmpeq_epi8(v1, _mm_set1_epi8(B)));
+        if (auto m = _mm_movemask_epi8(eq))
+            return std::min(p + __builtin_ctz(m), end);
+    }
+    return end;
+#else
+    while (p < end && !(p[0] == A && p[1] == B))
+        ++p;
+    return p;
+#endif
+}
+
+/// 跳过空格和制表符
+const char *skip_blanks(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    for (; p < end; p += 16)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto eq = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+        auto m = _mm_movemask_epi8(eq);
+        if (m != 0xFFFF)
+            return std::min(p + __builtin_ctz(~m), end);
+    }
+    return end;
+#else
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    return p;
+#endif
+}
+
+//==============================================================================
+// 词法规则的片段，返回匹配的长度，不匹配时返回 0
+//==============================================================================
+
+/// UniversalCharacterName
+std::size_t match_ucn(const char *p)
+{
+    if (p[0] != '\\')
+        return 0;
+    if (p[1] == 'u')
+        return span(p + 2, kHex) >= 4 ? 6 : 0;
+    if (p[1] == 'U')
+        return span(p + 2, kHex) >= 8 ? 10 : 0;
+    return 0;
+}
+
+/// EscapeSequence
+std::size_t match_escape(const char *p)
+{
+    if (p[0] != '\\')
+        return 0;
+    switch (p[1])
+    {
+    case '\'':
+    case '"':
+    case '?':
+    case 'a':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+    case 'v':
+    case '\\':
+        return 2;
+
+    case 'x': {
+        auto n = span(p + 2, kHex);
+        return n ? 2 + n : 0;
+    }
+
+    case 'u':
+    case 'U':
+        return match_ucn(p);
+
+    default:
+        if (!is(p[1], kOct))
+            return 0;
+        if (!is(p[2], kOct))
+            return 2;
+        return is(p[3], kOct) ? 4 : 3;
+    }
+}
+
+/// IntegerSuffix
+std::size_t match_int_suffix(const char *p)
+{
+    auto ll = (p[0] == 'l' && p[1] == 'l') || (p[0] == 'L' && p[1] == 'L');
+    if (p[0] == 'u' || p[0] == 'U')
+    {
+        if ((p[1] == 'l' && p[2] == 'l') || (p[1] == 'L' && p[2] == 'L'))
+            return 3;
+        return p[1] == 'l' || p[1] == 'L' ? 2 : 1;
+    }
+    if (ll)
+        return p[2] == 'u' || p[2] == 'U' ? 3 : 2;
+    if (p[0] == 'l' || p[0] == 'L')
+        return p[1] == 'u' || p[1] == 'U' ? 2 : 1;
+    return 0;
+}
+
+/// ExponentPart 或 BinaryExponentPart，\p e 是小写的指数字母
+std::size_t match_exponent(const char *p, char e)
+{
+    if (p[0] != e && p[0] != e - 'a' + 'A')
+        return 0;
+    std::size_t sign = p[1] == '+' || p[1] == '-';
+    auto n = span(p + 1 + sign, kDigit);
+    return n ? 1 + sign + n : 0;
+}
+
+std::size_t match_float_suffix(const char *p)
+{
+    return p[0] == 'f' || p[0] == 'l' || p[0] == 'F' || p[0] == 'L';
+}
+
+/// 小数部分：D? '.' D | D '.'，\p cls 是数字的种类
+std::size_t match_fraction(const char *p, std::uint8_t cls)
+{
+    auto d1 = span(p, cls);
+    if (p[d1] != '.')
+        return 0;
+    auto d2 = span(p + d1 + 1, cls);
+    return d1 || d2 ? d1 + 1 + d2 : 0;
+}
+
+/// DecimalFloatingConstant
+std::size_t match_dec_float(const char *p)
+{
+    if (auto n = match_fraction(p, kDigit))
+    {
+        n += match_exponent(p + n, 'e');
+        return n + match_float_suffix(p + n);
+    }
+    auto d = span(p, kDigit);
+    if (d == 0)
+        return 0;
+    auto e = match_exponent(p + d, 'e');
+    if (e == 0)
+        return 0;
+    return d + e + match_float_suffix(p + d + e);
+}
+
+/// HexadecimalFloatingConstant，\p p 指向 "0x"
+std::size_t match_hex_float(const char *p)
+{
+    auto n = match_fraction(p + 2, kHex);
+    if (n == 0)
+        n = span(p + 2, kHex);
+    if (n == 0)
+        return 0;
+    auto e = match_exponent(p + 2 + n, 'p');
+    if (e == 0)
+        return 0;
+    return 2 + n + e + match_float_suffix(p + 2 + n + e);
+}
+
+} // namespace
+
+//==============================================================================
+// FastLexer
+//==============================================================================
+
+FastLexer::FastLexer(std::string_view text, std::string sourceName) : mSourceName(std::move(sourceName))
+{
+    mText.reserve(text.size() + kPadding);
+    mText.append(text).append(kPadding, '\0');
+    mBegin = mCur = mText.data();
+    mEnd = mBegin + text.size();
+}
+
+antlr4::TokenFactory<antlr4::CommonToken> *FastLexer::getTokenFactory()
+{
+    return antlr4::CommonTokenFactory::DEFAULT.get();
+}
+
+std::unique_ptr<antlr4::CommonToken> FastLexer::emit(size_t type, const char *end, bool hidden)
+{
+    // 构造时会从 this 取得当前的行号和列号
+    auto token = std::make_unique<antlr4::CommonToken>(
+        std::pair<antlr4::TokenSource *, antlr4::CharStream *>(this, nullptr), type,
+        hidden ? antlr4::Token::HIDDEN_CHANNEL : antlr4::Token::DEFAULT_CHANNEL, mCur - mBegin, end - mBegin - 1);
+    token->setText(std::string(mCur, end));
+    return token;
+}
+
+void FastLexer::advance(const char *end)
+{
+    auto p = mCur;
+
+    // 先数换行，找到最后一个换行的位置
+    std::size_t lines = 0;
+    const char *lastNl = nullptr;
+#ifdef __SSE2__
+    for (auto q = p; q < end; q += 16)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (end - q < 16)
+            m &= (1u << (end - q)) - 1;
+        if (m)
+            lines += __builtin_popcount(m), lastNl = q + 31 - __builtin_clz(m);
+    }
+#else
+    for (auto q = p; q < end; ++q)
+        if (*q == '\n')
+            ++lines, lastNl = q;
+#endif
+    if (lastNl)
+        mLine += lines, mCol = 0, p = lastNl + 1;
+
+    // 再按 UTF-8 码点数列号，即不计 10xxxxxx 形式的后续字节
+    std::size_t cont = 0;
+#ifdef __SSE2__
+    for (auto q = p; q < end; q += 16)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+        unsigned m = _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(-64)));
+        if (end - q < 16)
+            m &= (1u << (end - q)) - 1;
+        cont += __builtin_popcount(m);
+    }
+#else
+    for (auto q = p; q < end; ++q)
+        cont += (*q & 0xC0) == 0x80;
+#endif
+    mCol += (end - p) - cont;
+}
+
+std::size_t FastLexer::match_identifier(const char *p) const
+{
+    auto q = p;
+    while (q < mEnd)
+    {
+        if (is(*q, kNondigit | kDigit))
+            ++q;
+        else if (auto n = match_ucn(q))
+            q += n;
+        else
+            break;
+    }
+    return q - p;
+}
+
+std::size_t FastLexer::match_number(const char *p, size_t &type) const
+{
+    std::size_t len = 0;
+
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    {
+        if (auto n = span(p + 2, kHex))
+            len = 2 + n + match_int_suffix(p + 2 + n);
+        len = std::max(len, match_hex_float(p));
+    }
+    else if (p[0] == '0' && (p[1] == 'b' || p[1] == 'B'))
+    {
+        if (auto n = span(p + 2, kBin))
+            len = 2 + n;
+    }
+
+    auto digits = span(p, kDigit);
+    if (p[0] == '0')
+    {
+        auto n = 1 + span(p + 1, kOct);
+        len = std::max(len, n + match_int_suffix(p + n));
+    }
+    else if (digits)
+        len = std::max(len, digits + match_int_suffix(p + digits));
+
+    len = std::max(len, match_dec_float(p));
+
+    // 最长匹配，等长时 Constant 优先于 DigitSequence，比如 "089" 是 DigitSequence
+    if (digits > len)
+    {
+        type = CLexer::DigitSequence;
+        return digits;
+    }
+    type = CLexer::Constant;
+    return len;
+}
+
+std::size_t FastLexer::match_char(const char *p) const
+{
+    auto q = p + 1;
+    while (*q != '\'')
+    {
+        if (q >= mEnd || *q == '\r' || *q == '\n')
+            return 0;
+        if (*q == '\\')
+        {
+            auto n = match_escape(q);
+            if (n == 0)
+                return 0;
+            q += n;
+        }
+        else
+            ++q;
+    }
+    if (q == p + 1)
+        return 0;
+    return q + 1 - p;
+}
+
+std::size_t FastLexer::match_string(const char *p) const
+{
+    auto q = p + 1;
+    while (true)
+    {
+        q = find_any<'"', '\\', '\r', '\n'>(q, mEnd);
+        if (q == mEnd || *q == '\r' || *q == '\n')
+            return 0;
+        if (*q == '"')
+            return q + 1 - p;
+
+        // 反斜杠续行或转义
+        if (q[1] == '\n')
+            q += 2;
+        else if (q[1] == '\r' && q[2] == '\n')
+            q += 3;
+        else if (auto n = match_escape(q))
+            q += n;
+        else
+            return 0;
+    }
+}
+
+std::size_t FastLexer::match_directive(const char *p, size_t &type) const
+{
+    type = CLexer::Directive;
+    auto nl = find_any<'\n'>(p + 1, mEnd);
+    auto end = nl;
+
+    // 以反斜杠续行、且下一行非空时，是跨行的 MultiLineMacro
+    while (nl < mEnd)
+    {
+        auto q = nl[-1] == '\r' ? nl - 1 : nl;
+        if (q[-1] != '\\' || q - 1 == p || nl + 1 == mEnd || nl[1] == '\n')
+            break;
+        type = CLexer::MultiLineMacro;
+        nl = find_any<'\n'>(nl + 1, mEnd);
+        end = nl;
+    }
+
+    return end - p;
+}
+
+std::unique_ptr<antlr4::Token> FastLexer::nextToken()
+{
+    while (true)
+    {
+        if (mCur >= mEnd)
+        {
+            auto token = emit(antlr4::Token::EOF, mCur);
+            token->setText("<EOF>");
+            return token;
+        }
+
+        auto p = mCur;
+        size_t type;
+        std::size_t len = 1;
+        bool hidden = false;
+        bool multiline = false; /// 可能跨行或含非 ASCII 字符，需要逐字节计算行列
+
+        switch (*p)
+        {
+        case ' ':
+        case '\t':
+            type = CLexer::Whitespace, hidden = true;
+            len = skip_blanks(p + 1, mEnd) - p;
+            break;
+
+        case '\n':
+            type = CLexer::Newline, hidden = true, multiline = true;
+            break;
+
+        case '\r':
+            type = CLexer::Newline, hidden = true, multiline = true;
+            len = p[1] == '\n' ? 2 : 1;
+            break;
+
+        case '#':
+            len = match_directive(p, type), hidden = true, multiline = true;
+            break;
+
+        case '/':
+            if (p[1] == '/')
+            {
+                type = CLexer::LineComment, hidden = true, multiline = true;
+                len = find_any<'\r', '\n'>(p + 2, mEnd) - p;
+                break;
+            }
+            if (p[1] == '*')
+            {
+                auto q = find_pair<'*', '/'>(p + 2, mEnd);
+                if (q != mEnd)
+                {
+                    type = CLexer::BlockComment, hidden = true, multiline = true;
+                    len = q + 2 - p;
+                    break;
+                }
+            }
+            if (p[1] == '=')
+                type = CLexer::DivAssign, len = 2;
+            else
+                type = CLexer::Div;
+            break;
+
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            len = match_number(p, type);
+            break;
+
+        case '.':
+            if (is(p[1], kDigit))
+                len = match_number(p, type);
+            else if (p[1] == '.' && p[2] == '.')
+                type = CLexer::Ellipsis, len = 3;
+            else
+                type = CLexer::Dot;
+            break;
+
+        case '\'':
+            if ((len = match_char(p)) == 0)
+                goto ERROR;
+            type = CLexer::Constant, multiline = true;
+            break;
+
+        case '"':
+            if ((len = match_string(p)) == 0)
+                goto ERROR;
+            type = CLexer::StringLiteral, multiline = true;
+            break;
+
+        case '(':
+            type = CLexer::LeftParen;
+            break;
+
+        case ')':
+            type = CLexer::RightParen;
+            break;
+
+        case '[':
+            type = CLexer::LeftBracket;
+            break;
+
+        case ']':
+            type = CLexer::RightBracket;
+            break;
+
+        case '{':
+            type = CLexer::LeftBrace;
+            break;
+
+        case '}':
+            type = CLexer::RightBrace;
+            break;
+
+        case '?':
+            type = CLexer::Question;
+            break;
+
+        case ':':
+            type = CLexer::Colon;
+            break;
+
+        case ';':
+            type = CLexer::Semi;
+            break;
+
+        case ',':
+            type = CLexer::Comma;
+            break;
+
+        case '~':
+            type = CLexer::Tilde;
+            break;
+
+        case '<':
+            if (p[1] == '<')
+                type = p[2] == '=' ? (len = 3, CLexer::LeftShiftAssign) : (len = 2, CLexer::LeftShift);
+            else if (p[1] == '=')
+                type = CLexer::LessEqual, len = 2;
+            else
+                type = CLexer::Less;
+            break;
+
+        case '>':
+            if (p[1] == '>')
+                type = p[2] == '=' ? (len = 3, CLexer::RightShiftAssign) : (len = 2, CLexer::RightShift);
+            else if (p[1] == '=')
+                type = CLexer::GreaterEqual, len = 2;
+            else
+                type = CLexer::Greater;
+            break;
+
+        case '+':
+            if (p[1] == '+')
+                type = CLexer::PlusPlus, len = 2;
+            else if (p[1] == '=')
+                type = CLexer::PlusAssign, len = 2;
+            else
+                type = CLexer::Plus;
+            break;
+
+        case '-':
+            if (p[1] == '-')
+                type = CLexer::MinusMinus, len = 2;
+            else if (p[1] == '=')
+                type = CLexer::MinusAssign, len = 2;
+            else if (p[1] == '>')
+                type = CLexer::Arrow, len = 2;
+            else
+                type = CLexer::Minus;
+            break;
+
+        case '*':
+            if (p[1] == '=')
+                type = CLexer::StarAssign, len = 2;
+            else
+                type = CLexer::Star;
+            break;
+
+        case '%':
+            if (p[1] == '=')
+                type = CLexer::ModAssign, len = 2;
+            else
+                type = CLexer::Mod;
+            break;
+
+        case '&':
+            if (p[1] == '&')
+                type = CLexer::AndAnd, len = 2;
+            else if (p[1] == '=')
+                type = CLexer::AndAssign, len = 2;
+            else
+                type = CLexer::And;
+            break;
+
+        case '|':
+            if (p[1] == '|')
+                type = CLexer::OrOr, len = 2;
+            else if (p[1] == '=')
+                type = CLexer::OrAssign, len = 2;
+            else
+                type = CLexer::Or;
+            break;
+
+        case '^':
+            if (p[1] == '=')
+                type = CLexer::XorAssign, len = 2;
+            else
+                type = CLexer::Caret;
+            break;
+
+        case '!':
+            if (p[1] == '=')
+                type = CLexer::NotEqual, len = 2;
+            else
+                type = CLexer::Not;
+            break;
+
+        case '=':
+            if (p[1] == '=')
+                type = CLexer::Equal, len = 2;
+            else
+                type = CLexer::Assign;
+            break;
+
+        default: {
+            if (!is(*p, kNondigit) && match_ucn(p) == 0)
+                goto ERROR;
+
+            len = match_identifier(p);
+
+            // 带编码前缀的字符常量和字符串字面量
+            if ((len == 1 && (*p == 'L' || *p == 'u' || *p == 'U')) || (len == 2 && p[0] == 'u' && p[1] == '8'))
+            {
+                if (len == 1 && p[1] == '\'')
+                {
+                    if (auto n = match_char(p + 1))
+                    {
+                        type = CLexer::Constant, len += n, multiline = true;
+                        break;
+                    }
+                }
+                if (p[len] == '"')
+                {
+                    if (auto n = match_string(p + len))
+                    {
+                        type = CLexer::StringLiteral, len += n, multiline = true;
+                        break;
+                    }
+                }
+            }
+
+            // 以 asm 开头时，只要后面有成对的花括号就是 AsmBlock，它一定比标识符长
+            if (len >= 3 && p[0] == 'a' && p[1] == 's' && p[2] == 'm')
+            {
+                auto lb = find_any<'{'>(p + 3, mEnd);
+                auto rb = lb == mEnd ? mEnd : find_any<'}'>(lb + 1, mEnd);
+                if (rb != mEnd)
+                {
+                    type = CLexer::AsmBlock, len = rb + 1 - p, hidden = true, multiline = true;
+                    break;
+                }
+            }
+
+            type = keyword_or_identifier(p, len);
+        }
+        break;
+        }
+
+        {
+            auto end = p + len;
+            auto token = emit(type, end, hidden);
+            if (multiline)
+                advance(end);
+            else
+                mCol += len;
+            mCur = end;
+            return token;
+        }
+
+    ERROR:
+        // 与 ANTLR 一样报告错误并跳过一个字符（码点）
+        std::cerr << "line " << mLine << ":" << mCol << " token recognition error at: '" << *p << "'" << std::endl;
+        auto end = p + 1;
+        while (end < mEnd && (*end & 0xC0) == 0x80)
+            ++end;
+        advance(end);
+        mCur = end;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "antlr4-runtime.h"
+#include <string_view>
+
+/**
+ * @brief 手写的词法分析器
+ *
+ * 按 C.g4 的词法规则直接用状态机扫描字节，产生与 CLexer 相同的词法单元（类型
+ * 沿用 CLexer 的枚举，隐藏通道也相同），作为 antlr4::TokenSource 接到
+ * CommonTokenStream 上即可替换 CLexer 给 print_tokens_clang 和 CParser 使用。
+ *
+ * 与 CLexer 逐字符运行 ATN 模拟器不同，这里：
+ *   1. 空白、注释、预处理行标记（Directive）等长串用 SIMD 每次比较 16 字节；
+ *   2. 关键字在标识符扫描完后用完美哈希查表，一次比较即可确定；
+ *   3. 其余按最长匹配手工实现，与 ANTLR 的选择保持一致。
+ *
+ * 行号和列号的计法与 ANTLR 相同：只有 '\n' 使行号加一，列号按 UTF-8 码点计数。
+ * 词法单元的 start/stop 是字节偏移，输入含非 ASCII 字符时与 CLexer 的码点偏移
+ * 不同，但不影响文本、行号和列号。
+ */
+class FastLexer : public antlr4::TokenSource
+{
+  public:
+    /// 词法分析 \p text ，内部会复制一份并在末尾补零，以便 SIMD 越界读取
+    FastLexer(std::string_view text, std::string sourceName = "<unknown>");
+
+    std::unique_ptr<antlr4::Token> nextToken() override;
+
+    size_t getLine() const override
+    {
+        return mLine;
+    }
+
+    size_t getCharPositionInLine() override
+    {
+        return mCol;
+    }
+
+    /// 没有对应的字符流，词法单元的文本在创建时就已设好
+    antlr4::CharStream *getInputStream() override
+    {
+        return nullptr;
+    }
+
+    std::string getSourceName() override
+    {
+        return mSourceName;
+    }
+
+    antlr4::TokenFactory<antlr4::CommonToken> *getTokenFactory() override;
+
+  private:
+    std::string mText;
+    const char *mBegin, *mCur, *mEnd;
+    std::string mSourceName;
+
+    size_t mLine{1}; /// 当前行号，从 1 开始
+    size_t mCol{0};  /// 当前列号，从 0 开始
+
+    std::unique_ptr<antlr4::CommonToken> emit(size_t type, const char *end, bool hidden = false);
+
+    /// 把 [mCur, end) 计入行号和列号，用于可能跨行或含非 ASCII 字符的词法单元
+    void advance(const char *end);
+
+    std::size_t match_identifier(const char *p) const;
+    std::size_t match_number(const char *p, size_t &type) const;
+    std::size_t match_char(const char *p) const;
+    std::size_t match_string(const char *p) const;
+    std::size_t match_directive(const char *p, size_t &type) const;
+};
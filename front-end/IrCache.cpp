@@ -0,0 +1,167 @@
+#include "IrCache.hpp"
+#include "asg/AsgHash.hpp"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+
+IrCache::Stats &IrCache::Stats::operator+=(const Stats &other)
+{
+    mHits += other.mHits;
+    mMisses += other.mMisses;
+    mBytesRead += other.mBytesRead;
+    mBytesWritten += other.mBytesWritten;
+    return *this;
+}
+
+bool IrCache::operator()(EmitIR &emitIR, asg::TranslationUnit *tu, llvm::StringRef config,
+                         llvm::function_ref<void(llvm::Module &)> optimize, std::string &err)
+{
+    auto &mod = emitIR.mMod;
+    auto &ctx = mod.getContext();
+
+    auto funcs = emitIR.prototypes(tu);
+    optimize(mod);
+
+    // 链接会替换主模块中的原型，而发射分片时要通过全局声明的 any 判断引用的是
+    // 不是全局值，所以先取得所有函数的模块，再一起链接
+    llvm::sys::fs::create_directories(mDir);
+    asg::AsgHash hash(build_salt() + '\n' + config.str());
+    std::vector<std::unique_ptr<llvm::Module>> mods;
+    for (auto &&i : funcs)
+    {
+        llvm::SmallString<128> path(mDir);
+        llvm::sys::path::append(path, "llvmcache-" + hash(i));
+
+        if (auto buf = load(path))
+        {
+            auto parsed = llvm::parseBitcodeFile(buf->getMemBufferRef(), ctx);
+            if (parsed)
+            {
+                mods.push_back(std::move(*parsed));
+                ++mStats.mHits;
+                mStats.mBytesRead += buf->getBufferSize();
+                continue;
+            }
+            llvm::consumeError(parsed.takeError());
+        }
+
+        ++mStats.mMisses;
+        EmitIR shard(emitIR.mMgr, ctx, i->name.str());
+        shard.mSsa = emitIR.mSsa;
+        shard.mMod.setTargetTriple(mod.getTargetTriple());
+        shard.mMod.setDataLayout(mod.getDataLayout());
+        shard.bodies({i});
+        optimize(shard.mMod);
+
+        // 经由位码读回，得到可以交给 Linker 的模块，与命中时的结果完全相同；
+        // 保留 use-list 的顺序，phi 的前驱等才与不用缓存时一致
+        llvm::SmallVector<char, 0> bitcode;
+        llvm::raw_svector_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(shard.mMod, os, true);
+        llvm::StringRef data(bitcode.data(), bitcode.size());
+        store(path, data);
+
+        auto parsed = llvm::parseBitcodeFile(llvm::MemoryBufferRef(data, path), ctx);
+        if (!parsed)
+        {
+            err = llvm::toString(parsed.takeError());
+            return false;
+        }
+        mods.push_back(std::move(*parsed));
+    }
+
+    // 被分片引用的全局变量在链接时会移到模块末尾，链接后按原来的顺序排回去，
+    // 使输出与不用缓存时逐字节相同
+    std::vector<std::string> globals;
+    for (auto &&i : mod.globals())
+        globals.push_back(i.getName().str());
+
+    llvm::Linker linker(mod);
+    for (std::size_t i = 0; i < funcs.size(); ++i)
+    {
+        if (linker.linkInModule(std::move(mods[i])))
+        {
+            err = "unable to link function: " + std::string(funcs[i]->name.str());
+            return false;
+        }
+    }
+
+    for (auto &&i : globals)
+    {
+        auto gvar = mod.getNamedGlobal(i);
+        mod.removeGlobalVariable(gvar);
+        mod.insertGlobalVariable(gvar);
+    }
+    return true;
+}
+
+bool IrCache::prune()
+{
+    llvm::CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizeBytes = mMaxBytes;
+    return llvm::pruneCache(mDir, policy);
+}
+
+const std::string &IrCache::build_salt()
+{
+    static const std::string salt = []
+    {
+        std::string ret = "sysuc LLVM " LLVM_VERSION_STRING;
+        auto exe = llvm::sys::fs::getMainExecutable(nullptr, reinterpret_cast<void *>(&build_salt));
+        llvm::sys::fs::file_status status;
+        if (!llvm::sys::fs::status(exe, status))
+        {
+            ret += ' ' + std::to_string(status.getSize());
+            ret += ' ' + std::to_string(llvm::sys::toTimeT(status.getLastModificationTime()));
+        }
+        return ret;
+    }();
+    return salt;
+}
+
+std::unique_ptr<llvm::MemoryBuffer> IrCache::load(const llvm::Twine &path)
+{
+    int fd;
+    if (llvm::sys::fs::openFileForRead(path, fd))
+        return nullptr;
+
+    auto buf = llvm::MemoryBuffer::getOpenFile(llvm::sys::fs::convertFDToNativeFile(fd), path, -1);
+    if (buf)
+        llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    return buf ? std::move(*buf) : nullptr;
+}
+
+void IrCache::store(const llvm::Twine &path, llvm::StringRef data)
+{
+    int fd;
+    llvm::SmallString<128> tmp;
+    if (llvm::sys::fs::createUniqueFile(mDir + "/tmp-%%%%%%%%", fd, tmp))
+        return;
+
+    {
+        llvm::raw_fd_ostream os(fd, true);
+        os << data;
+        os.close();
+        if (os.has_error())
+        {
+            os.clear_error();
+            llvm::sys::fs::remove(tmp);
+            return;
+        }
+    }
+
+    if (llvm::sys::fs::rename(tmp, path))
+        llvm::sys::fs::remove(tmp);
+    else
+        mStats.mBytesWritten += data.size();
+}
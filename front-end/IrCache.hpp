@@ -0,0 +1,72 @@
+#pragma once
+
+#include "asg/EmitIR.hpp"
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <string>
+
+/**
+ * @brief 按函数缓存发射并优化后的 IR，供一体化驱动的 -ir-cache 使用
+ *
+ * 每个函数的键是 asg::AsgHash 对类型推导后的函数体、其引用的全局声明的签名，
+ * 以及编译器和配置（优化级别、目标等）的哈希，值是只含这个函数定义的模块的
+ * 位码，存在缓存目录下的 llvmcache-<键> 文件中。命中时直接读回位码，跳过这个
+ * 函数的 EmitIR 和优化；未命中时单独发射、优化并写入缓存。所以缓存只适用于
+ * 逐函数的优化流水线。
+ *
+ * 文件先写到临时文件再改名，多个进程或线程可以同时使用一个缓存目录。命中时
+ * 更新文件的访问时间，prune 按最近访问的顺序保留不超过上限的文件。
+ */
+class IrCache
+{
+  public:
+    struct Stats
+    {
+        std::size_t mHits{0};
+        std::size_t mMisses{0};
+        std::uint64_t mBytesRead{0};
+        std::uint64_t mBytesWritten{0};
+
+        Stats &operator+=(const Stats &other);
+    };
+
+    /// \p dir 为缓存目录，不存在时创建，\p maxBytes 为 prune 后的大小上限
+    IrCache(std::string dir, std::uint64_t maxBytes) : mDir(std::move(dir)), mMaxBytes(maxBytes)
+    {
+    }
+
+    /**
+     * @brief 经由缓存把 \p tu 发射到 \p emitIR 的 mMod 中
+     *
+     * 先用 EmitIR::prototypes 发射函数体以外的全部内容，再逐个函数查找缓存，
+     * 读回或发射后用 llvm::Linker 按源码顺序链接进 mMod，函数体排在所有原型
+     * 之后，与并行发射相同。\p optimize 对主模块和每个未命中的函数的模块各调用
+     * 一次，所以读回的函数已经优化过，不要再优化 mMod。mMod 的目标和数据布局
+     * 须在调用前设置好。\p config 是影响生成代码的其他配置。
+     *
+     * 缓存目录不可用时照常编译，只是不写入缓存。成功时返回真，否则设置 \p err。
+     */
+    bool operator()(EmitIR &emitIR, asg::TranslationUnit *tu, llvm::StringRef config,
+                    llvm::function_ref<void(llvm::Module &)> optimize, std::string &err);
+
+    const Stats &stats() const
+    {
+        return mStats;
+    }
+
+    /// 按最近访问的顺序淘汰文件，直到缓存目录不超过大小上限
+    bool prune();
+
+  private:
+    std::string mDir;
+    std::uint64_t mMaxBytes;
+    Stats mStats;
+
+    /// 编译器本身的标识：LLVM 版本和 sysuc 可执行文件的大小、修改时间
+    static const std::string &build_salt();
+
+    /// 读取缓存文件，未命中时返回空指针
+    std::unique_ptr<llvm::MemoryBuffer> load(const llvm::Twine &path);
+
+    /// 写入缓存文件，失败时忽略
+    void store(const llvm::Twine &path, llvm::StringRef data);
+};
@@ -0,0 +1,37 @@
+#include "Symtbl.hpp"
+#include <iostream>
+
+namespace asg
+{
+
+void Symtbl::declare(Ident name, Decl *decl)
+{
+    auto id = name.id();
+    if (id >= mDecls.size())
+        mDecls.resize(Ident::count() + 1);
+    mUndo.emplace_back(id, mDecls[id]);
+    mDecls[id] = decl;
+}
+
+Decl *Symtbl::resolve(Ident name)
+{
+    auto id = name.id();
+    if (id >= mDecls.size() || mDecls[id] == nullptr)
+    {
+        std::cerr << "can't resolve indentifier \"" << name.str() << "\n" << '\n';
+        ABORT();
+    }
+    return mDecls[id];
+}
+
+void Symtbl::rollback(std::size_t mark)
+{
+    while (mUndo.size() > mark)
+    {
+        auto [id, decl] = mUndo.back();
+        mDecls[id] = decl;
+        mUndo.pop_back();
+    }
+}
+
+} // namespace asg
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "asg/asg.hpp"
+
+namespace asg
+{
+
+/**
+ * 符号表，保存当前可见的所有声明
+ *
+ * 所有作用域共用一张按标识符编号索引的扁平表，查找只需一次下标访问。声明时
+ * 把被遮蔽的旧声明压入撤销日志，离开作用域时按日志逆序恢复，所以进出作用域
+ * 都不需要分配新的表。
+ */
+struct Symtbl
+{
+    std::vector<Decl *> mDecls;                          /// 按标识符编号索引
+    std::vector<std::pair<std::uint32_t, Decl *>> mUndo; /// 撤销日志：编号和被遮蔽的旧声明
+
+    /// 作用域，析构时撤销作用域内的所有声明
+    struct Scope
+    {
+        Symtbl &mSymtbl;
+        std::size_t mMark;
+
+        Scope(Symtbl &symtbl) : mSymtbl(symtbl), mMark(symtbl.mUndo.size())
+        {
+        }
+
+        ~Scope()
+        {
+            mSymtbl.rollback(mMark);
+        }
+    };
+
+    void declare(Ident name, Decl *decl);
+
+    Decl *resolve(Ident name);
+
+  private:
+    void rollback(std::size_t mark);
+};
+
+} // namespace asg
@@ -0,0 +1,141 @@
+#include "TimeReport.hpp"
+
+#include <llvm/Support/Format.h>
+#include <sys/resource.h>
+
+namespace
+{
+
+/// 进程到目前为止的峰值 RSS（KiB）
+long peak_rss()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+} // namespace
+
+void TimeReport::start(llvm::StringRef name)
+{
+    auto [it, inserted] = mIndex.try_emplace(name, mEntries.size());
+    if (inserted)
+    {
+        auto &entry = mEntries.emplace_back();
+        entry.mName = name.str();
+        entry.mDepth = mOpen.size();
+    }
+    mOpen.push_back({it->second, llvm::TimeRecord::getCurrentTime(true), peak_rss()});
+}
+
+void TimeReport::stop()
+{
+    auto time = llvm::TimeRecord::getCurrentTime(false);
+    auto rss = peak_rss();
+    auto open = mOpen.back();
+    mOpen.pop_back();
+
+    auto &entry = mEntries[open.mEntry];
+    time -= open.mBegin;
+    entry.mTime += time;
+    ++entry.mCount;
+    entry.mPeakRss = rss;
+    entry.mRssGrowth += rss - open.mBeginRss;
+}
+
+void TimeReport::instrument(llvm::PassInstrumentationCallbacks &pic)
+{
+    // 跳过 pass 管理器和适配器本身，它们的用时就是其中各个 pass 的合计
+    auto timed = [](llvm::StringRef pass)
+    { return !pass.contains("PassManager") && !pass.contains("PassAdaptor"); };
+
+    pic.registerBeforeNonSkippedPassCallback(
+        [this, timed](llvm::StringRef pass, llvm::Any)
+        {
+            if (timed(pass))
+                start(pass);
+        });
+    pic.registerAfterPassCallback(
+        [this, timed](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses &)
+        {
+            if (timed(pass))
+                stop();
+        });
+    pic.registerAfterPassInvalidatedCallback(
+        [this, timed](llvm::StringRef pass, const llvm::PreservedAnalyses &)
+        {
+            if (timed(pass))
+                stop();
+        });
+}
+
+double TimeReport::total_ms() const
+{
+    double total = 0;
+    for (auto &&i : mEntries)
+        if (i.mDepth == 0)
+            total += i.mTime.getWallTime() * 1e3;
+    return total;
+}
+
+void TimeReport::print(llvm::raw_ostream &os) const
+{
+    constexpr unsigned kNameWidth = 28;
+
+    os << llvm::left_justify("phase", kNameWidth);
+    for (auto head : {"wall ms", "user ms", "sys ms", "peak MiB", "+MiB"})
+        os << ' ' << llvm::right_justify(head, 10);
+    os << ' ' << llvm::right_justify("count", 6) << '\n';
+
+    llvm::TimeRecord total;
+    long peak = 0;
+    for (auto &&i : mEntries)
+    {
+        if (i.mDepth == 0)
+            total += i.mTime;
+        peak = std::max(peak, i.mPeakRss);
+
+        std::string name(2 * i.mDepth, ' ');
+        name += i.mName;
+        os << llvm::left_justify(name, kNameWidth)
+           << llvm::format(" %10.3f %10.3f %10.3f %10.1f %10.1f %6zu\n", i.mTime.getWallTime() * 1e3,
+                           i.mTime.getUserTime() * 1e3, i.mTime.getSystemTime() * 1e3, i.mPeakRss / 1024.0,
+                           i.mRssGrowth / 1024.0, i.mCount);
+    }
+
+    os << llvm::left_justify("total", kNameWidth)
+       << llvm::format(" %10.3f %10.3f %10.3f %10.1f\n", total.getWallTime() * 1e3, total.getUserTime() * 1e3,
+                       total.getSystemTime() * 1e3, peak / 1024.0);
+}
+
+void TimeReport::print_json(llvm::json::OStream &json) const
+{
+    long peak = 0;
+    for (auto &&i : mEntries)
+        peak = std::max(peak, i.mPeakRss);
+
+    json.object(
+        [&]
+        {
+            json.attribute("total_ms", total_ms());
+            json.attribute("peak_rss_kib", peak);
+            json.attributeArray("phases",
+                                [&]
+                                {
+                                    for (auto &&i : mEntries)
+                                        json.object(
+                                            [&]
+                                            {
+                                                json.attribute("name", i.mName);
+                                                json.attribute("depth", i.mDepth);
+                                                json.attribute("count", i.mCount);
+                                                json.attribute("wall_ms", i.mTime.getWallTime() * 1e3);
+                                                json.attribute("user_ms", i.mTime.getUserTime() * 1e3);
+                                                json.attribute("sys_ms", i.mTime.getSystemTime() * 1e3);
+                                                json.attribute("peak_rss_kib", i.mPeakRss);
+                                                json.attribute("rss_growth_kib", i.mRssGrowth);
+                                            });
+                                });
+        });
+}
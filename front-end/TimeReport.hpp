@@ -0,0 +1,90 @@
+#pragma once
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 按阶段记录编译的用时和内存，供 -time-report 使用
+ *
+ * 每个阶段记录墙钟时间、用户态和内核态的 CPU 时间（llvm::TimeRecord），以及
+ * 阶段结束时进程的峰值 RSS 和阶段内峰值 RSS 的增长。同名的阶段累加，如各个函数
+ * 上的同一个 pass；阶段可以嵌套，如 opt 中的各个 pass，只有最外层的阶段计入合计。
+ *
+ * CPU 时间和峰值 RSS 都是整个进程的，批量模式下多个线程同时编译时只有墙钟时间
+ * 是准确的。
+ */
+class TimeReport
+{
+  public:
+    struct Entry
+    {
+        std::string mName;
+        unsigned mDepth{0};     /// 嵌套的层数，最外层为 0
+        std::size_t mCount{0};  /// 进入的次数
+        llvm::TimeRecord mTime; /// 累计的用时
+        long mPeakRss{0};       /// 最后一次结束时进程的峰值 RSS（KiB）
+        long mRssGrowth{0};     /// 各次进入期间峰值 RSS 增长的合计（KiB）
+    };
+
+    /// 在作用域内计时
+    class Scope
+    {
+      public:
+        Scope(TimeReport &report, llvm::StringRef name) : mReport(report)
+        {
+            report.start(name);
+        }
+
+        ~Scope()
+        {
+            mReport.stop();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        TimeReport &mReport;
+    };
+
+    /// 开始名为 \p name 的阶段，与 stop 成对调用
+    void start(llvm::StringRef name);
+
+    /// 结束最近开始的阶段
+    void stop();
+
+    /// 在 \p pic 中注册回调，把每个 pass 记为当前阶段下的一项，在各个函数上的用时累加
+    void instrument(llvm::PassInstrumentationCallbacks &pic);
+
+    /// 按首次开始的顺序排列
+    const std::vector<Entry> &entries() const
+    {
+        return mEntries;
+    }
+
+    /// 最外层各阶段墙钟时间的合计（毫秒）
+    double total_ms() const;
+
+    /// 以表格形式打印
+    void print(llvm::raw_ostream &os) const;
+
+    /// 以一个 JSON 对象的形式写出
+    void print_json(llvm::json::OStream &json) const;
+
+  private:
+    std::vector<Entry> mEntries;
+    llvm::StringMap<std::size_t> mIndex;
+
+    struct Open
+    {
+        std::size_t mEntry;
+        llvm::TimeRecord mBegin;
+        long mBeginRss;
+    };
+    std::vector<Open> mOpen;
+};
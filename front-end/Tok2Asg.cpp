@@ -0,0 +1,653 @@
+#include "Tok2Asg.hpp"
+#include "Ast2Asg.hpp"
+#include "antlr/CLexer.h"
+
+namespace asg
+{
+
+TranslationUnit *Tok2Asg::operator()()
+{
+    auto ret = make<TranslationUnit>();
+    next();
+
+    while (mType != antlr4::Token::EOF)
+    {
+        if (!at_decl_specs())
+            error("declaration");
+
+        auto sq = decl_specs();
+        if (accept(CLexer::Semi))
+            continue;
+
+        std::vector<Ident> names;
+        auto decl = declarator(&names);
+
+        // 函数类型的声明符后紧跟复合语句时是函数定义
+        if (mType == CLexer::LeftBrace && kcst<FunctionType>(decl.first))
+        {
+            auto funcDecl = function_definition(sq, decl, std::move(names));
+            ret->decls.push_back(funcDecl);
+
+            // 添加到声明表
+            mSymtbl.declare(funcDecl->name, funcDecl);
+        }
+
+        else
+        {
+            auto decls = declaration(sq, decl, std::move(names));
+            ret->decls.insert(ret->decls.end(), decls.begin(), decls.end());
+        }
+    }
+
+    return ret;
+}
+
+//==============================================================================
+// 词法单元
+//==============================================================================
+
+void Tok2Asg::next()
+{
+    do
+        mTok = mSource.nextToken();
+    while (mTok->getChannel() != antlr4::Token::DEFAULT_CHANNEL);
+    mType = mTok->getType();
+}
+
+bool Tok2Asg::accept(size_t type)
+{
+    if (mType != type)
+        return false;
+    next();
+    return true;
+}
+
+void Tok2Asg::expect(size_t type, const char *what)
+{
+    if (!accept(type))
+        error(what);
+}
+
+void Tok2Asg::error(const char *what)
+{
+    std::cerr << "line " << mTok->getLine() << ":" << mTok->getCharPositionInLine() << " expected " << what
+              << " at '" << mTok->getText() << "'\n";
+    ABORT();
+}
+
+//==============================================================================
+// 类型
+//==============================================================================
+
+bool Tok2Asg::at_decl_specs() const
+{
+    return mType == CLexer::Int || mType == CLexer::Void || mType == CLexer::Const;
+}
+
+Tok2Asg::SpecQual Tok2Asg::decl_specs()
+{
+    SpecQual ret = {Type::Spec::kINVALID, Type::Qual()};
+
+    while (true)
+    {
+        switch (mType)
+        {
+        case CLexer::Int:
+        case CLexer::Void:
+            if (ret.first != Type::Spec::kINVALID)
+                error("at most one type specifier");
+            ret.first = mType == CLexer::Int ? Type::Spec::kInt : Type::Spec::kVoid;
+            break;
+
+        case CLexer::Const:
+            ret.second.const_ = true;
+            break;
+
+        default:
+            return ret;
+        }
+
+        next();
+    }
+}
+
+std::pair<TypeExpr *, Ident> Tok2Asg::declarator(std::vector<Ident> *paramNames)
+{
+    if (mType != CLexer::Identifier)
+        error("identifier");
+    Ident name(mTok->getText());
+    next();
+
+    // 后缀从左到右解析，但要从右到左套上去：a[2][3] 是元素类型为 int[3]、长度为 2 的数组
+    struct Suffix
+    {
+        bool array;
+        std::uint32_t len;
+        std::vector<const Type *> params;
+        std::vector<Ident> names;
+    };
+    std::vector<Suffix> suffixes;
+
+    while (true)
+    {
+        if (accept(CLexer::LeftBracket))
+        {
+            std::uint32_t len = ArrayType::kUnLen;
+            if (mType != CLexer::RightBracket)
+                len = eval_arrlen(assignment());
+            expect(CLexer::RightBracket, "']'");
+
+            suffixes.push_back({true, len, {}, {}});
+        }
+
+        else if (accept(CLexer::LeftParen))
+        {
+            Suffix suffix{false, 0, {}, {}};
+            if (mType != CLexer::RightParen)
+            {
+                do
+                {
+                    auto sq = decl_specs();
+                    if (sq.first == Type::Spec::kINVALID)
+                        error("type specifier");
+                    auto [texp, name] = declarator();
+                    suffix.params.push_back(mTypeCache(sq.first, sq.second, texp));
+                    suffix.names.push_back(name);
+                } while (accept(CLexer::Comma));
+            }
+            expect(CLexer::RightParen, "')'");
+
+            suffixes.push_back(std::move(suffix));
+        }
+
+        else
+            break;
+    }
+
+    TypeExpr *texp = nullptr;
+    for (auto i = suffixes.rbegin(); i != suffixes.rend(); ++i)
+    {
+        if (i->array)
+            texp = mTypeCache.array(i->len, texp);
+        else
+            texp = mTypeCache.function(texp, std::move(i->params));
+    }
+
+    if (paramNames && !suffixes.empty() && !suffixes.front().array)
+        *paramNames = std::move(suffixes.front().names);
+
+    return {texp, name};
+}
+
+//==============================================================================
+// 表达式
+//==============================================================================
+
+namespace
+{
+
+/// 二元运算符的优先级和运算，优先级为 0 表示不是二元运算符
+std::pair<int, BinaryExpr::Op> binary_op(size_t type)
+{
+    switch (type)
+    {
+    case CLexer::OrOr:
+        return {1, BinaryExpr::kOr};
+
+    case CLexer::AndAnd:
+        return {2, BinaryExpr::kAnd};
+
+    case CLexer::Equal:
+        return {3, BinaryExpr::kEq};
+
+    case CLexer::NotEqual:
+        return {3, BinaryExpr::kNe};
+
+    case CLexer::Less:
+        return {4, BinaryExpr::kLt};
+
+    case CLexer::Greater:
+        return {4, BinaryExpr::kGt};
+
+    case CLexer::LessEqual:
+        return {4, BinaryExpr::kLe};
+
+    case CLexer::GreaterEqual:
+        return {4, BinaryExpr::kGe};
+
+    case CLexer::Plus:
+        return {5, BinaryExpr::kAdd};
+
+    case CLexer::Minus:
+        return {5, BinaryExpr::kSub};
+
+    case CLexer::Star:
+        return {6, BinaryExpr::kMul};
+
+    case CLexer::Div:
+        return {6, BinaryExpr::kDiv};
+
+    case CLexer::Mod:
+        return {6, BinaryExpr::kMod};
+
+    default:
+        return {0, BinaryExpr::kINVALID};
+    }
+}
+
+} // namespace
+
+Expr *Tok2Asg::expression()
+{
+    Expr *ret = assignment();
+
+    while (accept(CLexer::Comma))
+    {
+        auto node = make<BinaryExpr>();
+        node->op = node->kComma;
+        node->lft = ret;
+        node->rht = assignment();
+        ret = node;
+    }
+
+    return ret;
+}
+
+Expr *Tok2Asg::assignment()
+{
+    auto lft = binary(1);
+    if (!accept(CLexer::Assign))
+        return lft;
+
+    // 赋值是右结合的
+    auto ret = make<BinaryExpr>();
+    ret->op = ret->kAssign;
+    ret->lft = lft;
+    ret->rht = assignment();
+    return ret;
+}
+
+Expr *Tok2Asg::binary(int minPrec)
+{
+    auto ret = unary();
+
+    while (true)
+    {
+        auto [prec, op] = binary_op(mType);
+        if (prec == 0 || prec < minPrec)
+            return ret;
+        next();
+
+        // 右操作数只吸收优先级更高的运算，从而得到左结合的树
+        auto node = make<BinaryExpr>();
+        node->op = op;
+        node->lft = ret;
+        node->rht = binary(prec + 1);
+        ret = node;
+    }
+}
+
+Expr *Tok2Asg::unary()
+{
+    UnaryExpr::Op op;
+    switch (mType)
+    {
+    case CLexer::Plus:
+        op = UnaryExpr::kPos;
+        break;
+
+    case CLexer::Minus:
+        op = UnaryExpr::kNeg;
+        break;
+
+    case CLexer::Not:
+        op = UnaryExpr::kNot;
+        break;
+
+    default:
+        return postfix();
+    }
+    next();
+
+    auto ret = make<UnaryExpr>();
+    ret->op = op;
+    ret->sub = unary();
+    return ret;
+}
+
+Expr *Tok2Asg::postfix()
+{
+    auto ret = primary();
+
+    while (true)
+    {
+        if (accept(CLexer::LeftBracket)) // 数组索引
+        {
+            auto binExpr = make<BinaryExpr>();
+            binExpr->lft = ret;
+            binExpr->rht = expression();
+            binExpr->op = binExpr->kIndex;
+            expect(CLexer::RightBracket, "']'");
+            ret = binExpr;
+        }
+
+        else if (accept(CLexer::LeftParen)) // 函数调用
+        {
+            auto callExpr = make<CallExpr>();
+            callExpr->head = ret;
+            if (!accept(CLexer::RightParen))
+            {
+                do
+                    callExpr->args.push_back(assignment());
+                while (accept(CLexer::Comma));
+                expect(CLexer::RightParen, "')'");
+            }
+            ret = callExpr;
+        }
+
+        else
+            return ret;
+    }
+}
+
+Expr *Tok2Asg::primary()
+{
+    switch (mType)
+    {
+    case CLexer::Identifier: {
+        auto ret = make<DeclRefExpr>();
+        ret->decl = mSymtbl.resolve(Ident(mTok->getText()));
+        next();
+        return ret;
+    }
+
+    case CLexer::Constant: {
+        auto text = mTok->getText();
+        next();
+
+        auto ret = make<IntegerLiteral>();
+
+        ASSERT(!text.empty());
+        if (text[0] != '0')
+            ret->val = std::stoll(text);
+
+        else if (text.size() == 1)
+            ret->val = 0;
+
+        else if (text[1] == 'x' || text[1] == 'X')
+            ret->val = std::stoll(text.substr(2), nullptr, 16);
+
+        else
+            ret->val = std::stoll(text.substr(1), nullptr, 8);
+
+        return ret;
+    }
+
+    case CLexer::LeftParen: {
+        next();
+        auto ret = make<ParenExpr>();
+        ret->sub = expression();
+        expect(CLexer::RightParen, "')'");
+        return ret;
+    }
+
+    default:
+        error("expression");
+    }
+}
+
+Expr *Tok2Asg::initializer()
+{
+    if (!accept(CLexer::LeftBrace))
+        return assignment();
+
+    if (accept(CLexer::RightBrace))
+        return make<ImplicitInitExpr>();
+
+    auto ret = make<InitListExpr>();
+    do
+    {
+        // 允许末尾多一个逗号
+        if (mType == CLexer::RightBrace)
+            break;
+
+        // 将初始化列表展平
+        auto expr = initializer();
+        if (auto p = kcst<InitListExpr>(expr))
+        {
+            for (auto &&sub : p->list)
+                ret->list.push_back(sub);
+        }
+        else
+        {
+            ret->list.push_back(expr);
+        }
+    } while (accept(CLexer::Comma));
+    expect(CLexer::RightBrace, "'}'");
+
+    return ret;
+}
+
+//==============================================================================
+// 语句
+//==============================================================================
+
+Stmt *Tok2Asg::statement()
+{
+    switch (mType)
+    {
+    case CLexer::LeftBrace:
+        return compound();
+
+    case CLexer::Semi:
+        next();
+        return make<NullStmt>();
+
+    case CLexer::If: {
+        next();
+        auto ifStmt = make<IfStmt>();
+        expect(CLexer::LeftParen, "'('");
+        ifStmt->cond = expression();
+        expect(CLexer::RightParen, "')'");
+        ifStmt->then = statement();
+        if (accept(CLexer::Else))
+            ifStmt->else_ = statement();
+        return ifStmt;
+    }
+
+    case CLexer::While: {
+        next();
+        auto whileStmt = make<WhileStmt>();
+        expect(CLexer::LeftParen, "'('");
+        whileStmt->cond = expression();
+        expect(CLexer::RightParen, "')'");
+        // 循环体内的 break/continue 指向本循环，出了循环体后恢复为外层的循环
+        auto outer = mCurrentIter;
+        mCurrentIter = whileStmt;
+        whileStmt->body = statement();
+        mCurrentIter = outer;
+        return whileStmt;
+    }
+
+    case CLexer::Do: {
+        next();
+        auto doStmt = make<DoStmt>();
+        auto outer = mCurrentIter;
+        mCurrentIter = doStmt;
+        doStmt->body = statement();
+        mCurrentIter = outer;
+        expect(CLexer::While, "'while'");
+        expect(CLexer::LeftParen, "'('");
+        doStmt->cond = expression();
+        expect(CLexer::RightParen, "')'");
+        expect(CLexer::Semi, "';'");
+        return doStmt;
+    }
+
+    case CLexer::Return: {
+        next();
+        auto ret = make<ReturnStmt>();
+        ret->func = mCurrentFunc;
+        if (mType != CLexer::Semi)
+            ret->expr = expression();
+        expect(CLexer::Semi, "';'");
+        return ret;
+    }
+
+    case CLexer::Break: {
+        next();
+        auto breakStmt = make<BreakStmt>();
+        breakStmt->loop = mCurrentIter;
+        expect(CLexer::Semi, "';'");
+        return breakStmt;
+    }
+
+    case CLexer::Continue: {
+        next();
+        auto continueStmt = make<ContinueStmt>();
+        continueStmt->loop = mCurrentIter;
+        expect(CLexer::Semi, "';'");
+        return continueStmt;
+    }
+
+    default: {
+        auto ret = make<ExprStmt>();
+        ret->expr = expression();
+        expect(CLexer::Semi, "';'");
+        return ret;
+    }
+    }
+}
+
+CompoundStmt *Tok2Asg::compound()
+{
+    expect(CLexer::LeftBrace, "'{'");
+    auto ret = make<CompoundStmt>();
+
+    Symtbl::Scope localDecls(mSymtbl);
+    while (!accept(CLexer::RightBrace))
+    {
+        if (at_decl_specs())
+        {
+            auto sub = make<DeclStmt>();
+            sub->decls = declaration();
+            ret->subs.push_back(sub);
+        }
+
+        else
+            ret->subs.push_back(statement());
+    }
+
+    return ret;
+}
+
+//==============================================================================
+// 声明
+//==============================================================================
+
+std::vector<Decl *> Tok2Asg::declaration(SpecQual sq, std::pair<TypeExpr *, Ident> first, std::vector<Ident> &&names)
+{
+    std::vector<Decl *> ret;
+    ret.push_back(init_declarator(sq, first, std::move(names)));
+
+    while (accept(CLexer::Comma))
+    {
+        std::vector<Ident> names;
+        auto decl = declarator(&names);
+        ret.push_back(init_declarator(sq, decl, std::move(names)));
+    }
+    expect(CLexer::Semi, "';'");
+
+    return ret;
+}
+
+std::vector<Decl *> Tok2Asg::declaration()
+{
+    auto sq = decl_specs();
+
+    // 没有声明符的声明语句无意义
+    if (accept(CLexer::Semi))
+        return {};
+
+    std::vector<Ident> names;
+    auto decl = declarator(&names);
+    return declaration(sq, decl, std::move(names));
+}
+
+Decl *Tok2Asg::init_declarator(SpecQual sq, std::pair<TypeExpr *, Ident> decl, std::vector<Ident> &&names)
+{
+    auto [texp, name] = decl;
+    Decl *ret;
+
+    if (auto funcType = kcst<FunctionType>(texp))
+    {
+        auto fdecl = make<FunctionDecl>();
+        fdecl->type = mTypeCache(sq.first, sq.second, funcType);
+        fdecl->name = name;
+
+        auto nameIter = names.begin();
+        for (auto p : funcType->params)
+        {
+            auto paramDecl = make<VarDecl>();
+            fdecl->params.push_back(paramDecl);
+            paramDecl->type = p;
+            paramDecl->name = *nameIter++;
+        }
+
+        if (mType == CLexer::Assign)
+            error("';'");
+        fdecl->body = nullptr;
+
+        ret = fdecl;
+    }
+
+    else
+    {
+        auto vdecl = make<VarDecl>();
+        vdecl->type = mTypeCache(sq.first, sq.second, texp);
+        vdecl->name = name;
+
+        if (accept(CLexer::Assign))
+            vdecl->init = initializer();
+        else
+            vdecl->init = nullptr;
+
+        ret = vdecl;
+    }
+
+    // 与 Ast2Asg 一样允许符号重复定义，新定义会取代旧定义
+    mSymtbl.declare(ret->name, ret);
+    return ret;
+}
+
+FunctionDecl *Tok2Asg::function_definition(SpecQual sq, std::pair<TypeExpr *, Ident> decl,
+                                           std::vector<Ident> &&names)
+{
+    auto ret = make<FunctionDecl>();
+    mCurrentFunc = ret;
+
+    auto [funcType, name] = decl;
+    ret->type = mTypeCache(sq.first, sq.second, funcType);
+    ret->name = name;
+
+    Symtbl::Scope localDecls(mSymtbl);
+    // 函数定义在签名之后就加入符号表，以允许递归调用
+    mSymtbl.declare(ret->name, ret);
+
+    auto nameIter = names.begin();
+    for (auto p : kcst<FunctionType>(funcType)->params)
+    {
+        auto paramDecl = make<VarDecl>();
+        ret->params.push_back(paramDecl);
+        paramDecl->type = p;
+        paramDecl->name = *nameIter++;
+
+        mSymtbl.declare(paramDecl->name, paramDecl);
+    }
+
+    ret->body = compound();
+
+    return ret;
+}
+
+} // namespace asg
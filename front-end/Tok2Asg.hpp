@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Symtbl.hpp"
+#include "antlr4-runtime.h"
+#include "asg/asg.hpp"
+
+namespace asg
+{
+
+/**
+ * @brief 直接从词法单元流构建 ASG 的手写语法分析器
+ *
+ * 与 CParser + Ast2Asg 的两遍处理不同，这里边做递归下降边用 Obj::Mgr 创建 ASG
+ * 结点，不建立 ANTLR 的语法树；表达式用优先级爬升法解析，不必逐层经过 13 级
+ * 表达式规则。支持的语言子集与 Ast2Asg 相同，产生的 ASG 也与之相同，所以后续
+ * 的 Typing、EmitIR 无需改动。
+ *
+ * 词法单元来自任意 antlr4::TokenSource（CLexer 或 FastLexer），隐藏通道的词法
+ * 单元被跳过，任何时刻只保留当前的一个词法单元。遇到语法错误或不支持的语法时
+ * 打印位置后中止。
+ */
+class Tok2Asg
+{
+  public:
+    Obj::Mgr &mMgr;
+    Type::Cache &mTypeCache;
+
+    Tok2Asg(Obj::Mgr &mgr, Type::Cache &typeCache, antlr4::TokenSource &source)
+        : mMgr(mgr), mTypeCache(typeCache), mSource(source)
+    {
+    }
+
+    /// 解析整个编译单元
+    TranslationUnit *operator()();
+
+  private:
+    antlr4::TokenSource &mSource;
+    std::unique_ptr<antlr4::Token> mTok; /// 当前词法单元
+    size_t mType{0};                     /// 当前词法单元的类型
+
+    Symtbl mSymtbl;
+    FunctionDecl *mCurrentFunc{nullptr};
+    Stmt *mCurrentIter{nullptr};
+
+    template <typename T, typename... Args> T *make(Args... args)
+    {
+        return mMgr.make<T>(args...);
+    }
+
+    //============================================================================
+    // 词法单元
+    //============================================================================
+
+    /// 前进到下一个非隐藏的词法单元
+    void next();
+
+    /// 当前词法单元的类型是 \p type 时前进并返回 true
+    bool accept(size_t type);
+
+    /// 当前词法单元的类型必须是 \p type ，否则报错
+    void expect(size_t type, const char *what);
+
+    [[noreturn]] void error(const char *what);
+
+    //============================================================================
+    // 类型
+    //============================================================================
+
+    using SpecQual = std::pair<Type::Spec, Type::Qual>;
+
+    /// 当前词法单元能否开始一个声明
+    bool at_decl_specs() const;
+
+    SpecQual decl_specs();
+
+    /// 声明符，\p paramNames 非空时保存最外层函数类型的参数名
+    std::pair<TypeExpr *, Ident> declarator(std::vector<Ident> *paramNames = nullptr);
+
+    //============================================================================
+    // 表达式
+    //============================================================================
+
+    Expr *expression();
+
+    Expr *assignment();
+
+    /// 优先级不低于 \p minPrec 的二元运算
+    Expr *binary(int minPrec);
+
+    Expr *unary();
+
+    Expr *postfix();
+
+    Expr *primary();
+
+    Expr *initializer();
+
+    //============================================================================
+    // 语句
+    //============================================================================
+
+    Stmt *statement();
+
+    CompoundStmt *compound();
+
+    //============================================================================
+    // 声明
+    //============================================================================
+
+    /// 解析 \p sq 之后、以分号结尾的声明符列表，第一个声明符已解析为 \p first
+    std::vector<Decl *> declaration(SpecQual sq, std::pair<TypeExpr *, Ident> first, std::vector<Ident> &&names);
+
+    std::vector<Decl *> declaration();
+
+    Decl *init_declarator(SpecQual sq, std::pair<TypeExpr *, Ident> decl, std::vector<Ident> &&names);
+
+    FunctionDecl *function_definition(SpecQual sq, std::pair<TypeExpr *, Ident> decl, std::vector<Ident> &&names);
+};
+
+} // namespace asg
@@ -0,0 +1,326 @@
+#include "Asg2Bin.hpp"
+
+namespace asg
+{
+
+void Asg2Bin::operator()(TranslationUnit *tu)
+{
+    // 结点表，处理结点时新引用到的结点排到队尾
+    auto root = node(tu, bin::kTranslationUnitTag) - 1;
+    for (std::uint32_t i = 0; i < mNodes.size(); ++i)
+        record(i);
+
+    bin::Header header;
+    header.nStrings = mStrings.size();
+    for (auto &&i : mStrings)
+        header.nBytes += i.size();
+    header.nTypes = mTypeCount;
+    header.nTypeWords = mTypeWords.size();
+    header.nNodes = mNodes.size();
+    header.nNodeWords = mNodeWords.size();
+    header.root = root;
+    write(&header, sizeof(header));
+
+    std::vector<std::uint32_t> offsets;
+    offsets.reserve(mStrings.size() + 1);
+    std::uint32_t offset = 0;
+    offsets.push_back(offset);
+    for (auto &&i : mStrings)
+        offsets.push_back(offset += i.size());
+    write(offsets.data(), offsets.size() * sizeof(std::uint32_t));
+    for (auto &&i : mStrings)
+        write(i.data(), i.size());
+    pad(header.nBytes);
+
+    write(mTypeWords.data(), mTypeWords.size() * sizeof(std::uint32_t));
+
+    write(mTags.data(), mTags.size());
+    pad(mTags.size());
+
+    write(mNodeWords.data(), mNodeWords.size() * sizeof(std::uint32_t));
+}
+
+void Asg2Bin::write(const void *data, std::size_t size)
+{
+    mOs.write(static_cast<const char *>(data), size);
+}
+
+void Asg2Bin::pad(std::size_t size)
+{
+    static const char kZeros[4] = {};
+    write(kZeros, (4 - size % 4) % 4);
+}
+
+std::uint32_t Asg2Bin::string(std::string_view str)
+{
+    auto [iter, inserted] = mStringIds.try_emplace(str, mStrings.size());
+    if (inserted)
+        mStrings.push_back(str);
+    return iter->second;
+}
+
+//==============================================================================
+// 类型
+//==============================================================================
+
+std::uint32_t Asg2Bin::type(const Type *type)
+{
+    if (type == nullptr)
+        return 0;
+    auto iter = mTypeIds.find(type);
+    if (iter != mTypeIds.end())
+        return iter->second;
+
+    // 先登记引用到的记录，保证它们排在前面
+    auto sub = texp(type->texp);
+    mTypeWords.insert(mTypeWords.end(), {std::uint32_t(TypeExpr::Kind::kINVALID), std::uint32_t(type->spec),
+                                         type->qual.const_, sub});
+    return mTypeIds[type] = ++mTypeCount;
+}
+
+std::uint32_t Asg2Bin::texp(const TypeExpr *texp)
+{
+    if (texp == nullptr)
+        return 0;
+    auto iter = mTypeIds.find(texp);
+    if (iter != mTypeIds.end())
+        return iter->second;
+
+    auto sub = Asg2Bin::texp(texp->sub);
+    switch (texp->kind)
+    {
+    case TypeExpr::Kind::kPointerType:
+        mTypeWords.insert(mTypeWords.end(),
+                          {std::uint32_t(texp->kind), static_cast<const PointerType *>(texp)->qual.const_, sub});
+        break;
+
+    case TypeExpr::Kind::kArrayType:
+        mTypeWords.insert(mTypeWords.end(),
+                          {std::uint32_t(texp->kind), static_cast<const ArrayType *>(texp)->len, sub});
+        break;
+
+    case TypeExpr::Kind::kFunctionType: {
+        auto &params = static_cast<const FunctionType *>(texp)->params;
+        std::vector<std::uint32_t> ids;
+        ids.reserve(params.size());
+        for (auto &&i : params)
+            ids.push_back(type(i));
+        mTypeWords.insert(mTypeWords.end(), {std::uint32_t(texp->kind), sub, std::uint32_t(ids.size())});
+        mTypeWords.insert(mTypeWords.end(), ids.begin(), ids.end());
+        break;
+    }
+
+    default:
+        ABORT();
+    }
+
+    return mTypeIds[texp] = ++mTypeCount;
+}
+
+//==============================================================================
+// 结点
+//==============================================================================
+
+std::uint32_t Asg2Bin::node(Obj *obj, std::uint8_t tag)
+{
+    if (obj == nullptr)
+        return 0;
+    auto [iter, inserted] = mNodeIds.try_emplace(obj, mNodes.size() + 1);
+    if (inserted)
+    {
+        mNodes.push_back(obj);
+        mTags.push_back(tag);
+    }
+    return iter->second;
+}
+
+std::uint32_t Asg2Bin::node(Decl *obj)
+{
+    return obj ? node(obj, bin::node_tag(obj->kind)) : 0;
+}
+
+std::uint32_t Asg2Bin::node(Expr *obj)
+{
+    return obj ? node(obj, bin::node_tag(obj->kind)) : 0;
+}
+
+std::uint32_t Asg2Bin::node(Stmt *obj)
+{
+    return obj ? node(obj, bin::node_tag(obj->kind)) : 0;
+}
+
+/**
+ * 各种结点的记录：
+ *
+ *   TranslationUnit   n, decls[n]
+ *   VarDecl           name, type, init
+ *   FunctionDecl      name, type, n, params[n], body
+ *   Expr              type, cate，随后按种类：
+ *     IntegerLiteral    低 32 位, 高 32 位
+ *     StringLiteral     val
+ *     DeclRefExpr       decl
+ *     ParenExpr         sub
+ *     UnaryExpr         op, sub
+ *     BinaryExpr        op, lft, rht
+ *     CallExpr          head, n, args[n]
+ *     InitListExpr      n, list[n]
+ *     ImplicitInitExpr
+ *     ImplicitCastExpr  kind, sub
+ *   NullStmt
+ *   DeclStmt          n, decls[n]
+ *   ExprStmt          expr
+ *   CompoundStmt      n, subs[n]
+ *   IfStmt            cond, then, else
+ *   WhileStmt         cond, body
+ *   DoStmt            body, cond
+ *   BreakStmt         loop
+ *   ContinueStmt      loop
+ *   ReturnStmt        func, expr
+ */
+void Asg2Bin::record(std::uint32_t i)
+{
+    auto obj = mNodes[i];
+    auto tag = mTags[i];
+    auto &w = mNodeWords;
+
+    if (tag == bin::kTranslationUnitTag)
+        return nodes(static_cast<TranslationUnit *>(obj)->decls);
+
+    if (tag < bin::kExprTag)
+    {
+        auto decl = static_cast<Decl *>(obj);
+        w.push_back(string(decl->name.str()));
+        w.push_back(type(decl->type));
+
+        if (auto p = kcst<VarDecl>(decl))
+            w.push_back(node(p->init));
+        else if (auto p = kcst<FunctionDecl>(decl))
+        {
+            nodes(p->params);
+            w.push_back(node(p->body));
+        }
+        else
+            ABORT();
+        return;
+    }
+
+    if (tag < bin::kStmtTag)
+    {
+        auto expr = static_cast<Expr *>(obj);
+        w.push_back(type(expr->type));
+        w.push_back(std::uint32_t(expr->cate));
+
+        switch (expr->kind)
+        {
+        case Expr::Kind::kIntegerLiteral: {
+            auto val = expr->scst<IntegerLiteral>()->val;
+            w.insert(w.end(), {std::uint32_t(val), std::uint32_t(val >> 32)});
+            break;
+        }
+
+        case Expr::Kind::kStringLiteral:
+            w.push_back(string(expr->scst<StringLiteral>()->val));
+            break;
+
+        case Expr::Kind::kDeclRefExpr:
+            w.push_back(node(expr->scst<DeclRefExpr>()->decl));
+            break;
+
+        case Expr::Kind::kParenExpr:
+            w.push_back(node(expr->scst<ParenExpr>()->sub));
+            break;
+
+        case Expr::Kind::kUnaryExpr: {
+            auto p = expr->scst<UnaryExpr>();
+            w.insert(w.end(), {std::uint32_t(p->op), node(p->sub)});
+            break;
+        }
+
+        case Expr::Kind::kBinaryExpr: {
+            auto p = expr->scst<BinaryExpr>();
+            w.insert(w.end(), {std::uint32_t(p->op), node(p->lft), node(p->rht)});
+            break;
+        }
+
+        case Expr::Kind::kCallExpr: {
+            auto p = expr->scst<CallExpr>();
+            w.push_back(node(p->head));
+            nodes(p->args);
+            break;
+        }
+
+        case Expr::Kind::kInitListExpr:
+            nodes(expr->scst<InitListExpr>()->list);
+            break;
+
+        case Expr::Kind::kImplicitInitExpr:
+            break;
+
+        case Expr::Kind::kImplicitCastExpr: {
+            auto p = expr->scst<ImplicitCastExpr>();
+            w.insert(w.end(), {std::uint32_t(p->castKind), node(p->sub)});
+            break;
+        }
+
+        default:
+            ABORT();
+        }
+        return;
+    }
+
+    auto stmt = static_cast<Stmt *>(obj);
+    switch (stmt->kind)
+    {
+    case Stmt::Kind::kNullStmt:
+        break;
+
+    case Stmt::Kind::kDeclStmt:
+        nodes(stmt->scst<DeclStmt>()->decls);
+        break;
+
+    case Stmt::Kind::kExprStmt:
+        w.push_back(node(stmt->scst<ExprStmt>()->expr));
+        break;
+
+    case Stmt::Kind::kCompoundStmt:
+        nodes(stmt->scst<CompoundStmt>()->subs);
+        break;
+
+    case Stmt::Kind::kIfStmt: {
+        auto p = stmt->scst<IfStmt>();
+        w.insert(w.end(), {node(p->cond), node(p->then), node(p->else_)});
+        break;
+    }
+
+    case Stmt::Kind::kWhileStmt: {
+        auto p = stmt->scst<WhileStmt>();
+        w.insert(w.end(), {node(p->cond), node(p->body)});
+        break;
+    }
+
+    case Stmt::Kind::kDoStmt: {
+        auto p = stmt->scst<DoStmt>();
+        w.insert(w.end(), {node(p->body), node(p->cond)});
+        break;
+    }
+
+    case Stmt::Kind::kBreakStmt:
+        w.push_back(node(stmt->scst<BreakStmt>()->loop));
+        break;
+
+    case Stmt::Kind::kContinueStmt:
+        w.push_back(node(stmt->scst<ContinueStmt>()->loop));
+        break;
+
+    case Stmt::Kind::kReturnStmt: {
+        auto p = stmt->scst<ReturnStmt>();
+        w.insert(w.end(), {node(p->func), node(p->expr)});
+        break;
+    }
+
+    default:
+        ABORT();
+    }
+}
+
+} // namespace asg
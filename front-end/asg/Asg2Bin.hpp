@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AsgBin.hpp"
+#include <llvm/Support/raw_ostream.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace asg
+{
+
+/**
+ * @brief 把 ASG 以二进制格式（见 AsgBin.hpp）写到输出流
+ *
+ * 结点按广度优先的顺序编号：编码一个结点的记录时，它引用的结点若还没有编号
+ * 就编上号并排入队列，所以只需遍历一遍，也不会因 ASG 很深而递归过深。字符串
+ * 和类型在遇到时登记，三张表都在内存中攒好后一次写出。
+ */
+class Asg2Bin
+{
+  public:
+    Asg2Bin(llvm::raw_ostream &os) : mOs(os)
+    {
+    }
+
+    void operator()(TranslationUnit *tu);
+
+  private:
+    llvm::raw_ostream &mOs;
+
+    std::unordered_map<std::string_view, std::uint32_t> mStringIds;
+    std::vector<std::string_view> mStrings;
+
+    std::unordered_map<const Obj *, std::uint32_t> mTypeIds;
+    std::uint32_t mTypeCount{0};
+    std::vector<std::uint32_t> mTypeWords;
+
+    std::unordered_map<const Obj *, std::uint32_t> mNodeIds;
+    std::vector<Obj *> mNodes;
+    std::vector<std::uint8_t> mTags;
+    std::vector<std::uint32_t> mNodeWords;
+
+    std::uint32_t string(std::string_view str);
+
+    /// 以下返回下标加一，空指针返回 0
+    std::uint32_t type(const Type *type);
+    std::uint32_t texp(const TypeExpr *texp);
+    std::uint32_t node(Obj *obj, std::uint8_t tag);
+    std::uint32_t node(Decl *obj);
+    std::uint32_t node(Expr *obj);
+    std::uint32_t node(Stmt *obj);
+
+    template <typename T> void nodes(const std::vector<T *> &objs)
+    {
+        mNodeWords.push_back(objs.size());
+        for (auto &&i : objs)
+            mNodeWords.push_back(node(i));
+    }
+
+    /// 编码第 \p i 个结点的记录
+    void record(std::uint32_t i);
+
+    void write(const void *data, std::size_t size);
+
+    /// 把 \p size 字节的内容补齐到 4 字节
+    void pad(std::size_t size);
+};
+
+} // namespace asg
@@ -5,24 +5,30 @@
 namespace asg
 {
 
-json::Object Asg2Json::operator()(TranslationUnit *tu)
+void Asg2Json::operator()(TranslationUnit *tu)
 {
-    json::Object ret;
-
-    ret["kind"] = "TranslationUnitDecl";
-
-    json::Array inner;
-    for (auto &&i : tu->decls)
-        inner.push_back(self(i));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            for (auto &&i : tu->decls)
+                self(i);
+        });
+        mOs.attribute("kind", "TranslationUnitDecl");
+    });
 }
 
 //==============================================================================
 // 类型
 //==============================================================================
 
+void Asg2Json::qual_type(const Type *type)
+{
+    auto [iter, inserted] = mQualTypes.try_emplace(type);
+    if (inserted)
+        iter->second = self(type);
+
+    mOs.attributeObject("type", [&] { mOs.attribute("qualType", iter->second); });
+}
+
 std::string Asg2Json::operator()(const Type *type)
 {
     std::string ret;
@@ -70,7 +76,7 @@ std::string Asg2Json::operator()(TypeExpr *texp)
 {
     Obj::Walked guard(texp);
 
-    if (auto p = texp->dcst<ArrayType>())
+    if (auto p = kcst<ArrayType>(texp))
     {
         std::string ret = "[";
 
@@ -84,7 +90,7 @@ std::string Asg2Json::operator()(TypeExpr *texp)
         return ret;
     }
 
-    if (auto p = texp->dcst<FunctionType>())
+    if (auto p = kcst<FunctionType>(texp))
     {
         std::string ret;
 
@@ -108,25 +114,16 @@ std::string Asg2Json::operator()(TypeExpr *texp)
         return ret;
     }
 
-    if (auto p = texp->dcst<PointerType>())
+    if (kcst<PointerType>(texp))
     {
-        if (auto arrayType = texp->sub->dcst<ArrayType>())
-        {
-            std::string ret;
-            if (arrayType->sub != nullptr)
-            {
-                ret = " (*)";
-                ret += self(arrayType->sub);
-            }
-            else
-            {
-                ret = " *";
-            }
+        if (texp->sub == nullptr)
+            return " *";
 
-            return ret;
-        }
+        // 指向数组的指针，如 int (*)[4]
+        if (kcst<ArrayType>(texp->sub))
+            return " (*)" + self(texp->sub);
 
-        if (auto functionType = texp->sub->dcst<FunctionType>())
+        if (auto functionType = kcst<FunctionType>(texp->sub))
         {
             std::string ret;
             ret = " (*)";
@@ -151,91 +148,20 @@ std::string Asg2Json::operator()(TypeExpr *texp)
     ABORT();
 }
 
+
 //==============================================================================
 // 表达式
 //==============================================================================
 
-json::Object Asg2Json::operator()(Expr *obj)
-{
-    json::Object ret;
-
-    if (auto p = obj->dcst<IntegerLiteral>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<StringLiteral>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<DeclRefExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<ParenExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<UnaryExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<BinaryExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<CallExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<InitListExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<ImplicitInitExpr>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<ImplicitCastExpr>())
-        ret = std::move(self(p));
-
-    else
-        ABORT();
-
-    ret["type"] = json::Object({{"qualType", self(obj->type)}});
-
-    switch (obj->cate)
-    {
-    case Expr::Cate::kINVALID:
-        ret["valueCategory"] = "INVALID";
-        break;
-
-    case Expr::Cate::kLValue:
-        ret["valueCategory"] = "lvalue";
-        break;
-
-    case Expr::Cate::kRValue:
-        ret["valueCategory"] = "prvalue";
-        break;
-
-    default:
-        ABORT();
-    }
-
-    return ret;
-}
-
-json::Object Asg2Json::operator()(IntegerLiteral *obj)
+namespace
 {
-    json::Object ret;
-    Obj::Walked guard(obj);
-
-    ret["kind"] = "IntegerLiteral";
-    ret["value"] = std::to_string(obj->val);
 
-    return ret;
-}
-
-json::Object Asg2Json::operator()(StringLiteral *obj)
+/// 字符串字面量的值，按 C 的转义规则写回源码形式
+std::string quote(const std::string &val)
 {
-    json::Object ret;
-    Obj::Walked guard(obj);
-
-    ret["kind"] = "StringLiteral";
-
     std::string value;
     value.push_back('"');
-    for (auto &&c : obj->val)
+    for (auto &&c : val)
     {
         switch (c)
         {
@@ -288,441 +214,474 @@ json::Object Asg2Json::operator()(StringLiteral *obj)
         }
     }
     value.push_back('"');
-    ret["value"] = std::move(value);
+    return value;
+}
 
-    return ret;
+} // namespace
+
+void Asg2Json::operator()(Expr *obj)
+{
+    mOs.object([&] {
+        // 各子类只写出排在 "type" 之前的键：inner、kind、opcode
+        switch (obj->kind)
+        {
+        case Expr::Kind::kIntegerLiteral:
+            self(obj->scst<IntegerLiteral>());
+            break;
+
+        case Expr::Kind::kStringLiteral:
+            self(obj->scst<StringLiteral>());
+            break;
+
+        case Expr::Kind::kDeclRefExpr:
+            self(obj->scst<DeclRefExpr>());
+            break;
+
+        case Expr::Kind::kParenExpr:
+            self(obj->scst<ParenExpr>());
+            break;
+
+        case Expr::Kind::kUnaryExpr:
+            self(obj->scst<UnaryExpr>());
+            break;
+
+        case Expr::Kind::kBinaryExpr:
+            self(obj->scst<BinaryExpr>());
+            break;
+
+        case Expr::Kind::kCallExpr:
+            self(obj->scst<CallExpr>());
+            break;
+
+        case Expr::Kind::kInitListExpr:
+            self(obj->scst<InitListExpr>());
+            break;
+
+        case Expr::Kind::kImplicitInitExpr:
+            self(obj->scst<ImplicitInitExpr>());
+            break;
+
+        case Expr::Kind::kImplicitCastExpr:
+            self(obj->scst<ImplicitCastExpr>());
+            break;
+
+        default:
+            ABORT();
+        }
+
+        qual_type(obj->type);
+
+        // 字面量的 "value" 排在 "type" 和 "valueCategory" 之间
+        if (auto p = kcst<IntegerLiteral>(obj))
+            mOs.attribute("value", std::to_string(p->val));
+        else if (auto p = kcst<StringLiteral>(obj))
+            mOs.attribute("value", quote(p->val));
+
+        switch (obj->cate)
+        {
+        case Expr::Cate::kINVALID:
+            mOs.attribute("valueCategory", "INVALID");
+            break;
+
+        case Expr::Cate::kLValue:
+            mOs.attribute("valueCategory", "lvalue");
+            break;
+
+        case Expr::Cate::kRValue:
+            mOs.attribute("valueCategory", "prvalue");
+            break;
+
+        default:
+            ABORT();
+        }
+    });
 }
 
-json::Object Asg2Json::operator()(DeclRefExpr *obj)
+void Asg2Json::operator()(IntegerLiteral *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "DeclRefExpr";
+    mOs.attribute("kind", "IntegerLiteral");
+}
 
-    return ret;
+void Asg2Json::operator()(StringLiteral *obj)
+{
+    Obj::Walked guard(obj);
+
+    mOs.attribute("kind", "StringLiteral");
 }
 
-json::Object Asg2Json::operator()(ParenExpr *obj)
+void Asg2Json::operator()(DeclRefExpr *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "ParenExpr";
+    mOs.attribute("kind", "DeclRefExpr");
+}
 
-    json::Array inner;
-    inner.push_back(self(obj->sub));
-    ret["inner"] = std::move(inner);
+void Asg2Json::operator()(ParenExpr *obj)
+{
+    Obj::Walked guard(obj);
 
-    return ret;
+    mOs.attributeArray("inner", [&] { self(obj->sub); });
+    mOs.attribute("kind", "ParenExpr");
 }
 
-json::Object Asg2Json::operator()(UnaryExpr *obj)
+void Asg2Json::operator()(UnaryExpr *obj)
 {
     assert(obj->sub);
 
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "UnaryOperator";
+    mOs.attributeArray("inner", [&] { self(obj->sub); });
+    mOs.attribute("kind", "UnaryOperator");
 
     switch (obj->op)
     {
     case UnaryExpr::kPos:
-        ret["opcode"] = "+";
+        mOs.attribute("opcode", "+");
         break;
 
     case UnaryExpr::kNeg:
-        ret["opcode"] = "-";
+        mOs.attribute("opcode", "-");
         break;
 
     case UnaryExpr::kNot:
-        ret["opcode"] = "!";
+        mOs.attribute("opcode", "!");
         break;
 
     default:
         ABORT();
     }
-
-    json::Array inner;
-    inner.push_back(self(obj->sub));
-    ret["inner"] = std::move(inner);
-
-    return ret;
 }
 
-json::Object Asg2Json::operator()(BinaryExpr *obj)
+void Asg2Json::operator()(BinaryExpr *obj)
 {
     assert(obj->lft && obj->rht);
 
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "BinaryOperator";
+    mOs.attributeArray("inner", [&] {
+        self(obj->lft);
+        self(obj->rht);
+    });
 
+    const char *opcode;
     switch (obj->op)
     {
     case BinaryExpr::kMul:
-        ret["opcode"] = "*";
+        opcode = "*";
         break;
 
     case BinaryExpr::kDiv:
-        ret["opcode"] = "/";
+        opcode = "/";
         break;
 
     case BinaryExpr::kMod:
-        ret["opcode"] = "%";
+        opcode = "%";
         break;
 
     case BinaryExpr::kAdd:
-        ret["opcode"] = "+";
+        opcode = "+";
         break;
 
     case BinaryExpr::kSub:
-        ret["opcode"] = "-";
+        opcode = "-";
         break;
 
     case BinaryExpr::kGt:
-        ret["opcode"] = ">";
+        opcode = ">";
         break;
 
     case BinaryExpr::kLt:
-        ret["opcode"] = "<";
+        opcode = "<";
         break;
 
     case BinaryExpr::kGe:
-        ret["opcode"] = ">=";
+        opcode = ">=";
         break;
 
     case BinaryExpr::kLe:
-        ret["opcode"] = "<=";
+        opcode = "<=";
         break;
 
     case BinaryExpr::kEq:
-        ret["opcode"] = "==";
+        opcode = "==";
         break;
 
     case BinaryExpr::kNe:
-        ret["opcode"] = "!=";
+        opcode = "!=";
         break;
 
     case BinaryExpr::kAnd:
-        ret["opcode"] = "&&";
+        opcode = "&&";
         break;
 
     case BinaryExpr::kOr:
-        ret["opcode"] = "||";
+        opcode = "||";
         break;
 
     case BinaryExpr::kAssign:
-        ret["opcode"] = "=";
+        opcode = "=";
         break;
 
     case BinaryExpr::kComma:
-        ret["opcode"] = ",";
+        opcode = ",";
         break;
 
     case BinaryExpr::kIndex:
-        ret["kind"] = "ArraySubscriptExpr";
-        break;
+        mOs.attribute("kind", "ArraySubscriptExpr");
+        return;
 
     default:
         ABORT();
     }
 
-    json::Array inner;
-    inner.push_back(self(obj->lft));
-    inner.push_back(self(obj->rht));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.attribute("kind", "BinaryOperator");
+    mOs.attribute("opcode", opcode);
 }
 
-json::Object Asg2Json::operator()(CallExpr *obj)
+void Asg2Json::operator()(CallExpr *obj)
 {
     assert(obj->head);
 
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "CallExpr";
-
-    json::Array inner;
-    inner.push_back(self(obj->head));
-    for (auto &&i : obj->args)
-        inner.push_back(self(i));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.attributeArray("inner", [&] {
+        self(obj->head);
+        for (auto &&i : obj->args)
+            self(i);
+    });
+    mOs.attribute("kind", "CallExpr");
 }
 
-json::Object Asg2Json::operator()(InitListExpr *obj)
+void Asg2Json::operator()(InitListExpr *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "InitListExpr";
-
-    json::Array inner;
-    for (auto &&i : obj->list)
-        inner.push_back(self(i));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.attributeArray("inner", [&] {
+        for (auto &&i : obj->list)
+            self(i);
+    });
+    mOs.attribute("kind", "InitListExpr");
 }
 
-json::Object Asg2Json::operator()(ImplicitInitExpr *obj)
+void Asg2Json::operator()(ImplicitInitExpr *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "InitListExpr";
-
-    return ret;
+    mOs.attribute("kind", "InitListExpr");
 }
 
-json::Object Asg2Json::operator()(ImplicitCastExpr *obj)
+void Asg2Json::operator()(ImplicitCastExpr *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "ImplicitCastExpr";
-
-    json::Array inner;
-    inner.push_back(self(obj->sub));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.attributeArray("inner", [&] { self(obj->sub); });
+    mOs.attribute("kind", "ImplicitCastExpr");
 }
 
 //==============================================================================
 // 语句
 //==============================================================================
 
-json::Object Asg2Json::operator()(Stmt *obj)
+void Asg2Json::operator()(Stmt *obj)
 {
-    if (auto p = obj->dcst<DeclStmt>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Stmt::Kind::kDeclStmt:
+        return self(obj->scst<DeclStmt>());
 
-    if (auto p = obj->dcst<ExprStmt>())
-        return self(p);
+    case Stmt::Kind::kExprStmt:
+        return self(obj->scst<ExprStmt>());
 
-    if (auto p = obj->dcst<CompoundStmt>())
-        return self(p);
+    case Stmt::Kind::kCompoundStmt:
+        return self(obj->scst<CompoundStmt>());
 
-    if (auto p = obj->dcst<IfStmt>())
-        return self(p);
+    case Stmt::Kind::kIfStmt:
+        return self(obj->scst<IfStmt>());
 
-    if (auto p = obj->dcst<WhileStmt>())
-        return self(p);
+    case Stmt::Kind::kWhileStmt:
+        return self(obj->scst<WhileStmt>());
 
-    if (auto p = obj->dcst<DoStmt>())
-        return self(p);
+    case Stmt::Kind::kDoStmt:
+        return self(obj->scst<DoStmt>());
 
-    if (auto p = obj->dcst<BreakStmt>())
-        return self(p);
+    case Stmt::Kind::kBreakStmt:
+        return self(obj->scst<BreakStmt>());
 
-    if (auto p = obj->dcst<ContinueStmt>())
-        return self(p);
+    case Stmt::Kind::kContinueStmt:
+        return self(obj->scst<ContinueStmt>());
 
-    if (auto p = obj->dcst<ReturnStmt>())
-        return self(p);
+    case Stmt::Kind::kReturnStmt:
+        return self(obj->scst<ReturnStmt>());
 
-    if (auto p = obj->dcst<NullStmt>())
-    {
-        json::Object ret;
-        ret["kind"] = "NullStmt";
-        return ret;
-    }
+    case Stmt::Kind::kNullStmt:
+        return mOs.object([&] { mOs.attribute("kind", "NullStmt"); });
 
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
-json::Object Asg2Json::operator()(DeclStmt *obj)
+void Asg2Json::operator()(DeclStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "DeclStmt";
-
-    json::Array inner;
-    for (auto &&i : obj->decls)
-        inner.push_back(self(i));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            for (auto &&i : obj->decls)
+                self(i);
+        });
+        mOs.attribute("kind", "DeclStmt");
+    });
 }
 
-json::Object Asg2Json::operator()(ExprStmt *obj)
+void Asg2Json::operator()(ExprStmt *obj)
 {
     assert(obj->expr);
-    return self(obj->expr);
+    self(obj->expr);
 }
 
-json::Object Asg2Json::operator()(CompoundStmt *obj)
+void Asg2Json::operator()(CompoundStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "CompoundStmt";
-
-    json::Array inner;
-    for (auto &&i : obj->subs)
-        inner.push_back(self(i));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            for (auto &&i : obj->subs)
+                self(i);
+        });
+        mOs.attribute("kind", "CompoundStmt");
+    });
 }
 
-json::Object Asg2Json::operator()(IfStmt *obj)
+void Asg2Json::operator()(IfStmt *obj)
 {
     assert(obj->cond && obj->then);
 
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "IfStmt";
-
-    json::Array inner;
-    inner.push_back(self(obj->cond));
-    inner.push_back(self(obj->then));
-    if (obj->else_)
-        inner.push_back(self(obj->else_));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            self(obj->cond);
+            self(obj->then);
+            if (obj->else_)
+                self(obj->else_);
+        });
+        mOs.attribute("kind", "IfStmt");
+    });
 }
 
-json::Object Asg2Json::operator()(WhileStmt *obj)
+void Asg2Json::operator()(WhileStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "WhileStmt";
-
-    json::Array inner;
-    inner.push_back(self(obj->cond));
-    inner.push_back(self(obj->body));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            self(obj->cond);
+            self(obj->body);
+        });
+        mOs.attribute("kind", "WhileStmt");
+    });
 }
 
-json::Object Asg2Json::operator()(DoStmt *obj)
+void Asg2Json::operator()(DoStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "DoStmt";
-
-    json::Array inner;
-    inner.push_back(self(obj->body));
-    inner.push_back(self(obj->cond));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            self(obj->body);
+            self(obj->cond);
+        });
+        mOs.attribute("kind", "DoStmt");
+    });
 }
 
-json::Object Asg2Json::operator()(BreakStmt *obj)
+void Asg2Json::operator()(BreakStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "BreakStmt";
-
-    return ret;
+    mOs.object([&] { mOs.attribute("kind", "BreakStmt"); });
 }
 
-json::Object Asg2Json::operator()(ContinueStmt *obj)
+void Asg2Json::operator()(ContinueStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "ContinueStmt";
-
-    return ret;
+    mOs.object([&] { mOs.attribute("kind", "ContinueStmt"); });
 }
 
-json::Object Asg2Json::operator()(ReturnStmt *obj)
+void Asg2Json::operator()(ReturnStmt *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "ReturnStmt";
-
-    json::Array inner;
-    if (obj->expr)
-        inner.push_back(self(obj->expr));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.object([&] {
+        mOs.attributeArray("inner", [&] {
+            if (obj->expr)
+                self(obj->expr);
+        });
+        mOs.attribute("kind", "ReturnStmt");
+    });
 }
 
 //==============================================================================
 // 声明
 //==============================================================================
 
-json::Object Asg2Json::operator()(Decl *obj)
+void Asg2Json::operator()(Decl *obj)
 {
-    json::Object ret;
-
-    if (auto p = obj->dcst<VarDecl>())
-        ret = std::move(self(p));
-
-    else if (auto p = obj->dcst<FunctionDecl>())
-        ret = std::move(self(p));
+    mOs.object([&] {
+        // 各子类只写出排在 "type" 之前的键：inner、kind、name
+        switch (obj->kind)
+        {
+        case Decl::Kind::kVarDecl:
+            self(obj->scst<VarDecl>());
+            break;
 
-    else
-        ABORT();
+        case Decl::Kind::kFunctionDecl:
+            self(obj->scst<FunctionDecl>());
+            break;
 
-    ret["type"] = json::Object({{"qualType", self(obj->type)}});
+        default:
+            ABORT();
+        }
 
-    return ret;
+        qual_type(obj->type);
+    });
 }
 
-json::Object Asg2Json::operator()(VarDecl *obj)
+void Asg2Json::operator()(VarDecl *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "VarDecl";
-
-    ret["name"] = obj->name;
-
-    json::Array inner;
-    if (obj->init)
-        inner.push_back(self(obj->init));
-    ret["inner"] = std::move(inner);
-
-    return ret;
+    mOs.attributeArray("inner", [&] {
+        if (obj->init)
+            self(obj->init);
+    });
+    mOs.attribute("kind", "VarDecl");
+    mOs.attribute("name", llvm::StringRef(obj->name.str()));
 }
 
-json::Object Asg2Json::operator()(FunctionDecl *obj)
+void Asg2Json::operator()(FunctionDecl *obj)
 {
-    json::Object ret;
     Obj::Walked guard(obj);
 
-    ret["kind"] = "FunctionDecl";
-
-    ret["name"] = obj->name;
-
-    json::Array inner;
-    for (auto &&i : obj->params)
-    {
-        json::Object pobj;
-        pobj["kind"] = "ParmVarDecl";
-        pobj["name"] = i->name;
-        pobj["type"] = json::Object({{"qualType", self(i->type)}});
-
-        inner.push_back(std::move(pobj));
-    }
-
-    if (obj->body)
-        inner.push_back(self(obj->body));
-
-    ret["inner"] = std::move(inner);
+    mOs.attributeArray("inner", [&] {
+        for (auto &&i : obj->params)
+        {
+            mOs.object([&] {
+                mOs.attribute("kind", "ParmVarDecl");
+                mOs.attribute("name", llvm::StringRef(i->name.str()));
+                qual_type(i->type);
+            });
+        }
 
-    return ret;
+        if (obj->body)
+            self(obj->body);
+    });
+    mOs.attribute("kind", "FunctionDecl");
+    mOs.attribute("name", llvm::StringRef(obj->name.str()));
 }
 
 } // namespace asg
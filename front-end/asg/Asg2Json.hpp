@@ -6,12 +6,29 @@ namespace asg
 
 namespace json = llvm::json;
 
+/**
+ * @brief 把 ASG 以 JSON 格式直接写到输出流
+ *
+ * 边遍历边通过 json::OStream 写出，不在内存中建立 json::Object 树。输出与
+ * json::Value 的紧凑打印逐字节相同，因此每个对象的键都按字母序写出。类型
+ * 字符串按 Type* 缓存，类型已经哈希合并，相同的类型只渲染一次。
+ */
 class Asg2Json
 {
   public:
-    json::Object operator()(TranslationUnit *tu);
+    Asg2Json(llvm::raw_ostream &os) : mOs(os)
+    {
+    }
+
+    void operator()(TranslationUnit *tu);
 
   private:
+    json::OStream mOs;
+    std::unordered_map<const Type *, std::string> mQualTypes; /// 类型字符串的缓存
+
+    /// 写出 "type": {"qualType": ...}
+    void qual_type(const Type *type);
+
     //============================================================================
     // 类型
     //============================================================================
@@ -24,61 +41,61 @@ class Asg2Json
     // 表达式
     //============================================================================
 
-    json::Object operator()(Expr *obj);
+    void operator()(Expr *obj);
 
-    json::Object operator()(IntegerLiteral *obj);
+    void operator()(IntegerLiteral *obj);
 
-    json::Object operator()(StringLiteral *obj);
+    void operator()(StringLiteral *obj);
 
-    json::Object operator()(ParenExpr *obj);
+    void operator()(ParenExpr *obj);
 
-    json::Object operator()(DeclRefExpr *obj);
+    void operator()(DeclRefExpr *obj);
 
-    json::Object operator()(UnaryExpr *obj);
+    void operator()(UnaryExpr *obj);
 
-    json::Object operator()(BinaryExpr *obj);
+    void operator()(BinaryExpr *obj);
 
-    json::Object operator()(CallExpr *obj);
+    void operator()(CallExpr *obj);
 
-    json::Object operator()(InitListExpr *obj);
+    void operator()(InitListExpr *obj);
 
-    json::Object operator()(ImplicitInitExpr *obj);
+    void operator()(ImplicitInitExpr *obj);
 
-    json::Object operator()(ImplicitCastExpr *obj);
+    void operator()(ImplicitCastExpr *obj);
 
     //============================================================================
     // 语句
     //============================================================================
 
-    json::Object operator()(Stmt *obj);
+    void operator()(Stmt *obj);
 
-    json::Object operator()(DeclStmt *obj);
+    void operator()(DeclStmt *obj);
 
-    json::Object operator()(ExprStmt *obj);
+    void operator()(ExprStmt *obj);
 
-    json::Object operator()(CompoundStmt *obj);
+    void operator()(CompoundStmt *obj);
 
-    json::Object operator()(IfStmt *obj);
+    void operator()(IfStmt *obj);
 
-    json::Object operator()(WhileStmt *obj);
+    void operator()(WhileStmt *obj);
 
-    json::Object operator()(DoStmt *obj);
+    void operator()(DoStmt *obj);
 
-    json::Object operator()(BreakStmt *obj);
+    void operator()(BreakStmt *obj);
 
-    json::Object operator()(ContinueStmt *obj);
+    void operator()(ContinueStmt *obj);
 
-    json::Object operator()(ReturnStmt *obj);
+    void operator()(ReturnStmt *obj);
 
     //============================================================================
     // 声明
     //============================================================================
 
-    json::Object operator()(Decl *obj);
+    void operator()(Decl *obj);
 
-    json::Object operator()(VarDecl *obj);
+    void operator()(VarDecl *obj);
 
-    json::Object operator()(FunctionDecl *obj);
+    void operator()(FunctionDecl *obj);
 };
 
 } // namespace asg
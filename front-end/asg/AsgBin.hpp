@@ -0,0 +1,91 @@
+#pragma once
+
+#include "asg.hpp"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief ASG 的二进制格式，由 Asg2Bin 写出、Bin2Asg 读入
+ *
+ * 文件由 32 位字组成，按本机字节序存储，依次是：
+ *
+ *   1. 文件头 Header；
+ *   2. 字符串表：nStrings + 1 个偏移，随后是 nBytes 字节的字符串内容，补齐到
+ *      4 字节。第 i 个字符串是内容中 [offsets[i], offsets[i + 1]) 的部分；
+ *   3. 类型表：nTypes 条记录，共 nTypeWords 个字。每条记录以一个标签开头，
+ *      标签为 TypeExpr::Kind，kINVALID 表示 Type 本身：
+ *        Type          spec, const, texp
+ *        PointerType   const, sub
+ *        ArrayType     len, sub
+ *        FunctionType  sub, n, params[n]
+ *      记录只引用排在它前面的记录，所以可以顺序地交给 Type::Cache 规范化，
+ *      结构相同的类型在文件中只出现一次；
+ *   4. 结点种类表：nNodes 个字节的结点标签（见 node_tag），补齐到 4 字节；
+ *   5. 结点表：nNodes 条记录，共 nNodeWords 个字，字段见 Asg2Bin.cpp。
+ *
+ * 记录中对类型和结点的引用都存为下标加一，0 表示空指针；对字符串的引用存为
+ * 下标。因为先有种类表，读入时可以先创建所有结点，再顺序扫描一遍结点表填入
+ * 字段，DeclRefExpr::decl、BreakStmt::loop 等交叉引用无论指向前后都能直接
+ * 解析。
+ */
+namespace asg::bin
+{
+
+/// "SASG"，同时用来检查字节序
+constexpr std::uint32_t kMagic = 0x47534153;
+
+/// 格式有不兼容的改动时加一
+constexpr std::uint32_t kVersion = 1;
+
+struct Header
+{
+    std::uint32_t magic{kMagic};
+    std::uint32_t version{kVersion};
+    std::uint32_t nStrings{0};
+    std::uint32_t nBytes{0};
+    std::uint32_t nTypes{0};
+    std::uint32_t nTypeWords{0};
+    std::uint32_t nNodes{0};
+    std::uint32_t nNodeWords{0};
+    std::uint32_t root{0}; /// TranslationUnit 的结点下标
+};
+
+/// 结点标签的高 4 位是类别，低 4 位是该类别中的种类标签
+enum : std::uint8_t
+{
+    kDeclTag = 0x00,
+    kExprTag = 0x10,
+    kStmtTag = 0x20,
+    kTranslationUnitTag = 0x30,
+};
+
+static_assert(std::uint8_t(Expr::Kind::kImplicitCastExpr) < 16 && std::uint8_t(Stmt::Kind::kReturnStmt) < 16 &&
+                  std::uint8_t(Decl::Kind::kFunctionDecl) < 16,
+              "种类标签超出 4 位，需要修改标签的编码并增加 kVersion");
+
+constexpr std::uint8_t node_tag(Decl::Kind kind)
+{
+    return kDeclTag | std::uint8_t(kind);
+}
+
+constexpr std::uint8_t node_tag(Expr::Kind kind)
+{
+    return kExprTag | std::uint8_t(kind);
+}
+
+constexpr std::uint8_t node_tag(Stmt::Kind kind)
+{
+    return kStmtTag | std::uint8_t(kind);
+}
+
+/// \p data 是否以二进制 ASG 的文件头开始
+inline bool is_asg_bin(const void *data, std::size_t size)
+{
+    Header header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    return header.magic == kMagic;
+}
+
+} // namespace asg::bin
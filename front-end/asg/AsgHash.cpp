@@ -0,0 +1,265 @@
+#include "AsgHash.hpp"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallString.h>
+
+namespace asg
+{
+
+std::string AsgHash::operator()(FunctionDecl *func)
+{
+    mMd5 = llvm::MD5();
+    mLocals.clear();
+
+    string(mSalt);
+    string(func->name.str());
+    type(func->type);
+    word(func->params.size());
+    for (auto &&i : func->params)
+        local(i);
+    stmt(func->body);
+
+    llvm::MD5::MD5Result result;
+    mMd5.final(result);
+    return std::string(result.digest());
+}
+
+void AsgHash::word(std::uint64_t val)
+{
+    mMd5.update(llvm::ArrayRef<std::uint8_t>(reinterpret_cast<const std::uint8_t *>(&val), sizeof(val)));
+}
+
+void AsgHash::string(std::string_view str)
+{
+    word(str.size());
+    mMd5.update(llvm::StringRef(str.data(), str.size()));
+}
+
+void AsgHash::type(const Type *type)
+{
+    if (type == nullptr)
+    {
+        word(0);
+        return;
+    }
+    word(1);
+    word(std::uint64_t(type->spec));
+    word(type->qual.const_);
+    texp(type->texp);
+}
+
+void AsgHash::texp(TypeExpr *texp)
+{
+    for (; texp; texp = texp->sub)
+    {
+        word(std::uint64_t(texp->kind));
+        switch (texp->kind)
+        {
+        case TypeExpr::Kind::kPointerType:
+            word(texp->scst<PointerType>()->qual.const_);
+            break;
+
+        case TypeExpr::Kind::kArrayType:
+            word(texp->scst<ArrayType>()->len);
+            break;
+
+        case TypeExpr::Kind::kFunctionType: {
+            auto &params = texp->scst<FunctionType>()->params;
+            word(params.size());
+            for (auto &&i : params)
+                type(i);
+        }
+        break;
+
+        default:
+            ABORT();
+        }
+    }
+    word(0);
+}
+
+void AsgHash::expr(Expr *obj)
+{
+    // 子结点逆序压栈，弹出的顺序就是前序
+    auto base = mStack.size();
+    mStack.push_back(obj);
+    while (mStack.size() > base)
+    {
+        auto i = mStack.back();
+        mStack.pop_back();
+        if (i == nullptr)
+        {
+            word(0);
+            continue;
+        }
+
+        word(std::uint64_t(i->kind));
+        word(std::uint64_t(i->cate));
+        type(i->type);
+        switch (i->kind)
+        {
+        case Expr::Kind::kIntegerLiteral:
+            word(i->scst<IntegerLiteral>()->val);
+            break;
+
+        case Expr::Kind::kStringLiteral:
+            string(i->scst<StringLiteral>()->val);
+            break;
+
+        case Expr::Kind::kDeclRefExpr:
+            ref(i->scst<DeclRefExpr>()->decl);
+            break;
+
+        case Expr::Kind::kParenExpr:
+            mStack.push_back(i->scst<ParenExpr>()->sub);
+            break;
+
+        case Expr::Kind::kUnaryExpr: {
+            auto p = i->scst<UnaryExpr>();
+            word(p->op);
+            mStack.push_back(p->sub);
+        }
+        break;
+
+        case Expr::Kind::kBinaryExpr: {
+            auto p = i->scst<BinaryExpr>();
+            word(p->op);
+            mStack.push_back(p->rht);
+            mStack.push_back(p->lft);
+        }
+        break;
+
+        case Expr::Kind::kCallExpr: {
+            auto p = i->scst<CallExpr>();
+            word(p->args.size());
+            mStack.insert(mStack.end(), p->args.rbegin(), p->args.rend());
+            mStack.push_back(p->head);
+        }
+        break;
+
+        case Expr::Kind::kInitListExpr: {
+            auto &list = i->scst<InitListExpr>()->list;
+            word(list.size());
+            mStack.insert(mStack.end(), list.rbegin(), list.rend());
+        }
+        break;
+
+        case Expr::Kind::kImplicitInitExpr:
+            break;
+
+        case Expr::Kind::kImplicitCastExpr: {
+            auto p = i->scst<ImplicitCastExpr>();
+            word(p->castKind);
+            mStack.push_back(p->sub);
+        }
+        break;
+
+        default:
+            ABORT();
+        }
+    }
+}
+
+void AsgHash::stmt(Stmt *obj)
+{
+    if (obj == nullptr)
+    {
+        word(0);
+        return;
+    }
+
+    word(std::uint64_t(obj->kind));
+    switch (obj->kind)
+    {
+    case Stmt::Kind::kNullStmt:
+        break;
+
+    case Stmt::Kind::kDeclStmt: {
+        auto &decls = obj->scst<DeclStmt>()->decls;
+        word(decls.size());
+        for (auto &&i : decls)
+        {
+            local(i);
+            if (auto var = kcst<VarDecl>(i))
+                expr(var->init);
+        }
+    }
+    break;
+
+    case Stmt::Kind::kExprStmt:
+        expr(obj->scst<ExprStmt>()->expr);
+        break;
+
+    case Stmt::Kind::kCompoundStmt: {
+        auto &subs = obj->scst<CompoundStmt>()->subs;
+        word(subs.size());
+        for (auto &&i : subs)
+            stmt(i);
+    }
+    break;
+
+    case Stmt::Kind::kIfStmt: {
+        auto p = obj->scst<IfStmt>();
+        expr(p->cond);
+        stmt(p->then);
+        stmt(p->else_);
+    }
+    break;
+
+    case Stmt::Kind::kWhileStmt: {
+        auto p = obj->scst<WhileStmt>();
+        mLocals.emplace(p, mLocals.size());
+        expr(p->cond);
+        stmt(p->body);
+    }
+    break;
+
+    case Stmt::Kind::kDoStmt: {
+        auto p = obj->scst<DoStmt>();
+        mLocals.emplace(p, mLocals.size());
+        stmt(p->body);
+        expr(p->cond);
+    }
+    break;
+
+    case Stmt::Kind::kBreakStmt:
+    case Stmt::Kind::kContinueStmt: {
+        auto loop = obj->kind == Stmt::Kind::kBreakStmt ? obj->scst<BreakStmt>()->loop
+                                                         : obj->scst<ContinueStmt>()->loop;
+        auto it = mLocals.find(loop);
+        word(it == mLocals.end() ? UINT64_MAX : it->second);
+    }
+    break;
+
+    case Stmt::Kind::kReturnStmt:
+        expr(obj->scst<ReturnStmt>()->expr);
+        break;
+
+    default:
+        ABORT();
+    }
+}
+
+void AsgHash::local(Decl *obj)
+{
+    mLocals.emplace(obj, mLocals.size());
+    string(obj->name.str());
+    type(obj->type);
+}
+
+void AsgHash::ref(Decl *obj)
+{
+    if (auto it = mLocals.find(obj); it != mLocals.end())
+    {
+        word(1);
+        word(it->second);
+        return;
+    }
+
+    word(2);
+    string(obj->name.str());
+    type(obj->type);
+    if (auto var = kcst<VarDecl>(obj); var && var->type->qual.const_)
+        expr(var->init);
+}
+
+} // namespace asg
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "asg.hpp"
+#include <llvm/Support/MD5.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace asg
+{
+
+/**
+ * @brief 类型推导后的函数的结构哈希，用作 IR 缓存的键
+ *
+ * 前序遍历函数，把结点的种类、运算符、字面量、名字和类型的结构依次喂给 MD5，
+ * 结果与结点的地址无关。函数内的参数、局部变量和循环按出现的顺序编号，引用
+ * 它们时只哈希编号；引用的全局变量和函数哈希名字和类型，也就是函数的 IR 所依赖
+ * 的签名，const 全局变量还要哈希初始化表达式，以备优化时传播其中的常量。表达式
+ * 用显式栈遍历，很长的表达式链也不会递归过深。
+ */
+class AsgHash
+{
+  public:
+    /// \p salt 区分编译器的版本和影响生成代码的配置
+    AsgHash(std::string salt) : mSalt(std::move(salt))
+    {
+    }
+
+    /// 返回 32 个十六进制数字的摘要
+    std::string operator()(FunctionDecl *func);
+
+  private:
+    std::string mSalt;
+    llvm::MD5 mMd5;
+
+    /// 局部声明和循环的编号
+    std::unordered_map<const Obj *, std::uint64_t> mLocals;
+
+    /// 待哈希的表达式，见 expr
+    std::vector<Expr *> mStack;
+
+    void word(std::uint64_t val);
+    void string(std::string_view str);
+
+    void type(const Type *type);
+    void texp(TypeExpr *texp);
+
+    void expr(Expr *obj);
+    void stmt(Stmt *obj);
+
+    /// 编号并哈希函数内的声明 \p obj
+    void local(Decl *obj);
+
+    /// 哈希对声明 \p obj 的引用
+    void ref(Decl *obj);
+};
+
+} // namespace asg
@@ -0,0 +1,478 @@
+#include "Bin2Asg.hpp"
+#include <iostream>
+#include <type_traits>
+
+namespace asg
+{
+
+TranslationUnit *Bin2Asg::operator()(llvm::StringRef data)
+{
+    mBegin = mCur = data.begin();
+    mEnd = data.end();
+
+    bin::Header header;
+    if (std::size_t(mEnd - mCur) < sizeof(header))
+        error("header");
+    std::memcpy(&header, mCur, sizeof(header));
+    mCur += sizeof(header);
+    if (header.magic != bin::kMagic)
+        error("magic");
+    if (header.version != bin::kVersion)
+        error("version");
+
+    strings(header.nStrings, header.nBytes);
+
+    auto typesBegin = mCur;
+    types(header.nTypes);
+    if (std::size_t(mCur - typesBegin) != header.nTypeWords * sizeof(std::uint32_t))
+        error("end of types");
+
+    // 先按种类表创建所有结点，交叉引用便可以随意指向前后
+    if (std::size_t(mEnd - mCur) < header.nNodes)
+        error("node tags");
+    mTags = reinterpret_cast<const std::uint8_t *>(mCur);
+    mCur += (header.nNodes + 3) / 4 * 4;
+    mNodes.reserve(header.nNodes);
+    for (std::uint32_t i = 0; i < header.nNodes; ++i)
+        mNodes.push_back(make(mTags[i]));
+
+    auto nodesBegin = mCur;
+    for (std::uint32_t i = 0; i < header.nNodes; ++i)
+        record(i);
+    if (std::size_t(mCur - nodesBegin) != header.nNodeWords * sizeof(std::uint32_t) || mCur != mEnd)
+        error("end of nodes");
+
+    if (header.root >= header.nNodes || mTags[header.root] != bin::kTranslationUnitTag)
+        error("root");
+    return static_cast<TranslationUnit *>(mNodes[header.root]);
+}
+
+std::uint32_t Bin2Asg::word()
+{
+    if (mEnd - mCur < 4)
+        error("word");
+    std::uint32_t ret;
+    std::memcpy(&ret, mCur, sizeof(ret));
+    mCur += sizeof(ret);
+    return ret;
+}
+
+void Bin2Asg::error(const char *what)
+{
+    std::cerr << "offset " << (mCur - mBegin) << ": bad binary ASG " << what << '\n';
+    ABORT();
+}
+
+//==============================================================================
+// 表
+//==============================================================================
+
+void Bin2Asg::strings(std::uint32_t n, std::uint32_t nBytes)
+{
+    if (n >= std::size_t(mEnd - mCur) / sizeof(std::uint32_t))
+        error("string count");
+    std::vector<std::uint32_t> offsets(n + 1);
+    for (auto &&i : offsets)
+        i = word();
+
+    if (std::size_t(mEnd - mCur) < nBytes)
+        error("strings");
+    mStrings.reserve(n);
+    for (std::uint32_t i = 0; i < n; ++i)
+    {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > nBytes)
+            error("string offset");
+        mStrings.emplace_back(mCur + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    mIdents.resize(n);
+    mCur += (std::size_t(nBytes) + 3) / 4 * 4;
+}
+
+void Bin2Asg::types(std::uint32_t n)
+{
+    // 每条记录至少两个字
+    if (n > std::size_t(mEnd - mCur) / (2 * sizeof(std::uint32_t)))
+        error("type count");
+    mTypes.resize(n);
+    mTexps.resize(n);
+
+    for (std::uint32_t i = 0; i < n; ++i)
+    {
+        // 每条记录只能引用前面的记录
+        auto earlier = [&](std::uint32_t ref) {
+            if (ref > i)
+                error("type reference");
+            return ref;
+        };
+
+        switch (TypeExpr::Kind(word()))
+        {
+        case TypeExpr::Kind::kINVALID: {
+            auto spec = word();
+            if (spec > std::uint32_t(Type::Spec::kLongLong))
+                error("type specifier");
+            Type::Qual qual;
+            qual.const_ = word();
+            mTypes[i] = mTypeCache(Type::Spec(spec), qual, texp(earlier(word())));
+            break;
+        }
+
+        case TypeExpr::Kind::kPointerType: {
+            Type::Qual qual;
+            qual.const_ = word();
+            mTexps[i] = mTypeCache.pointer(qual, texp(earlier(word())));
+            break;
+        }
+
+        case TypeExpr::Kind::kArrayType: {
+            auto len = word();
+            mTexps[i] = mTypeCache.array(len, texp(earlier(word())));
+            break;
+        }
+
+        case TypeExpr::Kind::kFunctionType: {
+            auto sub = texp(earlier(word()));
+            auto n = word();
+            if (n > std::size_t(mEnd - mCur) / sizeof(std::uint32_t))
+                error("parameter count");
+            std::vector<const Type *> params(n);
+            for (auto &&j : params)
+                j = type(earlier(word()));
+            mTexps[i] = mTypeCache.function(sub, std::move(params));
+            break;
+        }
+
+        default:
+            error("type tag");
+        }
+    }
+}
+
+Obj *Bin2Asg::make(std::uint8_t tag)
+{
+    auto kind = tag & 0x0F;
+
+    switch (tag & 0xF0)
+    {
+    case bin::kTranslationUnitTag:
+        if (kind == 0)
+            return mMgr.make<TranslationUnit>();
+        break;
+
+    case bin::kDeclTag:
+        switch (Decl::Kind(kind))
+        {
+        case Decl::Kind::kVarDecl:
+            return mMgr.make<VarDecl>();
+        case Decl::Kind::kFunctionDecl:
+            return mMgr.make<FunctionDecl>();
+        default:
+            break;
+        }
+        break;
+
+    case bin::kExprTag:
+        switch (Expr::Kind(kind))
+        {
+        case Expr::Kind::kIntegerLiteral:
+            return mMgr.make<IntegerLiteral>();
+        case Expr::Kind::kStringLiteral:
+            return mMgr.make<StringLiteral>();
+        case Expr::Kind::kDeclRefExpr:
+            return mMgr.make<DeclRefExpr>();
+        case Expr::Kind::kParenExpr:
+            return mMgr.make<ParenExpr>();
+        case Expr::Kind::kUnaryExpr:
+            return mMgr.make<UnaryExpr>();
+        case Expr::Kind::kBinaryExpr:
+            return mMgr.make<BinaryExpr>();
+        case Expr::Kind::kCallExpr:
+            return mMgr.make<CallExpr>();
+        case Expr::Kind::kInitListExpr:
+            return mMgr.make<InitListExpr>();
+        case Expr::Kind::kImplicitInitExpr:
+            return mMgr.make<ImplicitInitExpr>();
+        case Expr::Kind::kImplicitCastExpr:
+            return mMgr.make<ImplicitCastExpr>();
+        default:
+            break;
+        }
+        break;
+
+    case bin::kStmtTag:
+        switch (Stmt::Kind(kind))
+        {
+        case Stmt::Kind::kNullStmt:
+            return mMgr.make<NullStmt>();
+        case Stmt::Kind::kDeclStmt:
+            return mMgr.make<DeclStmt>();
+        case Stmt::Kind::kExprStmt:
+            return mMgr.make<ExprStmt>();
+        case Stmt::Kind::kCompoundStmt:
+            return mMgr.make<CompoundStmt>();
+        case Stmt::Kind::kIfStmt:
+            return mMgr.make<IfStmt>();
+        case Stmt::Kind::kWhileStmt:
+            return mMgr.make<WhileStmt>();
+        case Stmt::Kind::kDoStmt:
+            return mMgr.make<DoStmt>();
+        case Stmt::Kind::kBreakStmt:
+            return mMgr.make<BreakStmt>();
+        case Stmt::Kind::kContinueStmt:
+            return mMgr.make<ContinueStmt>();
+        case Stmt::Kind::kReturnStmt:
+            return mMgr.make<ReturnStmt>();
+        default:
+            break;
+        }
+        break;
+    }
+
+    error("node tag");
+}
+
+void Bin2Asg::record(std::uint32_t i)
+{
+    auto obj = mNodes[i];
+    auto tag = mTags[i];
+
+    if (tag == bin::kTranslationUnitTag)
+        return nodes(static_cast<TranslationUnit *>(obj)->decls, &Bin2Asg::decl);
+
+    if (tag < bin::kExprTag)
+    {
+        auto p = static_cast<Decl *>(obj);
+        p->name = ident(word());
+        p->type = type(word());
+
+        if (auto q = kcst<VarDecl>(p))
+            q->init = expr(word());
+        else if (auto q = kcst<FunctionDecl>(p))
+        {
+            nodes(q->params, &Bin2Asg::decl);
+            q->body = leaf<CompoundStmt>(word());
+        }
+        return;
+    }
+
+    if (tag < bin::kStmtTag)
+    {
+        auto p = static_cast<Expr *>(obj);
+        p->type = type(word());
+        auto cate = word();
+        if (cate > std::uint32_t(Expr::Cate::kLValue))
+            error("value category");
+        p->cate = Expr::Cate(cate);
+
+        switch (p->kind)
+        {
+        case Expr::Kind::kIntegerLiteral: {
+            std::uint64_t lo = word(), hi = word();
+            p->scst<IntegerLiteral>()->val = lo | hi << 32;
+            break;
+        }
+
+        case Expr::Kind::kStringLiteral:
+            p->scst<StringLiteral>()->val = string(word());
+            break;
+
+        case Expr::Kind::kDeclRefExpr:
+            p->scst<DeclRefExpr>()->decl = decl(word());
+            break;
+
+        case Expr::Kind::kParenExpr:
+            p->scst<ParenExpr>()->sub = expr(word());
+            break;
+
+        case Expr::Kind::kUnaryExpr: {
+            auto q = p->scst<UnaryExpr>();
+            q->op = UnaryExpr::Op(word());
+            q->sub = expr(word());
+            break;
+        }
+
+        case Expr::Kind::kBinaryExpr: {
+            auto q = p->scst<BinaryExpr>();
+            q->op = BinaryExpr::Op(word());
+            q->lft = expr(word());
+            q->rht = expr(word());
+            break;
+        }
+
+        case Expr::Kind::kCallExpr: {
+            auto q = p->scst<CallExpr>();
+            q->head = expr(word());
+            nodes(q->args, &Bin2Asg::expr);
+            break;
+        }
+
+        case Expr::Kind::kInitListExpr:
+            nodes(p->scst<InitListExpr>()->list, &Bin2Asg::expr);
+            break;
+
+        case Expr::Kind::kImplicitInitExpr:
+            break;
+
+        case Expr::Kind::kImplicitCastExpr: {
+            auto q = p->scst<ImplicitCastExpr>();
+            q->castKind = decltype(q->castKind)(word());
+            q->sub = expr(word());
+            break;
+        }
+
+        default:
+            ABORT();
+        }
+        return;
+    }
+
+    auto p = static_cast<Stmt *>(obj);
+    switch (p->kind)
+    {
+    case Stmt::Kind::kNullStmt:
+        break;
+
+    case Stmt::Kind::kDeclStmt:
+        nodes(p->scst<DeclStmt>()->decls, &Bin2Asg::decl);
+        break;
+
+    case Stmt::Kind::kExprStmt:
+        p->scst<ExprStmt>()->expr = expr(word());
+        break;
+
+    case Stmt::Kind::kCompoundStmt:
+        nodes(p->scst<CompoundStmt>()->subs, &Bin2Asg::stmt);
+        break;
+
+    case Stmt::Kind::kIfStmt: {
+        auto q = p->scst<IfStmt>();
+        q->cond = expr(word());
+        q->then = stmt(word());
+        q->else_ = stmt(word());
+        break;
+    }
+
+    case Stmt::Kind::kWhileStmt: {
+        auto q = p->scst<WhileStmt>();
+        q->cond = expr(word());
+        q->body = stmt(word());
+        break;
+    }
+
+    case Stmt::Kind::kDoStmt: {
+        auto q = p->scst<DoStmt>();
+        q->body = stmt(word());
+        q->cond = expr(word());
+        break;
+    }
+
+    case Stmt::Kind::kBreakStmt:
+        p->scst<BreakStmt>()->loop = stmt(word());
+        break;
+
+    case Stmt::Kind::kContinueStmt:
+        p->scst<ContinueStmt>()->loop = stmt(word());
+        break;
+
+    case Stmt::Kind::kReturnStmt: {
+        auto q = p->scst<ReturnStmt>();
+        q->func = leaf<FunctionDecl>(word());
+        q->expr = expr(word());
+        break;
+    }
+
+    default:
+        ABORT();
+    }
+}
+
+//==============================================================================
+// 引用
+//==============================================================================
+
+std::string_view Bin2Asg::string(std::uint32_t id)
+{
+    if (id >= mStrings.size())
+        error("string reference");
+    return mStrings[id];
+}
+
+Ident Bin2Asg::ident(std::uint32_t id)
+{
+    auto str = string(id);
+    auto &ret = mIdents[id];
+    if (ret.empty() && !str.empty())
+        ret = Ident(str);
+    return ret;
+}
+
+const Type *Bin2Asg::type(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    if (ref > mTypes.size() || mTypes[ref - 1] == nullptr)
+        error("type reference");
+    return mTypes[ref - 1];
+}
+
+TypeExpr *Bin2Asg::texp(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    if (ref > mTexps.size() || mTexps[ref - 1] == nullptr)
+        error("type expression reference");
+    return mTexps[ref - 1];
+}
+
+Decl *Bin2Asg::decl(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    if (ref > mNodes.size() || (mTags[ref - 1] & 0xF0) != bin::kDeclTag)
+        error("declaration reference");
+    return static_cast<Decl *>(mNodes[ref - 1]);
+}
+
+Expr *Bin2Asg::expr(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    if (ref > mNodes.size() || (mTags[ref - 1] & 0xF0) != bin::kExprTag)
+        error("expression reference");
+    return static_cast<Expr *>(mNodes[ref - 1]);
+}
+
+Stmt *Bin2Asg::stmt(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    if (ref > mNodes.size() || (mTags[ref - 1] & 0xF0) != bin::kStmtTag)
+        error("statement reference");
+    return static_cast<Stmt *>(mNodes[ref - 1]);
+}
+
+template <typename T> T *Bin2Asg::leaf(std::uint32_t ref)
+{
+    if (ref == 0)
+        return nullptr;
+    T *ret;
+    if constexpr (std::is_base_of_v<Decl, T>)
+        ret = kcst<T>(decl(ref));
+    else
+        ret = kcst<T>(stmt(ref));
+    if (ret == nullptr)
+        error("node kind");
+    return ret;
+}
+
+template <typename T> void Bin2Asg::nodes(std::vector<T *> &objs, T *(Bin2Asg::*get)(std::uint32_t))
+{
+    auto n = word();
+    if (n > std::size_t(mEnd - mCur) / sizeof(std::uint32_t))
+        error("count");
+    objs.reserve(n);
+    for (std::uint32_t i = 0; i < n; ++i)
+        objs.push_back((this->*get)(word()));
+}
+
+} // namespace asg
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "AsgBin.hpp"
+#include <llvm/ADT/StringRef.h>
+#include <string_view>
+#include <vector>
+
+namespace asg
+{
+
+/**
+ * @brief 从二进制格式（见 AsgBin.hpp）读入 ASG
+ *
+ * 输入通常是 llvm::MemoryBuffer 映射的文件内容，字符串直接引用其中的字节。
+ * 先按种类表创建所有结点，再顺序扫描一遍结点表填入字段，类型记录逐条交给
+ * Type::Cache 规范化，不需要再解析类型字符串。输入不合法时打印出错位置后
+ * 中止。
+ */
+class Bin2Asg
+{
+  public:
+    Obj::Mgr &mMgr;
+    Type::Cache &mTypeCache;
+
+    Bin2Asg(Obj::Mgr &mgr, Type::Cache &typeCache) : mMgr(mgr), mTypeCache(typeCache)
+    {
+    }
+
+    TranslationUnit *operator()(llvm::StringRef data);
+
+  private:
+    const char *mBegin{nullptr}, *mCur{nullptr}, *mEnd{nullptr};
+
+    std::vector<std::string_view> mStrings;
+    std::vector<Ident> mIdents; /// 用到时才驻留
+
+    /// 类型表，每条记录只填两者之一
+    std::vector<const Type *> mTypes;
+    std::vector<TypeExpr *> mTexps;
+
+    std::vector<Obj *> mNodes;
+    const std::uint8_t *mTags{nullptr};
+
+    std::uint32_t word();
+
+    [[noreturn]] void error(const char *what);
+
+    //============================================================================
+    // 表
+    //============================================================================
+
+    void strings(std::uint32_t n, std::uint32_t nBytes);
+
+    void types(std::uint32_t n);
+
+    Obj *make(std::uint8_t tag);
+
+    /// 填入第 \p i 个结点的字段
+    void record(std::uint32_t i);
+
+    //============================================================================
+    // 引用
+    //============================================================================
+
+    std::string_view string(std::uint32_t id);
+
+    Ident ident(std::uint32_t id);
+
+    /// 以下的 \p ref 都是下标加一，0 表示空指针
+    const Type *type(std::uint32_t ref);
+
+    TypeExpr *texp(std::uint32_t ref);
+
+    Decl *decl(std::uint32_t ref);
+
+    Expr *expr(std::uint32_t ref);
+
+    Stmt *stmt(std::uint32_t ref);
+
+    /// 种类必须是 \p T 的结点
+    template <typename T> T *leaf(std::uint32_t ref);
+
+    /// 读入个数和随后的结点引用
+    template <typename T> void nodes(std::vector<T *> &objs, T *(Bin2Asg::*get)(std::uint32_t));
+};
+
+} // namespace asg
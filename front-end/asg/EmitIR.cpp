@@ -1,5 +1,12 @@
 #include "EmitIR.hpp"
+#include <algorithm>
+#include <atomic>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/Linker/Linker.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
+#include <thread>
 
 #define self (*this)
 
@@ -12,13 +19,92 @@ EmitIR::EmitIR(Obj::Mgr &mgr, llvm::LLVMContext &ctx, llvm::StringRef mid)
 {
 }
 
-llvm::Module &EmitIR::operator()(TranslationUnit *tu)
+llvm::Module &EmitIR::operator()(TranslationUnit *tu, unsigned jobs)
 {
-    for (auto &&i : tu->decls)
-        self(i);
+    if (jobs <= 1)
+    {
+        for (auto &&i : tu->decls)
+            self(i);
+        return mMod;
+    }
+
+    auto funcs = prototypes(tu);
+
+    // 按源码顺序把函数体分成若干段，每段发射到一个分片中。分片太小时读回和链接
+    // 的开销会超过发射本身，所以只比线程数多几倍，够各线程互相补齐快慢即可
+    auto nShards = std::min<std::size_t>(funcs.size(), std::size_t(jobs) * kShardsPerJob);
+    auto shard_begin = [&](std::size_t i) { return funcs.size() * i / nShards; };
+
+    // 函数体中的局部声明和语句只属于一个函数，在各线程中修改它们的 any 不会冲突
+    std::vector<llvm::SmallVector<char, 0>> bitcodes(nShards);
+    std::atomic<std::size_t> next{0};
+    {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < std::min<std::size_t>(jobs, nShards); ++i)
+            workers.emplace_back(
+                [&]
+                {
+                    llvm::LLVMContext ctx;
+                    for (std::size_t j; (j = next.fetch_add(1, std::memory_order_relaxed)) < nShards;)
+                    {
+                        EmitIR shard(mMgr, ctx, funcs[shard_begin(j)]->name.str());
+                        shard.mSsa = mSsa;
+                        shard.mMod.setTargetTriple(mMod.getTargetTriple());
+                        shard.mMod.setDataLayout(mMod.getDataLayout());
+                        shard.bodies({funcs.data() + shard_begin(j), funcs.data() + shard_begin(j + 1)});
+
+                        llvm::raw_svector_ostream os(bitcodes[j]);
+                        llvm::WriteBitcodeToFile(shard.mMod, os);
+                    }
+                });
+        for (auto &&i : workers)
+            i.join();
+    }
+
+    // 分片中的函数体取代主模块中的原型；各段按源码顺序链接，函数的顺序与分段无关
+    llvm::Linker linker(mMod);
+    for (std::size_t i = 0; i < nShards; ++i)
+    {
+        llvm::StringRef data(bitcodes[i].data(), bitcodes[i].size());
+        auto mod = llvm::parseBitcodeFile(llvm::MemoryBufferRef(data, "shard"), mCtx);
+        if (!mod)
+        {
+            llvm::logAllUnhandledErrors(mod.takeError(), llvm::errs());
+            ABORT();
+        }
+        if (linker.linkInModule(std::move(*mod)))
+            ABORT();
+        bitcodes[i] = {};
+    }
+
     return mMod;
 }
 
+std::vector<FunctionDecl *> EmitIR::prototypes(TranslationUnit *tu)
+{
+    std::vector<FunctionDecl *> funcs;
+    for (auto &&i : tu->decls)
+    {
+        if (i->kind != Decl::Kind::kFunctionDecl || i->scst<FunctionDecl>()->body == nullptr)
+        {
+            self(i);
+            continue;
+        }
+
+        auto fty = llvm::cast<llvm::FunctionType>(self(i->type));
+        i->any = llvm::Function::Create(fty, llvm::GlobalVariable::ExternalLinkage, i->name.str(), mMod);
+        funcs.push_back(i->scst<FunctionDecl>());
+    }
+    return funcs;
+}
+
+void EmitIR::bodies(llvm::ArrayRef<FunctionDecl *> funcs)
+{
+    mShard = true;
+    for (auto &&i : funcs)
+        body(i, llvm::cast<llvm::Function>(declare(i)));
+}
+
 //==============================================================================
 // 类型
 //==============================================================================
@@ -45,17 +131,17 @@ llvm::Type *EmitIR::operator()(const Type *type)
     subt.qual = type->qual;
     subt.texp = type->texp->sub;
 
-    if (auto p = type->texp->dcst<PointerType>())
+    if (auto p = kcst<PointerType>(type->texp))
     {
         return llvm::PointerType::get(self(&subt), 0);
     }
 
-    if (auto p = type->texp->dcst<ArrayType>())
+    if (auto p = kcst<ArrayType>(type->texp))
     {
         return llvm::ArrayType::get(self(&subt), p->len);
     }
 
-    if (auto p = type->texp->dcst<FunctionType>())
+    if (auto p = kcst<FunctionType>(type->texp))
     {
         std::vector<llvm::Type *> pty;
         for (auto &&param : p->params)
@@ -74,34 +160,32 @@ llvm::Type *EmitIR::operator()(const Type *type)
 
 llvm::Value *EmitIR::operator()(Expr *obj)
 {
-    if (auto p = obj->dcst<IntegerLiteral>())
-        return self(p);
-
-    if (auto p = obj->dcst<DeclRefExpr>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Expr::Kind::kIntegerLiteral:
+        return self(obj->scst<IntegerLiteral>());
 
-    if (auto p = obj->dcst<ParenExpr>())
-        return self(p);
+    case Expr::Kind::kDeclRefExpr:
+        return self(obj->scst<DeclRefExpr>());
 
-    if (auto p = obj->dcst<UnaryExpr>())
-        return self(p);
+    case Expr::Kind::kParenExpr:
+        return self(obj->scst<ParenExpr>());
 
-    if (auto p = obj->dcst<BinaryExpr>())
-        return self(p);
+    case Expr::Kind::kUnaryExpr:
+        return self(obj->scst<UnaryExpr>());
 
-    if (auto p = obj->dcst<CallExpr>())
-        return self(p);
+    case Expr::Kind::kBinaryExpr:
+        return self(obj->scst<BinaryExpr>());
 
-    if (auto p = obj->dcst<InitListExpr>())
-        ABORT();
+    case Expr::Kind::kCallExpr:
+        return self(obj->scst<CallExpr>());
 
-    if (auto p = obj->dcst<ImplicitInitExpr>())
-        return self(p);
+    case Expr::Kind::kImplicitCastExpr:
+        return self(obj->scst<ImplicitCastExpr>());
 
-    if (auto p = obj->dcst<ImplicitCastExpr>())
-        return self(p);
-
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
 llvm::Constant *EmitIR::operator()(IntegerLiteral *obj)
@@ -111,8 +195,17 @@ llvm::Constant *EmitIR::operator()(IntegerLiteral *obj)
 
 llvm::Value *EmitIR::operator()(DeclRefExpr *obj)
 {
+    // SSA 变量没有地址，由赋值和 LValueToRValue 直接读写
+    if (mSsa && mSsaVars.count(obj->decl))
+        return nullptr;
+
     // 变量声明时在 decl->any 中存储了变量的 llvm::Value，现在将其取出
-    return reinterpret_cast<llvm::Value *>(obj->decl->any);
+    auto val = reinterpret_cast<llvm::Value *>(obj->decl->any);
+
+    // 分片中全局变量和函数的 any 是主模块中的值，要在本模块中另行声明
+    if (mShard && llvm::isa<llvm::GlobalValue>(val))
+        return declare(obj->decl);
+    return val;
 }
 
 llvm::Value *EmitIR::operator()(ParenExpr *obj)
@@ -134,7 +227,7 @@ llvm::Value *EmitIR::operator()(UnaryExpr *obj)
         return irb.CreateNeg(sub);
 
     case UnaryExpr::kNot:
-        return irb.CreateNot(cast_to_i1(sub));
+        return irb.CreateZExt(irb.CreateNot(cast_to_i1(sub)), self(obj->type));
 
     default:
         ABORT();
@@ -143,9 +236,26 @@ llvm::Value *EmitIR::operator()(UnaryExpr *obj)
 
 llvm::Value *EmitIR::operator()(BinaryExpr *obj)
 {
-    llvm::Value *lhs, *rhs;
+    // 同 Typing，左深的长链沿 lft 压入 mSpine 后自底向上逐个发射
+    auto base = mSpine.size();
+    for (auto i = obj;; i = i->lft->scst<BinaryExpr>())
+    {
+        mSpine.push_back(i);
+        if (i->lft->kind != Expr::Kind::kBinaryExpr)
+            break;
+    }
+
+    auto lhs = self(mSpine.back()->lft);
+    for (auto i = mSpine.size(); i-- > base;)
+        lhs = binary(mSpine[i], lhs);
+    mSpine.resize(base);
+    return lhs;
+}
+
+llvm::Value *EmitIR::binary(BinaryExpr *obj, llvm::Value *lhs)
+{
+    llvm::Value *rhs;
 
-    lhs = self(obj->lft);
     if (obj->op != BinaryExpr::kAnd && obj->op != BinaryExpr::kOr) // 短路
     {
         rhs = self(obj->rht);
@@ -169,23 +279,14 @@ llvm::Value *EmitIR::operator()(BinaryExpr *obj)
     case BinaryExpr::kSub:
         return irb.CreateSub(lhs, rhs);
 
+    // 比较和逻辑运算的结果是 int，作为条件时由 cond_br 直接跳转，不经过这里
     case BinaryExpr::kGt:
-        return irb.CreateICmpSGT(lhs, rhs);
-
     case BinaryExpr::kLt:
-        return irb.CreateICmpSLT(lhs, rhs);
-
     case BinaryExpr::kGe:
-        return irb.CreateICmpSGE(lhs, rhs);
-
     case BinaryExpr::kLe:
-        return irb.CreateICmpSLE(lhs, rhs);
-
     case BinaryExpr::kEq:
-        return irb.CreateICmpEQ(lhs, rhs);
-
     case BinaryExpr::kNe:
-        return irb.CreateICmpNE(lhs, rhs);
+        return irb.CreateZExt(compare(obj->op, lhs, rhs), self(obj->type));
 
     case BinaryExpr::kAnd: {
         auto endBB = llvm::BasicBlock::Create(mCtx, "", mCurFunc);
@@ -194,6 +295,7 @@ llvm::Value *EmitIR::operator()(BinaryExpr *obj)
 
         auto cond = cast_to_i1(lhs);
         irb.CreateCondBr(cond, rhsBeginBB, endBB);
+        seal(rhsBeginBB);
 
         irb.SetInsertPoint(rhsBeginBB);
         rhs = cast_to_i1(self(obj->rht));
@@ -201,11 +303,12 @@ llvm::Value *EmitIR::operator()(BinaryExpr *obj)
         auto rhsEndBB = irb.GetInsertBlock();
 
         irb.SetInsertPoint(endBB);
+        seal(endBB);
         auto phi = irb.CreatePHI(llvm::Type::getInt1Ty(mCtx), 2);
         phi->addIncoming(irb.getInt1(false), lhsBB);
         phi->addIncoming(rhs, rhsEndBB);
 
-        return phi;
+        return irb.CreateZExt(phi, self(obj->type));
     }
 
     case BinaryExpr::kOr: {
@@ -215,6 +318,7 @@ llvm::Value *EmitIR::operator()(BinaryExpr *obj)
 
         auto cond = cast_to_i1(lhs);
         irb.CreateCondBr(cond, endBB, rhsBeginBB);
+        seal(rhsBeginBB);
 
         irb.SetInsertPoint(rhsBeginBB);
         rhs = cast_to_i1(self(obj->rht));
@@ -222,14 +326,20 @@ llvm::Value *EmitIR::operator()(BinaryExpr *obj)
         auto rhsEndBB = irb.GetInsertBlock();
 
         irb.SetInsertPoint(endBB);
+        seal(endBB);
         auto phi = irb.CreatePHI(llvm::Type::getInt1Ty(mCtx), 2);
         phi->addIncoming(irb.getInt1(true), lhsBB);
         phi->addIncoming(rhs, rhsEndBB);
 
-        return phi;
+        return irb.CreateZExt(phi, self(obj->type));
     }
 
     case BinaryExpr::kAssign:
+        if (auto var = ssa_var(obj->lft))
+        {
+            mCurDefs[{irb.GetInsertBlock(), var}] = rhs;
+            return rhs;
+        }
         return irb.CreateStore(rhs, lhs);
 
     case BinaryExpr::kIndex: {
@@ -262,10 +372,14 @@ llvm::Value *EmitIR::operator()(CallExpr *obj)
 
 llvm::Value *EmitIR::operator()(ImplicitCastExpr *obj)
 {
+    if (obj->castKind == ImplicitCastExpr::kLValueToRValue)
+        if (auto var = ssa_var(obj->sub))
+            return read_var(var, mCurIrb->GetInsertBlock());
+
     auto sub = self(obj->sub);
 
     auto &irb = *mCurIrb;
-    switch (obj->kind)
+    switch (obj->castKind)
     {
     // 在 LLVM IR 层面，左值体现为指向值的指针，经过 load 指令变成右值
     case ImplicitCastExpr::kLValueToRValue: {
@@ -301,40 +415,47 @@ void EmitIR::operator()(Stmt *obj)
     if (mCurIrb->GetInsertBlock()->getTerminator())
         return;
 
-    if (auto p = obj->dcst<NullStmt>())
+    switch (obj->kind)
+    {
+    case Stmt::Kind::kNullStmt:
         return;
 
-    if (auto p = obj->dcst<DeclStmt>())
-        return self(p);
+    case Stmt::Kind::kDeclStmt:
+        return self(obj->scst<DeclStmt>());
 
-    if (auto p = obj->dcst<ExprStmt>())
-        return self(p);
+    case Stmt::Kind::kExprStmt:
+        return self(obj->scst<ExprStmt>());
 
-    if (auto p = obj->dcst<CompoundStmt>())
-        return self(p);
+    case Stmt::Kind::kCompoundStmt:
+        return self(obj->scst<CompoundStmt>());
 
-    if (auto p = obj->dcst<IfStmt>())
-        return self(p);
+    case Stmt::Kind::kIfStmt:
+        return self(obj->scst<IfStmt>());
 
-    if (auto p = obj->dcst<WhileStmt>())
-        return self(p);
+    case Stmt::Kind::kWhileStmt:
+        return self(obj->scst<WhileStmt>());
 
-    if (auto p = obj->dcst<BreakStmt>())
-        return self(p);
+    case Stmt::Kind::kDoStmt:
+        return self(obj->scst<DoStmt>());
 
-    if (auto p = obj->dcst<ContinueStmt>())
-        return self(p);
+    case Stmt::Kind::kBreakStmt:
+        return self(obj->scst<BreakStmt>());
 
-    if (auto p = obj->dcst<ReturnStmt>())
-        return self(p);
+    case Stmt::Kind::kContinueStmt:
+        return self(obj->scst<ContinueStmt>());
 
-    ABORT();
+    case Stmt::Kind::kReturnStmt:
+        return self(obj->scst<ReturnStmt>());
+
+    default:
+        ABORT();
+    }
 }
 
 void EmitIR::operator()(DeclStmt *obj)
 {
     for (auto &&decl : obj->decls)
-        self(decl->dcst<VarDecl>(), false);
+        self(kcst<VarDecl>(decl), false);
 }
 
 void EmitIR::operator()(ExprStmt *obj)
@@ -354,8 +475,6 @@ void EmitIR::operator()(IfStmt *obj)
 {
     auto &irb = *mCurIrb;
 
-    llvm::Value *cond = cast_to_i1(self(obj->cond));
-
     auto thenBeginBB = llvm::BasicBlock::Create(mCtx, "if.then", mCurFunc);
     auto endBB = llvm::BasicBlock::Create(mCtx, "if.end", mCurFunc);
 
@@ -363,7 +482,9 @@ void EmitIR::operator()(IfStmt *obj)
     {
         auto elseBeginBB = llvm::BasicBlock::Create(mCtx, "if.else", mCurFunc);
 
-        irb.CreateCondBr(cond, thenBeginBB, elseBeginBB);
+        cond_br(obj->cond, thenBeginBB, elseBeginBB);
+        seal(thenBeginBB);
+        seal(elseBeginBB);
 
         irb.SetInsertPoint(thenBeginBB);
         self(obj->then);
@@ -379,7 +500,8 @@ void EmitIR::operator()(IfStmt *obj)
     }
     else
     {
-        irb.CreateCondBr(cond, thenBeginBB, endBB);
+        cond_br(obj->cond, thenBeginBB, endBB);
+        seal(thenBeginBB);
 
         irb.SetInsertPoint(thenBeginBB);
         self(obj->then);
@@ -389,39 +511,73 @@ void EmitIR::operator()(IfStmt *obj)
     }
 
     irb.SetInsertPoint(endBB);
+    seal(endBB);
 }
 
 void EmitIR::operator()(WhileStmt *obj)
 {
-    auto &irb = *mCurIrb;
-
-    auto condBeginBB = llvm::BasicBlock::Create(mCtx, "while.cond", mCurFunc);
+    // 翻译为旋转后的形式：入口处先判断一次条件，循环体末尾的 while.cond 再判断
+    // 并跳回循环体，每次迭代只有一次跳转
     auto bodyBeginBB = llvm::BasicBlock::Create(mCtx, "while.body", mCurFunc);
+    auto condBeginBB = llvm::BasicBlock::Create(mCtx, "while.cond", mCurFunc);
     auto endBB = llvm::BasicBlock::Create(mCtx, "while.end", mCurFunc);
 
     obj->cond->any = condBeginBB;
     obj->body->any = bodyBeginBB;
     obj->any = endBB;
 
-    irb.CreateBr(condBeginBB);
+    cond_br(obj->cond, bodyBeginBB, endBB);
+    loop(obj->body, obj->cond, bodyBeginBB, condBeginBB, endBB);
+}
+
+void EmitIR::operator()(DoStmt *obj)
+{
+    auto &irb = *mCurIrb;
+
+    auto bodyBeginBB = llvm::BasicBlock::Create(mCtx, "do.body", mCurFunc);
+    auto condBeginBB = llvm::BasicBlock::Create(mCtx, "do.cond", mCurFunc);
+    auto endBB = llvm::BasicBlock::Create(mCtx, "do.end", mCurFunc);
+
+    obj->cond->any = condBeginBB;
+    obj->body->any = bodyBeginBB;
+    obj->any = endBB;
+
+    irb.CreateBr(bodyBeginBB);
+    loop(obj->body, obj->cond, bodyBeginBB, condBeginBB, endBB);
+}
 
-    irb.SetInsertPoint(condBeginBB);
-    auto cond = cast_to_i1(self(obj->cond));
-    auto condEndBB = irb.GetInsertBlock();
+void EmitIR::loop(Stmt *body, Expr *cond, llvm::BasicBlock *bodyBeginBB, llvm::BasicBlock *condBeginBB,
+                  llvm::BasicBlock *endBB)
+{
+    auto &irb = *mCurIrb;
 
     irb.SetInsertPoint(bodyBeginBB);
-    self(obj->body);
-    auto bodyEndBB = irb.GetInsertBlock();
+    self(body);
+    // 如果内部有 break/continue/return 则基本块已终结，不再添加跳转指令
+    bool fallthrough = !irb.GetInsertBlock()->getTerminator();
 
-    irb.SetInsertPoint(condEndBB);
-    irb.CreateCondBr(cond, bodyBeginBB, endBB);
+    // 循环体的入口还有这里的回边，出口还有这里的跳出，都要等到这之后才封闭
+    if (condBeginBB->use_empty())
+    {
+        // 没有 continue，直接在循环体末尾判断条件，省去一次跳转
+        condBeginBB->eraseFromParent();
+        if (fallthrough)
+            cond_br(cond, bodyBeginBB, endBB);
+    }
+    else
+    {
+        if (fallthrough)
+            irb.CreateBr(condBeginBB);
+        // continue 都已翻译，条件的基本块的前驱已完整
+        seal(condBeginBB);
 
-    irb.SetInsertPoint(bodyEndBB);
-    // 如果内部有 break/continue/return 则基本块已终结，不再添加跳转指令
-    if (!irb.GetInsertBlock()->getTerminator())
-        irb.CreateBr(condBeginBB);
+        irb.SetInsertPoint(condBeginBB);
+        cond_br(cond, bodyBeginBB, endBB);
+    }
+    seal(bodyBeginBB);
 
     irb.SetInsertPoint(endBB);
+    seal(endBB);
 }
 
 void EmitIR::operator()(BreakStmt *obj)
@@ -432,7 +588,10 @@ void EmitIR::operator()(BreakStmt *obj)
 
 void EmitIR::operator()(ContinueStmt *obj)
 {
-    mCurIrb->CreateBr(reinterpret_cast<llvm::BasicBlock *>(obj->loop->dcst<WhileStmt>()->cond->any));
+    // cond->any 存放的是判断条件的基本块
+    auto cond = obj->loop->kind == Stmt::Kind::kWhileStmt ? obj->loop->scst<WhileStmt>()->cond
+                                                          : obj->loop->scst<DoStmt>()->cond;
+    mCurIrb->CreateBr(reinterpret_cast<llvm::BasicBlock *>(cond->any));
 }
 
 void EmitIR::operator()(ReturnStmt *obj)
@@ -454,39 +613,62 @@ void EmitIR::operator()(ReturnStmt *obj)
 
 void EmitIR::operator()(Decl *obj)
 {
-    if (auto p = obj->dcst<FunctionDecl>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Decl::Kind::kFunctionDecl:
+        return self(obj->scst<FunctionDecl>());
 
-    if (auto p = obj->dcst<VarDecl>())
-        return self(p, true);
+    case Decl::Kind::kVarDecl:
+        return self(obj->scst<VarDecl>(), true);
 
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
 void EmitIR::operator()(FunctionDecl *obj)
 {
     // 创建函数
     auto fty = llvm::dyn_cast<llvm::FunctionType>(self(obj->type));
-    auto func = llvm::Function::Create(fty, llvm::GlobalVariable::ExternalLinkage, obj->name, mMod);
+    auto func = llvm::Function::Create(fty, llvm::GlobalVariable::ExternalLinkage, obj->name.str(), mMod);
 
     obj->any = func;
 
     if (obj->body == nullptr)
         return;
 
+    body(obj, func);
+}
+
+void EmitIR::body(FunctionDecl *obj, llvm::Function *func)
+{
+    auto fty = func->getFunctionType();
+
     // 创建函数的 entry 基本块
     auto entryBb = llvm::BasicBlock::Create(mCtx, "entry", func);
     mCurIrb->SetInsertPoint(entryBb);
     auto &entryIrb = *mCurIrb;
 
+    mSsaVars.clear();
+    mCurDefs.clear();
+    mSealed.clear();
+    mIncompletePhis.clear();
+    seal(entryBb);
+
     // 函数参数
     for (int i = 0; i < obj->params.size(); ++i)
     {
         auto llvm_arg = func->getArg(i);
         auto asg_param = obj->params[i];
 
-        llvm_arg->setName(asg_param->name);
-        auto alloca = entryIrb.CreateAlloca(llvm_arg->getType(), nullptr, asg_param->name); // 为参数分配空间
+        llvm_arg->setName(asg_param->name.str());
+        if (mSsa)
+        {
+            mSsaVars[asg_param] = llvm_arg->getType();
+            mCurDefs[{entryBb, asg_param}] = llvm_arg;
+            continue;
+        }
+        auto alloca = entryIrb.CreateAlloca(llvm_arg->getType(), nullptr, asg_param->name.str()); // 为参数分配空间
         entryIrb.CreateStore(llvm_arg, alloca); // 将参数值复制到分配的空间
         asg_param->any = alloca;
     }
@@ -512,17 +694,21 @@ void EmitIR::operator()(VarDecl *obj, bool global)
 
     if (global)
     {
-        // 这里不能设为 const，因为一会要使用函数初始化
-        auto gvar = new llvm::GlobalVariable(mMod, ty, false, llvm::GlobalVariable::ExternalLinkage,
-                                             llvm::Constant::getNullValue(ty), obj->name);
+        // 初始化表达式是编译期常量时静态初始化，const 变量也就可以设为常量；
+        // 否则先零初始化，再由构造函数在启动时初始化
+        auto init = obj->init ? constant(obj->init) : llvm::Constant::getNullValue(ty);
+        auto gvar = new llvm::GlobalVariable(mMod, ty, init && obj->type->qual.const_,
+                                             llvm::GlobalVariable::ExternalLinkage,
+                                             init ? init : llvm::Constant::getNullValue(ty), obj->name.str());
 
         obj->any = gvar;
 
-        if (obj->init == nullptr)
+        if (init)
             return;
 
         // 创建构造函数用于初始化
-        mCurFunc = llvm::Function::Create(mCtorTy, llvm::GlobalVariable::PrivateLinkage, "ctor_" + obj->name, mMod);
+        mCurFunc = llvm::Function::Create(mCtorTy, llvm::GlobalVariable::PrivateLinkage,
+                                          "ctor_" + llvm::StringRef(obj->name.str()), mMod);
         llvm::appendToGlobalCtors(mMod, mCurFunc, 65535);
 
         auto entryBb = llvm::BasicBlock::Create(mCtx, "entry", mCurFunc);
@@ -530,6 +716,17 @@ void EmitIR::operator()(VarDecl *obj, bool global)
         var_init(gvar, obj->init);
         mCurIrb->CreateRet(nullptr);
     }
+    else if (mSsa && !kcst<ArrayType>(obj->type->texp))
+    {
+        mSsaVars[obj] = ty;
+        if (obj->init)
+        {
+            auto &irb = *mCurIrb;
+            auto val = obj->init->kind == Expr::Kind::kImplicitInitExpr ? llvm::Constant::getNullValue(ty)
+                                                                          : self(obj->init);
+            mCurDefs[{irb.GetInsertBlock(), obj}] = val;
+        }
+    }
     else
     {
         // 将函数中所有的 alloca 指令都放到函数的 entry 基本块中，
@@ -546,7 +743,7 @@ void EmitIR::operator()(VarDecl *obj, bool global)
         else
             irb.SetInsertPoint(entry);
 
-        auto var = irb.CreateAlloca(ty, nullptr, obj->name);
+        auto var = irb.CreateAlloca(ty, nullptr, obj->name.str());
         obj->any = var;
 
         irb.SetInsertPoint(bak); // 恢复备份的基本块
@@ -556,62 +753,516 @@ void EmitIR::operator()(VarDecl *obj, bool global)
     }
 }
 
+llvm::Constant *EmitIR::declare(Decl *obj)
+{
+    if (obj->kind == Decl::Kind::kFunctionDecl)
+    {
+        auto fty = llvm::cast<llvm::FunctionType>(self(obj->type));
+        return llvm::cast<llvm::Constant>(mMod.getOrInsertFunction(obj->name.str(), fty).getCallee());
+    }
+
+    // const 全局变量带上初始值声明为 available_externally 常量，分片中的优化才能
+    // 像在主模块中一样折叠对它的读取；链接时保留的仍是主模块中的定义
+    auto name = obj->name.str();
+    auto gvar = llvm::dyn_cast_or_null<llvm::GlobalVariable>(reinterpret_cast<llvm::Value *>(obj->any));
+    if (gvar && gvar->isConstant() && !mMod.getNamedGlobal(name))
+    {
+        auto ty = self(obj->type);
+        auto init = obj->scst<VarDecl>()->init;
+        if (auto val = init ? constant(init) : llvm::Constant::getNullValue(ty))
+            return new llvm::GlobalVariable(mMod, ty, true, llvm::GlobalValue::AvailableExternallyLinkage, val, name);
+    }
+    return mMod.getOrInsertGlobal(name, self(obj->type));
+}
+
+//============================================================================
+// 直接构造 SSA
+//============================================================================
+
+Decl *EmitIR::ssa_var(Expr *obj)
+{
+    if (!mSsa)
+        return nullptr;
+    while (auto p = kcst<ParenExpr>(obj))
+        obj = p->sub;
+    auto ref = kcst<DeclRefExpr>(obj);
+    return ref && mSsaVars.count(ref->decl) ? ref->decl : nullptr;
+}
+
+llvm::Value *EmitIR::read_var(Decl *var, llvm::BasicBlock *bb)
+{
+    // 沿唯一的前驱向上找，途经的基本块都记下找到的值，长的直线代码不会递归
+    llvm::SmallVector<llvm::BasicBlock *, 8> path;
+    llvm::Value *val;
+    for (;; bb = bb->getUniquePredecessor())
+    {
+        if (auto it = mCurDefs.find({bb, var}); it != mCurDefs.end())
+        {
+            val = it->second;
+            break;
+        }
+
+        auto ty = mSsaVars.lookup(var);
+        if (!mSealed.count(bb))
+        {
+            // 前驱还不完整，先放一个 phi，封闭时再填写操作数
+            auto phi = bb->empty() ? llvm::PHINode::Create(ty, 0, var->name.str(), bb)
+                                   : llvm::PHINode::Create(ty, 0, var->name.str(), &bb->front());
+            mIncompletePhis[bb].emplace_back(var, phi);
+            val = phi;
+            break;
+        }
+
+        if (llvm::pred_empty(bb))
+        {
+            // 未初始化的变量或不可达的代码
+            val = llvm::UndefValue::get(ty);
+            break;
+        }
+
+        if (!bb->getUniquePredecessor())
+        {
+            // 先记下 phi，经由环路读到本基本块时用它作为值，避免无限递归
+            auto phi = bb->empty() ? llvm::PHINode::Create(ty, 0, var->name.str(), bb)
+                                   : llvm::PHINode::Create(ty, 0, var->name.str(), &bb->front());
+            mCurDefs[{bb, var}] = phi;
+            val = add_phi_operands(var, phi);
+            break;
+        }
+
+        path.push_back(bb);
+    }
+
+    mCurDefs[{bb, var}] = val;
+    for (auto &&i : path)
+        mCurDefs[{i, var}] = val;
+    return val;
+}
+
+llvm::Value *EmitIR::add_phi_operands(Decl *var, llvm::PHINode *phi)
+{
+    auto bb = phi->getParent();
+    for (auto pred : llvm::predecessors(bb))
+        phi->addIncoming(read_var(var, pred), pred);
+    return remove_trivial_phi(phi);
+}
+
+llvm::Value *EmitIR::remove_trivial_phi(llvm::PHINode *phi)
+{
+    llvm::Value *same = nullptr;
+    for (auto &&i : phi->incoming_values())
+    {
+        if (i == same || i == phi)
+            continue;
+        if (same)
+            return phi;
+        same = i;
+    }
+    if (same == nullptr)
+        same = llvm::UndefValue::get(phi->getType());
+
+    llvm::SmallVector<llvm::WeakVH, 4> users;
+    for (auto user : phi->users())
+        if (user != phi && llvm::isa<llvm::PHINode>(user))
+            users.push_back(user);
+
+    phi->replaceAllUsesWith(same);
+    phi->eraseFromParent();
+
+    // 操作数还没有填完的 phi 留到填完时再检查。same 本身也可能是随之删除的
+    // phi，用 WeakTrackingVH 跟踪它的替换
+    llvm::WeakTrackingVH ret(same);
+    for (auto &&i : users)
+        if (auto user = llvm::dyn_cast_or_null<llvm::PHINode>(i))
+            if (user->getNumIncomingValues() == llvm::pred_size(user->getParent()))
+                remove_trivial_phi(user);
+    return ret;
+}
+
+void EmitIR::seal(llvm::BasicBlock *bb)
+{
+    if (!mSsa)
+        return;
+
+    mSealed.insert(bb);
+    auto it = mIncompletePhis.find(bb);
+    if (it == mIncompletePhis.end())
+        return;
+    auto phis = std::move(it->second);
+    mIncompletePhis.erase(it);
+    for (auto &&[var, phi] : phis)
+        add_phi_operands(var, phi);
+}
+
 //============================================================================
 // Utils
 //============================================================================
 
+void EmitIR::cond_br(Expr *obj, llvm::BasicBlock *trueBB, llvm::BasicBlock *falseBB)
+{
+    auto &irb = *mCurIrb;
+    for (;;)
+    {
+        while (auto p = kcst<ParenExpr>(obj))
+            obj = p->sub;
+
+        if (auto p = kcst<UnaryExpr>(obj); p && p->op == UnaryExpr::kNot)
+        {
+            obj = p->sub;
+            std::swap(trueBB, falseBB);
+            continue;
+        }
+
+        auto p = kcst<BinaryExpr>(obj);
+        if (!p)
+            break;
+
+        if (p->op == BinaryExpr::kAnd || p->op == BinaryExpr::kOr)
+        {
+            // 左深的 &&、|| 链沿 lft 压入 mCondSpine，自顶向下确定各节点左操作数的目标：
+            // 左操作数决定结果时直接跳到节点的目标，否则跳到求右操作数的新基本块
+            auto base = mCondSpine.size();
+            for (auto i = p; i && (i->op == BinaryExpr::kAnd || i->op == BinaryExpr::kOr); i = kcst<BinaryExpr>(obj))
+            {
+                bool isAnd = i->op == BinaryExpr::kAnd;
+                auto rhsBB = llvm::BasicBlock::Create(mCtx, isAnd ? "land.rhs" : "lor.rhs", mCurFunc);
+                mCondSpine.push_back({i, rhsBB, trueBB, falseBB});
+                (isAnd ? trueBB : falseBB) = rhsBB;
+                for (obj = i->lft; auto q = kcst<ParenExpr>(obj);)
+                    obj = q->sub;
+            }
+
+            // 最左的操作数不再是 &&、|| 链，然后自底向上在各节点的右操作数块中继续
+            cond_br(obj, trueBB, falseBB);
+            for (auto i = mCondSpine.size(); i-- > base;)
+            {
+                auto link = mCondSpine[i];
+                seal(link.mRhsBB);
+                irb.SetInsertPoint(link.mRhsBB);
+                if (i == base)
+                {
+                    // 链顶的右操作数继续在本层循环中处理
+                    mCondSpine.resize(base);
+                    obj = link.mExpr->rht;
+                    trueBB = link.mTrueBB;
+                    falseBB = link.mFalseBB;
+                    break;
+                }
+                cond_br(link.mExpr->rht, link.mTrueBB, link.mFalseBB);
+            }
+            continue;
+        }
+
+        switch (p->op)
+        {
+        case BinaryExpr::kGt:
+        case BinaryExpr::kLt:
+        case BinaryExpr::kGe:
+        case BinaryExpr::kLe:
+        case BinaryExpr::kEq:
+        case BinaryExpr::kNe: {
+            auto lhs = self(p->lft);
+            auto rhs = self(p->rht);
+            irb.CreateCondBr(compare(p->op, lhs, rhs), trueBB, falseBB);
+            return;
+        }
+
+        default:
+            break;
+        }
+        break;
+    }
+
+    irb.CreateCondBr(cast_to_i1(self(obj)), trueBB, falseBB);
+}
+
+llvm::Value *EmitIR::compare(BinaryExpr::Op op, llvm::Value *lhs, llvm::Value *rhs)
+{
+    auto &irb = *mCurIrb;
+    switch (op)
+    {
+    case BinaryExpr::kGt:
+        return irb.CreateICmpSGT(lhs, rhs);
+
+    case BinaryExpr::kLt:
+        return irb.CreateICmpSLT(lhs, rhs);
+
+    case BinaryExpr::kGe:
+        return irb.CreateICmpSGE(lhs, rhs);
+
+    case BinaryExpr::kLe:
+        return irb.CreateICmpSLE(lhs, rhs);
+
+    case BinaryExpr::kEq:
+        return irb.CreateICmpEQ(lhs, rhs);
+
+    case BinaryExpr::kNe:
+        return irb.CreateICmpNE(lhs, rhs);
+
+    default:
+        ABORT();
+    }
+}
+
 // 通过 val != 0 将类型转为 i1
 llvm::Value *EmitIR::cast_to_i1(llvm::Value *val)
 {
     auto &irb = *mCurIrb;
+    // 比较和逻辑运算的结果扩展到 int 后又作为条件时直接取原来的 i1
+    if (auto zext = llvm::dyn_cast<llvm::ZExtInst>(val); zext && zext->getSrcTy() == irb.getInt1Ty())
+        return zext->getOperand(0);
     if (val->getType() != irb.getInt1Ty())
         val = irb.CreateICmpNE(val, llvm::Constant::getNullValue(val->getType()));
     return val;
 }
 
-void EmitIR::var_init(llvm::Value *var, Expr *obj)
+llvm::Constant *EmitIR::constant(Expr *obj)
 {
-    auto &irb = *mCurIrb;
-
-    if (auto p = obj->dcst<InitListExpr>())
+    switch (obj->kind)
     {
-        bool implicitInit = false;
+    case Expr::Kind::kIntegerLiteral:
+        return self(obj->scst<IntegerLiteral>());
+
+    case Expr::Kind::kImplicitInitExpr:
+        return llvm::Constant::getNullValue(self(obj->type));
+
+    case Expr::Kind::kParenExpr:
+        return constant(obj->scst<ParenExpr>()->sub);
+
+    case Expr::Kind::kUnaryExpr: {
+        auto p = obj->scst<UnaryExpr>();
+        auto sub = llvm::dyn_cast_or_null<llvm::ConstantInt>(constant(p->sub));
+        if (!sub)
+            return nullptr;
 
-        if (auto item = p->list[0]->dcst<ImplicitInitExpr>())
+        switch (p->op)
         {
-            implicitInit = true;
+        case UnaryExpr::kPos:
+            return sub;
+
+        case UnaryExpr::kNeg:
+            // 溢出是未定义行为，同除以零一样留到运行时
+            if (sub->getValue().isMinSignedValue())
+                return nullptr;
+            return llvm::ConstantInt::get(mCtx, -sub->getValue());
+
+        case UnaryExpr::kNot:
+            return llvm::ConstantInt::get(self(obj->type), sub->isZero());
+
+        default:
+            return nullptr;
+        }
+    }
+
+    case Expr::Kind::kBinaryExpr: {
+        // 同 operator()(BinaryExpr *)，左深的长链自底向上求值
+        auto base = mSpine.size();
+        for (auto i = obj->scst<BinaryExpr>();; i = i->lft->scst<BinaryExpr>())
+        {
+            mSpine.push_back(i);
+            if (i->lft->kind != Expr::Kind::kBinaryExpr)
+                break;
+        }
 
-            auto arrTy = obj->type->texp->dcst<ArrayType>();
+        auto lhs = constant(mSpine.back()->lft);
+        for (auto i = mSpine.size(); lhs && i-- > base;)
+            lhs = constant(mSpine[i], lhs);
+        mSpine.resize(base);
+        return lhs;
+    }
 
-            int elemCnt = arrTy->len;
-            while (arrTy->sub)
+    case Expr::Kind::kImplicitCastExpr: {
+        auto p = obj->scst<ImplicitCastExpr>();
+        switch (p->castKind)
+        {
+        case ImplicitCastExpr::kIntegralCast: {
+            auto sub = llvm::dyn_cast_or_null<llvm::ConstantInt>(constant(p->sub));
+            if (!sub)
+                return nullptr;
+            auto ty = llvm::cast<llvm::IntegerType>(self(obj->type));
+            return llvm::ConstantInt::get(ty, sub->getValue().sextOrTrunc(ty->getBitWidth()));
+        }
+
+        case ImplicitCastExpr::kLValueToRValue: {
+            // 已静态初始化的 const 全局变量的值
+            auto ref = kcst<DeclRefExpr>(p->sub);
+            if (!ref || ref->decl->kind != Decl::Kind::kVarDecl || !ref->decl->type->qual.const_)
+                return nullptr;
+            auto gvar = llvm::dyn_cast_or_null<llvm::GlobalVariable>(reinterpret_cast<llvm::Value *>(ref->decl->any));
+            if (!gvar || !gvar->isConstant())
+                return nullptr;
+            if (mShard)
             {
-                arrTy = arrTy->sub->dcst<ArrayType>();
-                if (!arrTy)
-                    break;
-                elemCnt *= arrTy->len;
+                // 主模块中的初始值属于另一个 LLVMContext，按 ASG 中的初始化表达式重新求值
+                auto init = ref->decl->scst<VarDecl>()->init;
+                return init ? constant(init) : llvm::Constant::getNullValue(self(ref->decl->type));
             }
+            return gvar->getInitializer();
+        }
 
-            // 假设元素类型均为 i32
-            irb.CreateMemSet(var, llvm::Constant::getNullValue(irb.getInt8Ty()), elemCnt * 4, llvm::MaybeAlign());
+        default:
+            return nullptr;
         }
+    }
 
-        // 如果有隐式初始化，则遍历 list 的下标从 1 开始，否则从 0 开始
-        // 而 LLVM IR 的数组下标总是从 0 开始
-        for (int i = implicitInit; i < p->list.size(); ++i)
+    case Expr::Kind::kInitListExpr: {
+        auto &list = obj->scst<InitListExpr>()->list;
+        auto ty = llvm::cast<llvm::ArrayType>(self(obj->type));
+        auto elemTy = ty->getElementType();
+
+        // 同 init_template，list[0] 为 ImplicitInitExpr 时表示其余的元素零初始化
+        std::size_t begin = !list.empty() && list[0]->kind == Expr::Kind::kImplicitInitExpr;
+        std::vector<llvm::Constant *> elems;
+        for (auto i = begin; i < list.size(); ++i)
         {
-            var_init(irb.CreateInBoundsGEP(self(obj->type), var, {irb.getInt64(0), irb.getInt64(i - implicitInit)}),
-                     p->list[i]);
+            auto elem = constant(list[i]);
+            if (!elem)
+                return nullptr;
+            elems.push_back(elem);
         }
+        elems.resize(ty->getNumElements(), llvm::Constant::getNullValue(elemTy));
 
-        return;
+        // 元素全为零时得到 ConstantAggregateZero
+        return llvm::ConstantArray::get(ty, elems);
+    }
+
+    default:
+        return nullptr;
+    }
+}
+
+llvm::Constant *EmitIR::constant(BinaryExpr *obj, llvm::Constant *lhs)
+{
+    auto lft = llvm::dyn_cast<llvm::ConstantInt>(lhs);
+    auto rht = llvm::dyn_cast_or_null<llvm::ConstantInt>(constant(obj->rht));
+    if (!lft || !rht)
+        return nullptr;
+
+    auto &a = lft->getValue(), &b = rht->getValue();
+    auto ty = self(obj->type);
+
+    // 有符号溢出和除以零都是未定义行为，不在编译期求值，留到运行时
+    bool overflow = false;
+    auto checked = [&](const llvm::APInt &val) -> llvm::Constant *
+    { return overflow ? nullptr : llvm::ConstantInt::get(ty, val); };
+
+    switch (obj->op)
+    {
+    case BinaryExpr::kMul:
+        return checked(a.smul_ov(b, overflow));
+
+    case BinaryExpr::kDiv:
+    case BinaryExpr::kMod:
+        if (b.isZero() || (a.isMinSignedValue() && b.isAllOnes()))
+            return nullptr;
+        return llvm::ConstantInt::get(ty, obj->op == BinaryExpr::kDiv ? a.sdiv(b) : a.srem(b));
+
+    case BinaryExpr::kAdd:
+        return checked(a.sadd_ov(b, overflow));
+
+    case BinaryExpr::kSub:
+        return checked(a.ssub_ov(b, overflow));
+
+    case BinaryExpr::kGt:
+        return llvm::ConstantInt::get(ty, a.sgt(b));
+
+    case BinaryExpr::kLt:
+        return llvm::ConstantInt::get(ty, a.slt(b));
+
+    case BinaryExpr::kGe:
+        return llvm::ConstantInt::get(ty, a.sge(b));
+
+    case BinaryExpr::kLe:
+        return llvm::ConstantInt::get(ty, a.sle(b));
+
+    case BinaryExpr::kEq:
+        return llvm::ConstantInt::get(ty, a == b);
+
+    case BinaryExpr::kNe:
+        return llvm::ConstantInt::get(ty, a != b);
+
+    case BinaryExpr::kAnd:
+        return llvm::ConstantInt::get(ty, !a.isZero() && !b.isZero());
+
+    case BinaryExpr::kOr:
+        return llvm::ConstantInt::get(ty, !a.isZero() || !b.isZero());
+
+    default:
+        return nullptr;
     }
+}
 
-    if (auto p = obj->dcst<Expr>())
+void EmitIR::var_init(llvm::Value *var, Expr *obj)
+{
+    auto &irb = *mCurIrb;
+
+    if (obj->type->texp == nullptr)
     {
-        irb.CreateStore(self(p), var);
+        if (obj->kind == Expr::Kind::kImplicitInitExpr)
+            irb.CreateStore(llvm::Constant::getNullValue(self(obj->type)), var);
+        else
+            irb.CreateStore(self(obj), var);
         return;
     }
 
-    ABORT();
+    auto ty = self(obj->type);
+    auto size = mMod.getDataLayout().getTypeAllocSize(ty);
+
+    std::vector<llvm::Value *> path{irb.getInt64(0)};
+    std::vector<InitElem> elems;
+    auto init = init_template(obj, path, elems);
+
+    auto nConst = std::count_if(elems.begin(), elems.end(), [](const InitElem &i) { return i.mConst != nullptr; });
+    bool sparse = std::size_t(nConst) <= kMaxInitStores;
+    if (sparse)
+    {
+        irb.CreateMemSet(var, irb.getInt8(0), size, llvm::MaybeAlign());
+    }
+    else
+    {
+        auto tmpl = new llvm::GlobalVariable(mMod, ty, true, llvm::GlobalVariable::PrivateLinkage, init,
+                                             "__const." + mCurFunc->getName() + "." + var->getName());
+        tmpl->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        irb.CreateMemCpy(var, llvm::MaybeAlign(), tmpl, llvm::MaybeAlign(), size);
+    }
+
+    for (auto &&i : elems)
+    {
+        if (i.mConst && !sparse)
+            continue;
+        auto val = i.mConst ? i.mConst : self(i.mExpr);
+        irb.CreateStore(val, irb.CreateInBoundsGEP(ty, var, i.mPath));
+    }
+}
+
+llvm::Constant *EmitIR::init_template(Expr *obj, std::vector<llvm::Value *> &path, std::vector<InitElem> &elems)
+{
+    auto p = kcst<InitListExpr>(obj);
+    if (p == nullptr)
+    {
+        auto val = constant(obj);
+        if (val == nullptr)
+        {
+            elems.push_back({path, nullptr, obj});
+            return llvm::Constant::getNullValue(self(obj->type));
+        }
+        if (!val->isNullValue())
+            elems.push_back({path, val, obj});
+        return val;
+    }
+
+    auto ty = llvm::cast<llvm::ArrayType>(self(obj->type));
+    auto elemTy = ty->getElementType();
+
+    // list[0] 为 ImplicitInitExpr 时表示其余的元素零初始化
+    std::size_t begin = !p->list.empty() && p->list[0]->kind == Expr::Kind::kImplicitInitExpr;
+    std::vector<llvm::Constant *> vals;
+    for (auto i = begin; i < p->list.size(); ++i)
+    {
+        path.push_back(mCurIrb->getInt64(i - begin));
+        vals.push_back(init_template(p->list[i], path, elems));
+        path.pop_back();
+    }
+    vals.resize(ty->getNumElements(), llvm::Constant::getNullValue(elemTy));
+    return llvm::ConstantArray::get(ty, vals);
 }
@@ -1,4 +1,8 @@
+#pragma once
+
 #include "asg.hpp"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
@@ -9,19 +13,106 @@ class EmitIR
     Obj::Mgr &mMgr;
     llvm::Module mMod;
 
+    /// 直接构造 SSA：标量的局部变量和参数不分配 alloca，见 read_var
+    bool mSsa{false};
+
     EmitIR(Obj::Mgr &mgr, llvm::LLVMContext &ctx, llvm::StringRef mid = "-");
 
-    llvm::Module &operator()(asg::TranslationUnit *tu);
+    /**
+     * @brief 把整个编译单元发射到 mMod
+     *
+     * \p jobs 大于 1 时，先串行地发射全局变量和所有函数的原型，再在 \p jobs 个
+     * 线程上并行发射函数体：函数体按源码顺序分成若干段，每段发射到单独的模块
+     * （分片）中，其中用到的全局变量和函数按名字声明。每个线程有自己的
+     * LLVMContext，分片写成位码交回，最后在 mCtx 中按顺序读回，用 llvm::Linker
+     * 链接进 mMod。结果与线程数无关，但函数体排在所有原型之后，顺序与串行发射
+     * 不同。
+     */
+    llvm::Module &operator()(asg::TranslationUnit *tu, unsigned jobs = 1);
+
+    /// 发射函数体以外的全部内容，函数只创建原型，返回有函数体的函数
+    std::vector<asg::FunctionDecl *> prototypes(asg::TranslationUnit *tu);
+
+    /**
+     * @brief 作为分片发射 \p funcs 的函数体
+     *
+     * 主模块已由 prototypes 发射，用到的全局变量和函数在 mMod 中按名字声明。
+     * 不修改全局声明的 any，所以可以在多个线程中对不同的函数同时调用。
+     */
+    void bodies(llvm::ArrayRef<asg::FunctionDecl *> funcs);
 
   private:
     llvm::LLVMContext &mCtx;
 
+    /// 并行发射时每个线程平均分到的分片数
+    static constexpr std::size_t kShardsPerJob = 4;
+
+    /// 是否为并行发射中的分片，此时全局声明的 any 属于主模块，不能使用也不能修改
+    bool mShard{false};
+
     llvm::Type *mIntTy;
     llvm::FunctionType *mCtorTy;
 
     llvm::Function *mCurFunc;
     std::unique_ptr<llvm::IRBuilder<>> mCurIrb;
 
+    /// 正在发射的左深 BinaryExpr 链，见 operator()(asg::BinaryExpr *)
+    std::vector<asg::BinaryExpr *> mSpine;
+
+    /// 条件跳转中 &&、|| 链上的节点：右操作数所在的基本块和整个节点的跳转目标
+    struct CondLink
+    {
+        asg::BinaryExpr *mExpr;
+        llvm::BasicBlock *mRhsBB, *mTrueBB, *mFalseBB;
+    };
+
+    /// 正在发射跳转的左深 &&、|| 链，见 cond_br
+    std::vector<CondLink> mCondSpine;
+
+    //============================================================================
+    // 直接构造 SSA（Braun et al., Simple and Efficient Construction of Static
+    // Single Assignment Form, CC 2013）
+    //============================================================================
+
+    /// 不分配 alloca 的局部变量及其类型。语言中没有取地址运算，所以数组以外的
+    /// 局部变量和参数只会被读取和赋值
+    llvm::DenseMap<asg::Decl *, llvm::Type *> mSsaVars;
+
+    /// 各基本块中变量当前的定义，删除平凡 phi 时随 replaceAllUsesWith 更新
+    llvm::DenseMap<std::pair<llvm::BasicBlock *, asg::Decl *>, llvm::WeakTrackingVH> mCurDefs;
+
+    /// 已封闭，即前驱都已确定的基本块
+    llvm::DenseSet<llvm::BasicBlock *> mSealed;
+
+    /// 未封闭的基本块中还没有填写操作数的 phi
+    llvm::DenseMap<llvm::BasicBlock *, std::vector<std::pair<asg::Decl *, llvm::PHINode *>>> mIncompletePhis;
+
+    /// \p obj 去掉括号后是对 mSsaVars 中变量的引用时，返回该变量
+    asg::Decl *ssa_var(asg::Expr *obj);
+
+    /// 在基本块 \p bb 中读变量 \p var 的值，未封闭的基本块先放一个不完整的 phi
+    llvm::Value *read_var(asg::Decl *var, llvm::BasicBlock *bb);
+
+    /// 为 phi 填写来自各个前驱的操作数，返回去掉平凡 phi 后的值
+    llvm::Value *add_phi_operands(asg::Decl *var, llvm::PHINode *phi);
+
+    /// 操作数除自身外只有一个值的 phi 用该值替换，并检查用到它的 phi
+    llvm::Value *remove_trivial_phi(llvm::PHINode *phi);
+
+    /// 基本块 \p bb 的前驱都已确定，填写其中不完整的 phi
+    void seal(llvm::BasicBlock *bb);
+
+    /// 数组初始化中非零的常量元素不超过这么多个时，memset 后逐个写入，否则从常量模板 memcpy
+    static constexpr std::size_t kMaxInitStores = 8;
+
+    /// 数组初始化中需要单独写入的标量元素
+    struct InitElem
+    {
+        std::vector<llvm::Value *> mPath; /// 相对数组的 GEP 下标
+        llvm::Constant *mConst;           /// 非零的编译期常量值，不是常量时为空
+        asg::Expr *mExpr;
+    };
+
     //============================================================================
     // 类型
     //============================================================================
@@ -44,6 +135,9 @@ class EmitIR
 
     llvm::Value *operator()(asg::BinaryExpr *obj);
 
+    /// 已发射左操作数 \p lhs 后，发射 \p obj 的右操作数和它本身
+    llvm::Value *binary(asg::BinaryExpr *obj, llvm::Value *lhs);
+
     llvm::Value *operator()(asg::CallExpr *obj);
 
     llvm::Value *operator()(asg::ImplicitCastExpr *obj);
@@ -64,12 +158,24 @@ class EmitIR
 
     void operator()(asg::WhileStmt *obj);
 
+    void operator()(asg::DoStmt *obj);
+
     void operator()(asg::BreakStmt *obj);
 
     void operator()(asg::ContinueStmt *obj);
 
     void operator()(asg::ReturnStmt *obj);
 
+    /**
+     * @brief 翻译循环体 \p body 和位于其后的条件 \p cond
+     *
+     * 调用前已有跳到 \p bodyBeginBB 的入口。\p condBeginBB 是 continue 的目标，
+     * 在其中判断条件后跳回 \p bodyBeginBB 或跳到 \p endBB；没有 continue 时删去
+     * \p condBeginBB，直接在循环体末尾判断。结束时插入点位于 \p endBB。
+     */
+    void loop(asg::Stmt *body, asg::Expr *cond, llvm::BasicBlock *bodyBeginBB, llvm::BasicBlock *condBeginBB,
+              llvm::BasicBlock *endBB);
+
     //============================================================================
     // 声明
     //============================================================================
@@ -80,11 +186,55 @@ class EmitIR
 
     void operator()(asg::VarDecl *obj, bool global);
 
+    /// 在已创建的函数 \p func 中发射 \p obj 的函数体
+    void body(asg::FunctionDecl *obj, llvm::Function *func);
+
+    /// 分片中按名字声明全局变量或函数 \p obj，返回本模块中的声明
+    llvm::Constant *declare(asg::Decl *obj);
+
     //============================================================================
     // Utils
     //============================================================================
 
     llvm::Value *cast_to_i1(llvm::Value *i);
 
+    /**
+     * @brief 按条件 \p obj 的真假跳转到 \p trueBB 或 \p falseBB
+     *
+     * &&、|| 和 ! 直接翻译为跳转，比较的 i1 结果直接用于跳转，都不再求出 int
+     * 值后重新与零比较。结束时当前基本块已终结。
+     */
+    void cond_br(asg::Expr *obj, llvm::BasicBlock *trueBB, llvm::BasicBlock *falseBB);
+
+    /// 比较运算 \p op 的 i1 结果
+    llvm::Value *compare(asg::BinaryExpr::Op op, llvm::Value *lhs, llvm::Value *rhs);
+
+    /**
+     * @brief 在编译期求初始化表达式 \p obj 的值
+     *
+     * 支持整数字面量、算术、比较和逻辑运算、const 全局变量的值以及嵌套的初始化
+     * 列表，缺少的元素补零。不是编译期常量（如函数调用、非 const 变量），或者
+     * 求值是未定义行为（除以零、有符号溢出）时返回空指针，由调用者在运行时初始化。
+     */
+    llvm::Constant *constant(asg::Expr *obj);
+
+    /// 已求得左操作数 \p lhs 后，求 \p obj 的值
+    llvm::Constant *constant(asg::BinaryExpr *obj, llvm::Constant *lhs);
+
+    /**
+     * @brief 用 \p obj 初始化变量 \p var
+     *
+     * 数组先整体初始化为常量模板：模板全为零或只有少数非零元素时 memset 为零再
+     * 写入非零元素，否则从私有的常量全局变量 memcpy；然后写入不是编译期常量的
+     * 元素。
+     */
     void var_init(llvm::Value *var, asg::Expr *obj);
+
+    /**
+     * @brief 求初始化表达式 \p obj 的常量模板
+     *
+     * 编译期常量的元素取其值，其余元素取零。非零的常量元素和不是常量的元素连同
+     * 其下标（\p path 后接元素在各层的下标）记入 \p elems。
+     */
+    llvm::Constant *init_template(asg::Expr *obj, std::vector<llvm::Value *> &path, std::vector<InitElem> &elems);
 };
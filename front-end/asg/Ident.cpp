@@ -0,0 +1,91 @@
+#include "Ident.hpp"
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace asg
+{
+
+std::atomic<std::uint32_t> Ident::sCount{0};
+
+/// 全局字符串表，表项在大块内存中顺序分配
+struct Ident::Table
+{
+    static constexpr std::size_t kChunkSize = std::size_t(1) << 16;
+
+    std::shared_mutex mMutex;
+    std::unordered_map<std::string_view, const Entry *> mMap;
+    std::vector<std::unique_ptr<char[]>> mChunks;
+    char *mCur{nullptr}, *mEnd{nullptr};
+
+    static Table &get()
+    {
+        static Table table;
+        return table;
+    }
+
+    const Entry *intern(std::string_view str);
+
+  private:
+    void *alloc(std::size_t size);
+};
+
+const Ident::Entry *Ident::Table::intern(std::string_view str)
+{
+    {
+        std::shared_lock lock(mMutex);
+        auto iter = mMap.find(str);
+        if (iter != mMap.end())
+            return iter->second;
+    }
+
+    std::unique_lock lock(mMutex);
+    // 加锁的间隙里可能已经被别的线程驻留了
+    auto iter = mMap.find(str);
+    if (iter != mMap.end())
+        return iter->second;
+
+    auto entry = new (alloc(sizeof(Entry) + str.size() + 1)) Entry;
+    entry->id = sCount.load(std::memory_order_relaxed) + 1;
+    entry->len = str.size();
+    auto chars = const_cast<char *>(entry->chars());
+    std::memcpy(chars, str.data(), str.size());
+    chars[str.size()] = '\0';
+
+    mMap.emplace(std::string_view(chars, str.size()), entry);
+    sCount.store(entry->id, std::memory_order_release);
+    return entry;
+}
+
+void *Ident::Table::alloc(std::size_t size)
+{
+    size = (size + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+
+    // 过长的字符串单独分配，避免浪费当前块的剩余空间
+    if (size > kChunkSize / 4)
+    {
+        mChunks.emplace_back(new char[size]);
+        return mChunks.back().get();
+    }
+
+    if (mEnd - mCur < std::ptrdiff_t(size))
+    {
+        mChunks.emplace_back(new char[kChunkSize]);
+        mCur = mChunks.back().get(), mEnd = mCur + kChunkSize;
+    }
+    auto p = mCur;
+    mCur += size;
+    return p;
+}
+
+Ident::Ident(std::string_view str)
+{
+    if (!str.empty())
+        mEntry = Table::get().intern(str);
+}
+
+} // namespace asg
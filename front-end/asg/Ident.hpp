@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace asg
+{
+
+/**
+ * @brief 标识符
+ *
+ * 标识符的字符串驻留在全局的字符串表中，相同的字符串只保存一份，并按驻留的
+ * 先后编上 32 位的号（从 1 开始，0 表示空标识符），符号表直接用编号做下标。
+ * Ident 本身只是一个指向表项的指针，复制和比较都是常数开销，取字符串不需要
+ * 查表也不需要加锁。
+ *
+ * 字符串表是线程安全的，表项直到程序结束都不会释放。
+ */
+struct Ident
+{
+    Ident() = default;
+
+    /// 驻留字符串 \p str ，空字符串得到空标识符
+    explicit Ident(std::string_view str);
+
+    std::uint32_t id() const
+    {
+        return mEntry ? mEntry->id : 0;
+    }
+
+    /// 驻留的字符串，以 '\0' 结尾
+    std::string_view str() const
+    {
+        return mEntry ? std::string_view(mEntry->chars(), mEntry->len) : std::string_view("");
+    }
+
+    bool empty() const
+    {
+        return mEntry == nullptr;
+    }
+
+    bool operator==(Ident other) const
+    {
+        return mEntry == other.mEntry;
+    }
+
+    bool operator!=(Ident other) const
+    {
+        return mEntry != other.mEntry;
+    }
+
+    /// 已驻留的字符串数，也就是最大的编号
+    static std::uint32_t count()
+    {
+        return sCount.load(std::memory_order_acquire);
+    }
+
+  private:
+    struct Entry
+    {
+        std::uint32_t id;
+        std::uint32_t len;
+
+        const char *chars() const
+        {
+            return reinterpret_cast<const char *>(this + 1);
+        }
+    };
+
+    struct Table;
+
+    static std::atomic<std::uint32_t> sCount;
+
+    const Entry *mEntry{nullptr};
+};
+
+} // namespace asg
@@ -1,567 +1,941 @@
 #include "Json2Asg.hpp"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <llvm/Support/ConvertUTF.h>
 
 using namespace asg;
 
-TranslationUnit *Json2Asg::operator()(const llvm::json::Value &jval)
-{
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    ASSERT(jobj->getString("kind") == "TranslationUnitDecl");
-
-    auto inner = jobj->getArray("inner");
-    ASSERT(inner);
+using Kind = Json2Asg::Kind;
 
-    auto ret = make<TranslationUnit>();
-    for (auto &jval : *inner)
-    {
-        auto jobj = jval.getAsObject();
-        ASSERT(jobj);
-        if (auto p = decl(*jobj))
-            ret->decls.push_back(p);
-    }
-
-    return ret;
+TranslationUnit *Json2Asg::operator()(llvm::StringRef text)
+{
+    mBegin = mCur = text.begin();
+    mEnd = text.end();
+
+    skip_whitespace();
+    Kind kind;
+    auto ret = object(kind);
+    if (kind != Kind::kTranslationUnitDecl)
+        error("TranslationUnitDecl");
+    if (mCur != mEnd)
+        error("end of input");
+
+    return ret->scst<TranslationUnit>();
 }
 
 namespace
 {
 
-std::size_t jobj_id(const llvm::json::Object &jobj)
-{
-    auto id = jobj.getString("id");
-    ASSERT(id);
-    ASSERT(id->starts_with("0x"));
-    auto hexStr = id->substr(2).str();
-    return std::stoull(hexStr, nullptr, 16);
-}
-
-} // namespace
-
 //==============================================================================
-// 类型
+// 结点种类的完美哈希
 //==============================================================================
 
-const Type *Json2Asg::getty(const llvm::json::Object &jobj)
+struct KindName
 {
-    auto a = jobj.getObject("type");
-    ASSERT(a);
-    auto b = a->getString("qualType");
-    ASSERT(b);
-    auto texpStr = b->str();
-
-    auto iter = mTyMap.find(texpStr);
-    if (iter != mTyMap.end())
-        return iter->second;
+    std::string_view text;
+    Kind kind;
+};
+
+constexpr KindName kKindNames[] = {
+    {"TranslationUnitDecl", Kind::kTranslationUnitDecl},
+    {"TypedefDecl", Kind::kTypedefDecl},
+    {"VarDecl", Kind::kVarDecl},
+    {"ParmVarDecl", Kind::kParmVarDecl},
+    {"FunctionDecl", Kind::kFunctionDecl},
+    {"IntegerLiteral", Kind::kIntegerLiteral},
+    {"DeclRefExpr", Kind::kDeclRefExpr},
+    {"ParenExpr", Kind::kParenExpr},
+    {"UnaryOperator", Kind::kUnaryOperator},
+    {"BinaryOperator", Kind::kBinaryOperator},
+    {"ArraySubscriptExpr", Kind::kArraySubscriptExpr},
+    {"CallExpr", Kind::kCallExpr},
+    {"InitListExpr", Kind::kInitListExpr},
+    {"ImplicitValueInitExpr", Kind::kImplicitValueInitExpr},
+    {"ImplicitCastExpr", Kind::kImplicitCastExpr},
+    {"CompoundStmt", Kind::kCompoundStmt},
+    {"NullStmt", Kind::kNullStmt},
+    {"DeclStmt", Kind::kDeclStmt},
+    {"IfStmt", Kind::kIfStmt},
+    {"WhileStmt", Kind::kWhileStmt},
+    {"DoStmt", Kind::kDoStmt},
+    {"BreakStmt", Kind::kBreakStmt},
+    {"ContinueStmt", Kind::kContinueStmt},
+    {"ReturnStmt", Kind::kReturnStmt},
+};
+
+constexpr std::size_t kKindMinLen = 6;
 
-    const Type *ty;
-    auto s = parse_type(texpStr.c_str(), ty);
-    ASSERT(s && *s == '\0');
-    mTyMap.emplace(texpStr, ty);
-    return ty;
+/**
+ * @brief 种类名的哈希函数，对 kKindNames 无冲突（由下面的 static_assert 保证）。
+ *
+ * 系数是离线搜索得到的，只取长度、首字符和第 3 个字符，结果作为 64 项表的下标。
+ */
+constexpr std::uint8_t kind_hash(const char *s, std::size_t len)
+{
+    return std::uint8_t(len * 211 + std::uint8_t(s[0]) * 245 + std::uint8_t(s[2]) * 227) & 63;
 }
 
-//==============================================================================
-// 表达式
-//==============================================================================
-
-Expr *Json2Asg::expr(const llvm::json::Object &jobj)
+/// 哈希值到 kKindNames 下标加一的映射，0 表示不认识的种类
+constexpr std::array<std::uint8_t, 64> make_kind_table()
 {
-    auto kind = jobj.getString("kind");
-    ASSERT(kind);
-
-    Expr *ret;
+    std::array<std::uint8_t, 64> ret{};
+    for (std::size_t i = 0; i < std::size(kKindNames); ++i)
+        ret[kind_hash(kKindNames[i].text.data(), kKindNames[i].text.size())] = i + 1;
+    return ret;
+}
 
-    if (kind == "IntegerLiteral")
-        ret = integer_literal(jobj);
+constexpr auto kKindTable = make_kind_table();
 
-    else if (kind == "BinaryOperator")
-        ret = binary_expr(jobj);
+constexpr bool kind_hash_is_perfect()
+{
+    for (std::size_t i = 0; i < std::size(kKindNames); ++i)
+    {
+        auto &kn = kKindNames[i];
+        if (kn.text.size() < kKindMinLen)
+            return false;
+        if (kKindTable[kind_hash(kn.text.data(), kn.text.size())] != i + 1)
+            return false;
+    }
+    return true;
+}
 
-    else if (kind == "UnaryOperator")
-        ret = unary_expr(jobj);
+static_assert(kind_hash_is_perfect(), "种类名哈希有冲突，需要重新搜索系数");
 
-    else if (kind == "DeclRefExpr")
-        ret = decl_ref_expr(jobj);
+Kind kind_of(std::string_view s)
+{
+    if (s.size() < kKindMinLen)
+        return Kind::kINVALID;
+    auto i = kKindTable[kind_hash(s.data(), s.size())];
+    if (i != 0 && kKindNames[i - 1].text == s)
+        return kKindNames[i - 1].kind;
+    return Kind::kINVALID;
+}
 
-    else if (kind == "ImplicitCastExpr")
-        ret = implicit_cast_expr(jobj);
+constexpr bool is_decl(Kind kind)
+{
+    return Kind::kTranslationUnitDecl <= kind && kind <= Kind::kFunctionDecl;
+}
 
-    else if (kind == "ParenExpr")
-        ret = paren_expr(jobj);
+constexpr bool is_expr(Kind kind)
+{
+    return Kind::kIntegerLiteral <= kind && kind <= Kind::kImplicitCastExpr;
+}
 
-    else if (kind == "InitListExpr")
-        ret = init_list_expr(jobj);
+constexpr bool is_stmt(Kind kind)
+{
+    return Kind::kCompoundStmt <= kind && kind <= Kind::kReturnStmt;
+}
 
-    else if (kind == "ImplicitValueInitExpr")
-        ret = implicit_init_expr(jobj);
+//==============================================================================
+// 运算符
+//==============================================================================
 
-    else if (kind == "ArraySubscriptExpr")
-        ret = binary_expr(jobj);
+/// 把至多两个字符的运算符压成一个整数，便于 switch
+constexpr unsigned op_key(std::string_view s)
+{
+    return s.size() == 1 ? unsigned(s[0]) : s.size() == 2 ? unsigned(s[0]) | unsigned(s[1]) << 8 : 0;
+}
 
-    else if (kind == "CallExpr")
-        ret = call_expr(jobj);
+constexpr unsigned op_key(char a, char b = '\0')
+{
+    return unsigned(a) | unsigned(b) << 8;
+}
 
-    else
+UnaryExpr::Op unary_op(std::string_view s)
+{
+    switch (op_key(s))
+    {
+    case op_key('+'):
+        return UnaryExpr::kPos;
+    case op_key('-'):
+        return UnaryExpr::kNeg;
+    case op_key('!'):
+        return UnaryExpr::kNot;
+    default:
         ABORT();
+    }
+}
 
-    auto cateVal = jobj.get("valueCategory");
-    ASSERT(cateVal);
-    auto cate = cateVal->getAsString();
-    ASSERT(cate);
-    if (cate == "lvalue")
-        ret->cate = Expr::Cate::kLValue;
-    else if (cate == "prvalue")
-        ret->cate = Expr::Cate::kRValue;
-    else
+BinaryExpr::Op binary_op(std::string_view s)
+{
+    switch (op_key(s))
+    {
+    case op_key('*'):
+        return BinaryExpr::kMul;
+    case op_key('/'):
+        return BinaryExpr::kDiv;
+    case op_key('%'):
+        return BinaryExpr::kMod;
+    case op_key('+'):
+        return BinaryExpr::kAdd;
+    case op_key('-'):
+        return BinaryExpr::kSub;
+    case op_key('>'):
+        return BinaryExpr::kGt;
+    case op_key('<'):
+        return BinaryExpr::kLt;
+    case op_key('>', '='):
+        return BinaryExpr::kGe;
+    case op_key('<', '='):
+        return BinaryExpr::kLe;
+    case op_key('=', '='):
+        return BinaryExpr::kEq;
+    case op_key('!', '='):
+        return BinaryExpr::kNe;
+    case op_key('&', '&'):
+        return BinaryExpr::kAnd;
+    case op_key('|', '|'):
+        return BinaryExpr::kOr;
+    case op_key('='):
+        return BinaryExpr::kAssign;
+    default:
         ABORT();
-
-    return ret;
+    }
 }
 
-IntegerLiteral *Json2Asg::integer_literal(const llvm::json::Object &jobj)
+decltype(ImplicitCastExpr::castKind) cast_kind(std::string_view s)
 {
-    auto integerLiteral = make<IntegerLiteral>();
-
-    integerLiteral->type = getty(jobj);
-
-    auto value = jobj.getString("value");
-    ASSERT(value);
-
-    integerLiteral->val = std::stoull(value->str());
-
-    return integerLiteral;
+    if (s == "LValueToRValue")
+        return ImplicitCastExpr::kLValueToRValue;
+    if (s == "ArrayToPointerDecay")
+        return ImplicitCastExpr::kArrayToPointerDecay;
+    if (s == "FunctionToPointerDecay")
+        return ImplicitCastExpr::kFunctionToPointerDecay;
+    ABORT();
 }
 
-DeclRefExpr *Json2Asg::decl_ref_expr(const llvm::json::Object &jobj)
+int hex_digit(char c)
 {
-    auto declRefExpr = make<DeclRefExpr>();
+    if ('0' <= c && c <= '9')
+        return c - '0';
+    if ('a' <= c && c <= 'f')
+        return c - 'a' + 10;
+    if ('A' <= c && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
 
-    declRefExpr->type = getty(jobj);
+} // namespace
 
-    auto ref = jobj.getObject("referencedDecl");
-    ASSERT(ref);
-    std::size_t id = jobj_id(*ref);
-    auto refObj = mIdMap[id]->dcst<Decl>();
-    ASSERT(refObj);
-    declRefExpr->decl = refObj;
+//==============================================================================
+// JSON 扫描
+//==============================================================================
 
-    return declRefExpr;
+void Json2Asg::skip_whitespace()
+{
+    while (mCur != mEnd && (*mCur == ' ' || *mCur == '\n' || *mCur == '\r' || *mCur == '\t'))
+        ++mCur;
 }
 
-ParenExpr *Json2Asg::paren_expr(const llvm::json::Object &jobj)
+void Json2Asg::expect(char c)
 {
-    auto parenExpr = make<ParenExpr>();
-
-    parenExpr->type = getty(jobj);
-
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
-
-    parenExpr->sub = expr(*inner->front().getAsObject());
-    return parenExpr;
+    if (!accept(c))
+    {
+        const char what[] = {'\'', c, '\'', '\0'};
+        error(what);
+    }
 }
 
-UnaryExpr *Json2Asg::unary_expr(const llvm::json::Object &jobj)
+bool Json2Asg::accept(char c)
 {
-    auto unaryExpr = make<UnaryExpr>();
-
-    unaryExpr->type = getty(jobj);
+    if (mCur == mEnd || *mCur != c)
+        return false;
+    ++mCur;
+    skip_whitespace();
+    return true;
+}
 
-    auto opCode = jobj.getString("opcode");
-    ASSERT(opCode);
-    if (opCode == "-")
-    {
-        unaryExpr->op = UnaryExpr::Op::kNeg;
-    }
-    else if (opCode == "!")
-    {
-        unaryExpr->op = UnaryExpr::Op::kNot;
-    }
-    else if (opCode == "+")
-    {
-        unaryExpr->op = UnaryExpr::Op::kPos;
-    }
-    else
+std::string_view Json2Asg::string()
+{
+    if (mCur == mEnd || *mCur != '"')
+        error("string");
+
+    // 不含转义时直接返回原文上的视图，这是绝大多数情况
+    auto begin = ++mCur;
+    while (mCur != mEnd && *mCur != '"' && *mCur != '\\')
+        ++mCur;
+    if (mCur != mEnd && *mCur == '"')
     {
-        ABORT();
+        std::string_view ret(begin, mCur - begin);
+        ++mCur;
+        skip_whitespace();
+        return ret;
     }
 
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
-
-    unaryExpr->sub = expr(*(inner->front().getAsObject()));
-
-    return unaryExpr;
-}
-
-BinaryExpr *Json2Asg::binary_expr(const llvm::json::Object &jobj)
-{
-    auto kind = jobj.getString("kind");
-    ASSERT(kind);
-
-    auto binaryExpr = make<BinaryExpr>();
-    binaryExpr->type = getty(jobj);
-
-    if (kind == "ArraySubscriptExpr")
-        binaryExpr->op = BinaryExpr::Op::kIndex;
-    else
-    {
-        auto opCode = jobj.getString("opcode");
-        ASSERT(opCode);
-
-        if (opCode == "*")
-            binaryExpr->op = BinaryExpr::Op::kMul;
-        else if (opCode == "/")
-            binaryExpr->op = BinaryExpr::Op::kDiv;
-        else if (opCode == "%")
-            binaryExpr->op = BinaryExpr::Op::kMod;
-        else if (opCode == "+")
-            binaryExpr->op = BinaryExpr::Op::kAdd;
-        else if (opCode == "-")
-            binaryExpr->op = BinaryExpr::Op::kSub;
-        else if (opCode == ">")
-            binaryExpr->op = BinaryExpr::Op::kGt;
-        else if (opCode == "<")
-            binaryExpr->op = BinaryExpr::Op::kLt;
-        else if (opCode == ">=")
-            binaryExpr->op = BinaryExpr::Op::kGe;
-        else if (opCode == "<=")
-            binaryExpr->op = BinaryExpr::Op::kLe;
-        else if (opCode == "==")
-            binaryExpr->op = BinaryExpr::Op::kEq;
-        else if (opCode == "!=")
-            binaryExpr->op = BinaryExpr::Op::kNe;
-        else if (opCode == "&&")
-            binaryExpr->op = BinaryExpr::Op::kAnd;
-        else if (opCode == "||")
-            binaryExpr->op = BinaryExpr::Op::kOr;
-        else if (opCode == "=")
-            binaryExpr->op = BinaryExpr::Op::kAssign;
-        else
+    mScratch.assign(begin, mCur);
+    while (true)
+    {
+        if (mCur == mEnd)
+            error("'\"'");
+        auto c = *mCur++;
+        if (c == '"')
+            break;
+        if (c != '\\')
         {
-            ABORT();
+            mScratch.push_back(c);
+            continue;
         }
-    }
 
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
+        if (mCur == mEnd)
+            error("escape sequence");
+        switch (c = *mCur++)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            mScratch.push_back(c);
+            break;
 
-    binaryExpr->lft = expr(*inner->front().getAsObject());
-    binaryExpr->rht = expr(*(*inner)[1].getAsObject());
+        case 'b':
+            mScratch.push_back('\b');
+            break;
 
-    return binaryExpr;
-}
+        case 'f':
+            mScratch.push_back('\f');
+            break;
 
-CallExpr *Json2Asg::call_expr(const llvm::json::Object &jobj)
-{
-    auto callExpr = make<CallExpr>();
-    callExpr->type = getty(jobj);
+        case 'n':
+            mScratch.push_back('\n');
+            break;
 
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
+        case 'r':
+            mScratch.push_back('\r');
+            break;
 
-    callExpr->head = expr(*inner->front().getAsObject());
+        case 't':
+            mScratch.push_back('\t');
+            break;
 
-    for (std::uint32_t i = 1; i < inner->size(); ++i)
-    {
-        callExpr->args.push_back(expr(*(*inner)[i].getAsObject()));
+        case 'u': {
+            auto hex4 = [&] {
+                unsigned cp = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    int d;
+                    if (mCur == mEnd || (d = hex_digit(*mCur)) < 0)
+                        error("hex digit");
+                    cp = cp * 16 + d, ++mCur;
+                }
+                return cp;
+            };
+
+            auto cp = hex4();
+            // 代理对
+            if (0xD800 <= cp && cp < 0xDC00 && mEnd - mCur >= 6 && mCur[0] == '\\' && mCur[1] == 'u')
+            {
+                mCur += 2;
+                auto lo = hex4();
+                if (lo < 0xDC00 || lo >= 0xE000)
+                    error("low surrogate");
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+
+            char buf[4], *p = buf;
+            if (!llvm::ConvertCodePointToUTF8(cp, p))
+                error("code point");
+            mScratch.append(buf, p);
+            break;
+        }
+
+        default:
+            error("escape sequence");
+        }
     }
 
-    return callExpr;
+    skip_whitespace();
+    return mScratch;
 }
 
-InitListExpr *Json2Asg::init_list_expr(const llvm::json::Object &jobj)
+std::size_t Json2Asg::hex_id()
 {
-    auto initListExpr = make<InitListExpr>();
+    auto s = string();
+    if (s.size() < 3 || s[0] != '0' || s[1] != 'x')
+        error("id");
 
-    initListExpr->type = getty(jobj);
-
-    auto initList = jobj.getArray("inner");
-    if (!initList)
+    std::size_t ret = 0;
+    for (auto c : s.substr(2))
     {
-        initList = jobj.getArray("array_filler");
+        auto d = hex_digit(c);
+        if (d < 0)
+            error("id");
+        ret = ret * 16 + d;
     }
-    ASSERT(initList);
-
-    for (auto &value : *initList)
-    {
-        auto object = value.getAsObject();
-        ASSERT(object);
-
-        if (auto pExpr = expr(*object))
-            initListExpr->list.push_back(pExpr);
-    }
-
-    return initListExpr;
+    return ret;
 }
 
-ImplicitInitExpr *Json2Asg::implicit_init_expr(const llvm::json::Object &jobj)
+void Json2Asg::skip_value()
 {
-    auto implicitInitExpr = make<ImplicitInitExpr>();
-    implicitInitExpr->type = getty(jobj);
-    return implicitInitExpr;
+    if (mCur == mEnd)
+        error("value");
+
+    switch (*mCur)
+    {
+    case '"':
+        string();
+        return;
+
+    case '{':
+        expect('{');
+        if (accept('}'))
+            return;
+        do
+        {
+            string();
+            expect(':');
+            skip_value();
+        } while (accept(','));
+        expect('}');
+        return;
+
+    case '[':
+        expect('[');
+        if (accept(']'))
+            return;
+        do
+            skip_value();
+        while (accept(','));
+        expect(']');
+        return;
+
+    default: {
+        // 数、true、false、null
+        auto begin = mCur;
+        while (mCur != mEnd && (std::isalnum(std::uint8_t(*mCur)) || *mCur == '-' || *mCur == '+' || *mCur == '.'))
+            ++mCur;
+        if (mCur == begin)
+            error("value");
+        skip_whitespace();
+    }
+    }
 }
 
-ImplicitCastExpr *Json2Asg::implicit_cast_expr(const llvm::json::Object &jobj)
+void Json2Asg::error(const char *what)
 {
-    auto implicitCastExpr = make<ImplicitCastExpr>();
-    implicitCastExpr->type = getty(jobj);
-
-    auto castKind = jobj.getString("castKind");
-    ASSERT(castKind);
-
-    if (castKind == "LValueToRValue")
-        implicitCastExpr->kind = ImplicitCastExpr::kLValueToRValue;
-    else if (castKind == "ArrayToPointerDecay")
-        implicitCastExpr->kind = ImplicitCastExpr::kArrayToPointerDecay;
-    else if (castKind == "FunctionToPointerDecay")
-        implicitCastExpr->kind = ImplicitCastExpr::kFunctionToPointerDecay;
-    else
-        ABORT();
-
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
-
-    implicitCastExpr->sub = expr(*inner->front().getAsObject());
-
-    return implicitCastExpr;
+    auto line = 1 + std::count(mBegin, mCur, '\n');
+    auto sol = std::find(std::make_reverse_iterator(mCur), std::make_reverse_iterator(mBegin), '\n').base();
+    std::cerr << "line " << line << ":" << (mCur - sol) << " expected " << what << '\n';
+    ABORT();
 }
 
 //==============================================================================
-// 声明
+// 结点
 //==============================================================================
 
-Decl *Json2Asg::decl(const llvm::json::Object &jobj)
+Obj *Json2Asg::object(Kind &kind)
 {
-    auto kind = jobj.getString("kind");
-    ASSERT(kind);
-
-    if (kind == "VarDecl")
-        return var_decl(jobj);
+    Node node;
+    // 循环语句在读到 "inner" 时设置 mCurLoop，出了这个结点后恢复为外层的循环
+    auto loop = mCurLoop;
 
-    if (kind == "FunctionDecl")
-        return function_decl(jobj);
-
-    if (kind == "ParmVarDecl")
-        return var_decl(jobj);
-
-    if (kind == "TypedefDecl")
-        return nullptr;
+    expect('{');
+    if (!accept('}'))
+    {
+        do
+        {
+            auto key = string();
+            expect(':');
+            attribute(node, key);
+        } while (accept(','));
+        expect('}');
+    }
 
-    ABORT();
+    finish(node);
+    mCurLoop = loop;
+    kind = node.kind;
+    return node.skip ? nullptr : node.obj;
 }
 
-VarDecl *Json2Asg::var_decl(const llvm::json::Object &jobj)
+void Json2Asg::attribute(Node &node, std::string_view key)
 {
-    auto varDecl = make<VarDecl>(jobj_id(jobj));
+    if (key == "kind")
+    {
+        node.kind = kind_of(string());
+        if (node.kind == Kind::kINVALID)
+            error("supported kind");
+        if (node.kind == Kind::kTypedefDecl)
+            node.skip = true;
+        return;
+    }
 
-    auto name = jobj.getString("name");
-    ASSERT(name);
-    varDecl->name = name->str();
+    if (node.skip)
+        return skip_value();
 
-    varDecl->type = getty(jobj);
+    if (key == "inner" || key == "array_filler")
+    {
+        // InitListExpr 同时有两者时只取 "inner"
+        if (key == "array_filler" && node.inner)
+            return skip_value();
+
+        begin(node, key == "inner");
+        expect('[');
+        if (accept(']'))
+            return;
+        do
+        {
+            Kind kind;
+            auto child = object(kind);
+            add(node, kind, child);
+        } while (accept(','));
+        expect(']');
+        return;
+    }
 
-    auto inner = jobj.getArray("inner");
-    if (inner)
-        varDecl->init = expr(*inner->front().getAsObject());
-    else
-        varDecl->init = nullptr;
+    if (key == "id")
+    {
+        node.id = hex_id();
+        return;
+    }
 
-    return varDecl;
-}
+    if (key == "type")
+    {
+        expect('{');
+        do
+        {
+            if (string() == "qualType")
+            {
+                expect(':');
+                node.type = getty(string());
+            }
+            else
+            {
+                expect(':');
+                skip_value();
+            }
+        } while (accept(','));
+        expect('}');
+        return;
+    }
 
-FunctionDecl *Json2Asg::function_decl(const llvm::json::Object &jobj)
-{
-    if (jobj.getBoolean("isImplicit") && jobj.getBoolean("isImplicit") == true)
-        return nullptr;
+    if (key == "valueCategory")
+    {
+        auto cate = string();
+        if (cate == "lvalue")
+            node.cate = Expr::Cate::kLValue;
+        else if (cate == "prvalue")
+            node.cate = Expr::Cate::kRValue;
+        else
+            ABORT();
+        return;
+    }
 
-    auto funcDecl = make<FunctionDecl>(jobj_id(jobj));
+    if (key == "name")
+    {
+        node.name = Ident(string());
+        return;
+    }
 
-    auto name = jobj.getString("name");
-    funcDecl->name = name->str();
+    if (key == "opcode")
+    {
+        if (node.kind == Kind::kUnaryOperator)
+            node.op = unary_op(string());
+        else
+            node.op = binary_op(string());
+        return;
+    }
 
-    funcDecl->type = getty(jobj);
+    if (key == "castKind")
+    {
+        node.op = cast_kind(string());
+        return;
+    }
 
-    auto inner = jobj.getArray("inner");
-    if (!inner)
+    if (key == "value" && node.kind == Kind::kIntegerLiteral)
     {
-        funcDecl->body = nullptr;
-        return funcDecl;
+        auto s = string();
+        if (s.empty())
+            error("integer");
+        std::uint64_t val = 0;
+        for (auto c : s)
+        {
+            if (c < '0' || c > '9')
+                error("integer");
+            val = val * 10 + (c - '0');
+        }
+        node.value = val;
+        return;
     }
 
-    mCurFunc = funcDecl;
-    for (auto &value : *inner)
+    if (key == "referencedDecl")
     {
-        auto object = value.getAsObject();
-        ASSERT(object);
+        expect('{');
+        do
+        {
+            if (string() == "id")
+            {
+                expect(':');
+                node.ref = hex_id();
+            }
+            else
+            {
+                expect(':');
+                skip_value();
+            }
+        } while (accept(','));
+        expect('}');
+        return;
+    }
 
-        auto kind = object->getString("kind");
-        ASSERT(kind);
+    if (key == "isImplicit" && node.kind == Kind::kFunctionDecl)
+    {
+        if (mEnd - mCur >= 4 && std::string_view(mCur, 4) == "true")
+            node.skip = true;
+        return skip_value();
+    }
 
-        if (kind == "ParmVarDecl")
-        {
-            funcDecl->params.push_back(decl(*object));
-            continue;
-        }
+    skip_value();
+}
 
-        if (kind == "CompoundStmt")
+void Json2Asg::begin(Node &node, bool inner)
+{
+    if (inner)
+    {
+        if (node.obj != nullptr && node.kind == Kind::kInitListExpr)
         {
-            ASSERT(funcDecl->body == nullptr);
-            funcDecl->body = compound_stmt(*object);
-            continue;
+            node.obj->scst<InitListExpr>()->list.clear();
+            node.n = 0;
         }
-        ABORT();
+        node.inner = true;
     }
 
-    return funcDecl;
-}
+    if (node.obj != nullptr)
+        return;
 
-//==============================================================================
-// 语句
-//==============================================================================
+    switch (node.kind)
+    {
+    case Kind::kTranslationUnitDecl:
+        node.obj = make<TranslationUnit>();
+        break;
+
+    case Kind::kVarDecl:
+    case Kind::kParmVarDecl:
+        node.obj = make<VarDecl>(node.id);
+        break;
+
+    case Kind::kFunctionDecl: {
+        auto p = make<FunctionDecl>(node.id);
+        if (inner)
+            mCurFunc = p;
+        node.obj = p;
+        break;
+    }
 
-Stmt *Json2Asg::stmt(const llvm::json::Object &jobj)
-{
-    auto kind = jobj.getString("kind");
-    ASSERT(kind);
+    case Kind::kIntegerLiteral:
+        node.obj = make<IntegerLiteral>();
+        break;
 
-    if (kind == "DeclStmt")
-        return decl_stmt(jobj);
+    case Kind::kDeclRefExpr:
+        node.obj = make<DeclRefExpr>();
+        break;
 
-    if (kind == "ReturnStmt")
-        return return_stmt(jobj);
+    case Kind::kParenExpr:
+        node.obj = make<ParenExpr>();
+        break;
 
-    if (kind == "BinaryOperator")
-        return expr_stmt(jobj);
+    case Kind::kUnaryOperator:
+        node.obj = make<UnaryExpr>();
+        break;
 
-    if (kind == "UnaryOperator")
-        return expr_stmt(jobj);
+    case Kind::kBinaryOperator:
+    case Kind::kArraySubscriptExpr:
+        node.obj = make<BinaryExpr>();
+        break;
 
-    if (kind == "CallExpr")
-        return expr_stmt(jobj);
+    case Kind::kCallExpr:
+        node.obj = make<CallExpr>();
+        break;
 
-    if (kind == "IfStmt")
-        return if_stmt(jobj);
+    case Kind::kInitListExpr:
+        node.obj = make<InitListExpr>();
+        break;
 
-    if (kind == "WhileStmt")
-        return while_stmt(jobj);
+    case Kind::kImplicitValueInitExpr:
+        node.obj = make<ImplicitInitExpr>();
+        break;
 
-    if (kind == "NullStmt")
-        return null_stmt(jobj);
+    case Kind::kImplicitCastExpr:
+        node.obj = make<ImplicitCastExpr>();
+        break;
 
-    if (kind == "CompoundStmt")
-        return compound_stmt(jobj);
+    case Kind::kCompoundStmt:
+        node.obj = make<CompoundStmt>();
+        break;
 
-    if (kind == "ContinueStmt")
-        return continue_stmt(jobj);
+    case Kind::kNullStmt:
+        node.obj = make<NullStmt>();
+        break;
 
-    if (kind == "BreakStmt")
-        return break_stmt(jobj);
+    case Kind::kDeclStmt:
+        node.obj = make<DeclStmt>();
+        break;
 
-    ABORT();
-}
+    case Kind::kIfStmt:
+        node.obj = make<IfStmt>();
+        break;
 
-CompoundStmt *Json2Asg::compound_stmt(const llvm::json::Object &jobj)
-{
-    auto compoundStmt = make<CompoundStmt>();
+    case Kind::kWhileStmt: {
+        auto p = make<WhileStmt>();
+        mCurLoop = p;
+        node.obj = p;
+        break;
+    }
 
-    auto inner = jobj.getArray("inner");
-    if (!inner)
-        return compoundStmt;
+    case Kind::kDoStmt: {
+        auto p = make<DoStmt>();
+        mCurLoop = p;
+        node.obj = p;
+        break;
+    }
 
-    for (auto &value : *inner)
-    {
-        auto object = value.getAsObject();
-        ASSERT(object);
+    case Kind::kBreakStmt: {
+        auto p = make<BreakStmt>();
+        p->loop = mCurLoop;
+        node.obj = p;
+        break;
+    }
+
+    case Kind::kContinueStmt: {
+        auto p = make<ContinueStmt>();
+        p->loop = mCurLoop;
+        node.obj = p;
+        break;
+    }
 
-        compoundStmt->subs.push_back(stmt(*object));
+    case Kind::kReturnStmt: {
+        auto p = make<ReturnStmt>();
+        p->func = mCurFunc;
+        node.obj = p;
+        break;
+    }
+
+    default:
+        error("\"kind\" before \"inner\"");
     }
-    return compoundStmt;
 }
 
-DeclStmt *Json2Asg::decl_stmt(const llvm::json::Object &jobj)
+void Json2Asg::add(Node &node, Kind kind, Obj *child)
 {
-    auto declStmt = make<DeclStmt>();
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
+    auto i = node.n++;
 
-    for (auto &value : *inner)
+    switch (node.kind)
     {
-        auto object = value.getAsObject();
-        ASSERT(object);
-        if (auto pDecl = decl(*object))
-            declStmt->decls.push_back(pDecl);
+    case Kind::kTranslationUnitDecl:
+        if (child)
+            node.obj->scst<TranslationUnit>()->decls.push_back(as_decl(kind, child));
+        break;
+
+    case Kind::kVarDecl:
+    case Kind::kParmVarDecl:
+        if (i == 0)
+            node.obj->scst<VarDecl>()->init = as_expr(kind, child);
+        break;
+
+    case Kind::kFunctionDecl: {
+        auto p = node.obj->scst<FunctionDecl>();
+        if (kind == Kind::kParmVarDecl)
+            p->params.push_back(as_decl(kind, child));
+        else if (kind == Kind::kCompoundStmt)
+        {
+            ASSERT(p->body == nullptr);
+            p->body = static_cast<CompoundStmt *>(child);
+        }
+        else
+            ABORT();
+        break;
     }
 
-    return declStmt;
+    case Kind::kParenExpr:
+        if (i == 0)
+            node.obj->scst<ParenExpr>()->sub = as_expr(kind, child);
+        break;
+
+    case Kind::kUnaryOperator:
+        if (i == 0)
+            node.obj->scst<UnaryExpr>()->sub = as_expr(kind, child);
+        break;
+
+    case Kind::kBinaryOperator:
+    case Kind::kArraySubscriptExpr:
+        if (i == 0)
+            node.obj->scst<BinaryExpr>()->lft = as_expr(kind, child);
+        else if (i == 1)
+            node.obj->scst<BinaryExpr>()->rht = as_expr(kind, child);
+        break;
+
+    case Kind::kCallExpr:
+        if (i == 0)
+            node.obj->scst<CallExpr>()->head = as_expr(kind, child);
+        else
+            node.obj->scst<CallExpr>()->args.push_back(as_expr(kind, child));
+        break;
+
+    case Kind::kInitListExpr:
+        node.obj->scst<InitListExpr>()->list.push_back(as_expr(kind, child));
+        break;
+
+    case Kind::kImplicitCastExpr:
+        if (i == 0)
+            node.obj->scst<ImplicitCastExpr>()->sub = as_expr(kind, child);
+        break;
+
+    case Kind::kCompoundStmt:
+        node.obj->scst<CompoundStmt>()->subs.push_back(as_stmt(kind, child));
+        break;
+
+    case Kind::kDeclStmt:
+        if (child)
+            node.obj->scst<DeclStmt>()->decls.push_back(as_decl(kind, child));
+        break;
+
+    case Kind::kIfStmt:
+        if (i == 0)
+            node.obj->scst<IfStmt>()->cond = as_expr(kind, child);
+        else if (i == 1)
+            node.obj->scst<IfStmt>()->then = as_stmt(kind, child);
+        else if (i == 2)
+            node.obj->scst<IfStmt>()->else_ = as_stmt(kind, child);
+        break;
+
+    case Kind::kWhileStmt:
+        if (i == 0)
+            node.obj->scst<WhileStmt>()->cond = as_expr(kind, child);
+        else if (i == 1)
+            node.obj->scst<WhileStmt>()->body = as_stmt(kind, child);
+        break;
+
+    case Kind::kDoStmt:
+        if (i == 0)
+            node.obj->scst<DoStmt>()->body = as_stmt(kind, child);
+        else if (i == 1)
+            node.obj->scst<DoStmt>()->cond = as_expr(kind, child);
+        break;
+
+    case Kind::kReturnStmt:
+        if (i == 0)
+            node.obj->scst<ReturnStmt>()->expr = as_expr(kind, child);
+        break;
+
+    default:
+        break;
+    }
 }
 
-ReturnStmt *Json2Asg::return_stmt(const llvm::json::Object &jobj)
+void Json2Asg::finish(Node &node)
 {
-    auto returnStmt = make<ReturnStmt>();
+    if (node.kind == Kind::kINVALID)
+        error("\"kind\"");
+    if (node.skip)
+        return;
 
-    returnStmt->func = mCurFunc;
+    begin(node, false);
 
-    auto inner = jobj.getArray("inner");
-    if (inner)
-        returnStmt->expr = expr(*inner->front().getAsObject());
+    if (is_decl(node.kind) && node.kind != Kind::kTranslationUnitDecl)
+    {
+        auto p = static_cast<Decl *>(node.obj);
+        ASSERT(node.type);
+        p->type = node.type;
+        p->name = node.name;
+        return;
+    }
 
-    return returnStmt;
-}
+    if (!is_expr(node.kind))
+        return;
 
-IfStmt *Json2Asg::if_stmt(const llvm::json::Object &jobj)
-{
-    auto ifStmt = make<IfStmt>();
+    auto expr = static_cast<Expr *>(node.obj);
+    ASSERT(node.type);
+    expr->type = node.type;
+    ASSERT(node.cate != Expr::Cate::kINVALID);
+    expr->cate = node.cate;
 
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
+    switch (node.kind)
+    {
+    case Kind::kIntegerLiteral:
+        expr->scst<IntegerLiteral>()->val = node.value;
+        break;
+
+    case Kind::kDeclRefExpr: {
+        auto decl = mIdMap[node.ref];
+        ASSERT(decl);
+        expr->scst<DeclRefExpr>()->decl = decl;
+        break;
+    }
 
-    ifStmt->cond = expr(*(inner->front().getAsObject()));
-    ifStmt->then = stmt(*((*inner)[1].getAsObject()));
-    if (inner->size() == 3)
-        ifStmt->else_ = stmt(*((*inner)[2].getAsObject()));
+    case Kind::kParenExpr:
+        ASSERT(expr->scst<ParenExpr>()->sub);
+        break;
 
-    return ifStmt;
-}
+    case Kind::kUnaryOperator: {
+        auto p = expr->scst<UnaryExpr>();
+        ASSERT(p->sub);
+        p->op = UnaryExpr::Op(node.op);
+        break;
+    }
 
-WhileStmt *Json2Asg::while_stmt(const llvm::json::Object &jobj)
-{
-    auto whileStmt = make<WhileStmt>();
-    mCurLoop = whileStmt;
+    case Kind::kBinaryOperator:
+    case Kind::kArraySubscriptExpr: {
+        auto p = expr->scst<BinaryExpr>();
+        ASSERT(p->lft && p->rht);
+        p->op = node.kind == Kind::kArraySubscriptExpr ? BinaryExpr::kIndex : BinaryExpr::Op(node.op);
+        break;
+    }
 
-    auto inner = jobj.getArray("inner");
-    ASSERT(inner);
+    case Kind::kCallExpr:
+        ASSERT(expr->scst<CallExpr>()->head);
+        break;
 
-    whileStmt->cond = expr(*(inner->front().getAsObject()));
-    whileStmt->body = stmt(*((*inner)[1].getAsObject()));
+    case Kind::kImplicitCastExpr: {
+        auto p = expr->scst<ImplicitCastExpr>();
+        ASSERT(p->sub);
+        p->castKind = decltype(p->castKind)(node.op);
+        break;
+    }
 
-    return whileStmt;
+    default:
+        break;
+    }
 }
 
-NullStmt *Json2Asg::null_stmt(const llvm::json::Object &jobj)
+Decl *Json2Asg::as_decl(Kind kind, Obj *obj)
 {
-    return make<NullStmt>();
+    ASSERT(obj && is_decl(kind) && kind != Kind::kTranslationUnitDecl);
+    return static_cast<Decl *>(obj);
 }
 
-BreakStmt *Json2Asg::break_stmt(const llvm::json::Object &jobj)
+Expr *Json2Asg::as_expr(Kind kind, Obj *obj)
 {
-    auto ret = make<BreakStmt>();
-    ret->loop = mCurLoop;
-    return ret;
+    ASSERT(obj && is_expr(kind));
+    return static_cast<Expr *>(obj);
 }
 
-ContinueStmt *Json2Asg::continue_stmt(const llvm::json::Object &jobj)
+Stmt *Json2Asg::as_stmt(Kind kind, Obj *obj)
 {
-    auto ret = make<ContinueStmt>();
-    ret->loop = mCurLoop;
-    return ret;
+    ASSERT(obj);
+    if (is_expr(kind))
+    {
+        auto exprStmt = make<ExprStmt>();
+        exprStmt->expr = static_cast<Expr *>(obj);
+        return exprStmt;
+    }
+    ASSERT(is_stmt(kind));
+    return static_cast<Stmt *>(obj);
 }
 
-ExprStmt *Json2Asg::expr_stmt(const llvm::json::Object &jobj)
+//==============================================================================
+// 类型
+//==============================================================================
+
+const Type *Json2Asg::getty(std::string_view texpStr)
 {
-    auto exprStmt = make<ExprStmt>();
-    exprStmt->expr = expr(jobj);
-    return exprStmt;
+    auto [iter, inserted] = mTyMap.try_emplace(llvm::StringRef(texpStr.data(), texpStr.size()), nullptr);
+    if (!inserted)
+        return iter->second;
+
+    // StringMap 的键以零结尾，可以直接交给解析函数
+    const Type *ty;
+    auto s = parse_type(iter->getKeyData(), ty);
+    ASSERT(s && *s == '\0');
+    iter->second = ty;
+    return ty;
 }
 
 // ========================================================================== //
@@ -701,24 +1075,26 @@ TypeExpr *turn_texp(TypeExpr *texp)
 
 const char *Json2Asg::parse_type(const char *s, const Type *&v)
 {
-    auto ty = make<Type>();
-    s = parse_base(s, *ty);
+    Type ty;
+    s = parse_base(s, ty);
     if (!s)
         return nullptr;
 
     while (true)
     {
-        auto p = parse_base(skip_spaces(s), *ty);
+        auto p = parse_base(skip_spaces(s), ty);
         if (!p)
             break;
         s = p;
     }
 
-    s = parse_texp(skip_spaces(s), ty->texp);
-    if (ty->texp)
-        ty->texp = turn_texp(ty->texp); // 将类型表达式内外翻转
+    s = parse_texp(skip_spaces(s), ty.texp);
+    if (!s)
+        return nullptr;
+    if (ty.texp)
+        ty.texp = turn_texp(ty.texp); // 将类型表达式内外翻转
 
-    v = ty;
+    v = mTypeCache(ty.spec, ty.qual, ty.texp);
     return s;
 }
 
@@ -1,25 +1,70 @@
 #pragma once
 
 #include "asg.hpp"
-#include <any>
-#include <llvm/Support/JSON.h>
-#include <regex>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <string_view>
 #include <unordered_map>
 
+/**
+ * @brief 把 clang -ast-dump=json 的输出转换为 ASG
+ *
+ * 不建立 JSON 的 DOM，而是边扫描文本边创建 ASG 结点：每个 JSON 对象对应栈上
+ * 的一个 Node，读到 "kind" 时用完美哈希确定结点种类，读到 "inner" 时创建 ASG
+ * 结点，随后每解析完一个子对象就直接挂到父结点上。"id" 等十六进制数在原文上
+ * 就地解析，不复制子串。内存占用因此与 ASG 相当，而不是与输入文本相当。
+ *
+ * 依赖 clang 输出的键顺序：每个对象的 "kind" 出现在 "inner" 之前。输入不合法
+ * 时打印出错位置后中止。
+ */
 class Json2Asg
 {
   public:
     Obj::Mgr &mMgr;
+    asg::Type::Cache &mTypeCache;
 
-    Json2Asg(Obj::Mgr &mgr) : mMgr(mgr)
+    Json2Asg(Obj::Mgr &mgr, asg::Type::Cache &typeCache) : mMgr(mgr), mTypeCache(typeCache)
     {
     }
 
-    asg::TranslationUnit *operator()(const llvm::json::Value &jval);
+    asg::TranslationUnit *operator()(llvm::StringRef text);
+
+    /// 结点种类，按 Decl、Expr、Stmt 分段排列
+    enum struct Kind : std::uint8_t
+    {
+        kINVALID,
+
+        kTranslationUnitDecl,
+        kTypedefDecl,
+        kVarDecl,
+        kParmVarDecl,
+        kFunctionDecl,
+
+        kIntegerLiteral,
+        kDeclRefExpr,
+        kParenExpr,
+        kUnaryOperator,
+        kBinaryOperator,
+        kArraySubscriptExpr,
+        kCallExpr,
+        kInitListExpr,
+        kImplicitValueInitExpr,
+        kImplicitCastExpr,
+
+        kCompoundStmt,
+        kNullStmt,
+        kDeclStmt,
+        kIfStmt,
+        kWhileStmt,
+        kDoStmt,
+        kBreakStmt,
+        kContinueStmt,
+        kReturnStmt,
+    };
 
   private:
-    std::unordered_map<std::size_t, Obj *> mIdMap;
-    std::unordered_map<std::string, const asg::Type *> mTyMap;
+    std::unordered_map<std::size_t, asg::Decl *> mIdMap;
+    llvm::StringMap<const asg::Type *> mTyMap;
 
     /**
      * 在遍历函数体时指向当前的函数声明，从而给函数体内返回语句的 ReturnStmt
@@ -47,68 +92,78 @@ class Json2Asg
     }
 
     //============================================================================
-    // 类型
-    //============================================================================
-
-    const asg::Type *getty(const llvm::json::Object &jobj);
-
-    //============================================================================
-    // 表达式
+    // JSON 扫描
     //============================================================================
 
-    asg::Expr *expr(const llvm::json::Object &jobj);
+    const char *mBegin{nullptr}, *mCur{nullptr}, *mEnd{nullptr};
+    std::string mScratch; /// 含转义的字符串解码到这里
 
-    asg::IntegerLiteral *integer_literal(const llvm::json::Object &jobj);
+    void skip_whitespace();
 
-    asg::DeclRefExpr *decl_ref_expr(const llvm::json::Object &jobj);
+    /// 当前字符必须是 \p c ，跳过它和其后的空白
+    void expect(char c);
 
-    asg::ParenExpr *paren_expr(const llvm::json::Object &jobj);
+    /// 若当前字符是 \p c 则跳过它和其后的空白并返回 true
+    bool accept(char c);
 
-    asg::UnaryExpr *unary_expr(const llvm::json::Object &jobj);
+    /// 读取一个字符串，返回的视图在下次读取字符串之前有效
+    std::string_view string();
 
-    asg::BinaryExpr *binary_expr(const llvm::json::Object &jobj);
+    /// 就地解析形如 "0x1a2b" 的十六进制 id
+    std::size_t hex_id();
 
-    asg::CallExpr *call_expr(const llvm::json::Object &jobj);
+    void skip_value();
 
-    asg::InitListExpr *init_list_expr(const llvm::json::Object &jobj);
-
-    asg::ImplicitInitExpr *implicit_init_expr(const llvm::json::Object &jobj);
-
-    asg::ImplicitCastExpr *implicit_cast_expr(const llvm::json::Object &jobj);
+    [[noreturn]] void error(const char *what);
 
     //============================================================================
-    // 语句
+    // 结点
     //============================================================================
 
-    asg::Stmt *stmt(const llvm::json::Object &jobj);
-
-    asg::CompoundStmt *compound_stmt(const llvm::json::Object &jobj);
+    /// 解析过程中一个 JSON 对象的状态
+    struct Node
+    {
+        Kind kind{Kind::kINVALID};
+        Obj *obj{nullptr};   /// 对应的 ASG 结点，读到 "inner" 或对象结束时创建
+        bool skip{false};    /// 不转换为 ASG 结点，如 TypedefDecl 和隐式声明
+        bool inner{false};   /// 是否已读到 "inner"
+        std::uint32_t n{0};  /// 已挂上的子结点数
+        std::size_t id{0};   /// "id"
+        std::size_t ref{0};  /// "referencedDecl" 的 "id"
+        const asg::Type *type{nullptr};
+        asg::Ident name;
+        std::uint64_t value{0};
+        std::uint8_t op{0};  /// 运算符或转换种类，按 kind 解释
+        asg::Expr::Cate cate{asg::Expr::Cate::kINVALID};
+    };
 
-    asg::NullStmt *null_stmt(const llvm::json::Object &jobj);
+    /// 解析一个 JSON 对象，返回转换得到的结点（可能为空）及其种类
+    Obj *object(Kind &kind);
 
-    asg::DeclStmt *decl_stmt(const llvm::json::Object &jobj);
+    /// 读取名为 \p key 的属性值
+    void attribute(Node &node, std::string_view key);
 
-    asg::ExprStmt *expr_stmt(const llvm::json::Object &jobj);
+    /// 创建 ASG 结点，\p inner 表示是否因读到子结点而创建
+    void begin(Node &node, bool inner);
 
-    asg::IfStmt *if_stmt(const llvm::json::Object &jobj);
+    /// 把种类为 \p kind 的子结点 \p child 挂到 \p node 上
+    void add(Node &node, Kind kind, Obj *child);
 
-    asg::WhileStmt *while_stmt(const llvm::json::Object &jobj);
+    /// 对象结束，填入在子结点之前读到的属性
+    void finish(Node &node);
 
-    asg::BreakStmt *break_stmt(const llvm::json::Object &jobj);
+    asg::Decl *as_decl(Kind kind, Obj *obj);
 
-    asg::ContinueStmt *continue_stmt(const llvm::json::Object &jobj);
+    asg::Expr *as_expr(Kind kind, Obj *obj);
 
-    asg::ReturnStmt *return_stmt(const llvm::json::Object &jobj);
+    /// 表达式作为语句时包装为 ExprStmt
+    asg::Stmt *as_stmt(Kind kind, Obj *obj);
 
     //============================================================================
-    // 声明
+    // 类型
     //============================================================================
 
-    asg::Decl *decl(const llvm::json::Object &jobj);
-
-    asg::VarDecl *var_decl(const llvm::json::Object &jobj);
-
-    asg::FunctionDecl *function_decl(const llvm::json::Object &jobj);
+    const asg::Type *getty(std::string_view texpStr);
 
   private:
     /**
@@ -118,7 +173,7 @@ class Json2Asg
     const char *parse_type(const char *s, const asg::Type *&v);
 
     /// 解析类型表达式，注意 \p v 在构建后是由外到内的顺序，需要再调用 turn_texp
-    /// 将内外翻转。
+    /// 将内外翻转。这里构建的只是临时结点，翻转后再交给类型缓存规范化。
     const char *parse_texp(const char *s, asg::TypeExpr *&v);
     const char *parse_texp_0(const char *s, asg::TypeExpr *&v);
     const char *parse_texp_1(const char *s, asg::TypeExpr *&v);
@@ -1,34 +1,168 @@
 #include "Obj.hpp"
+#include <chrono>
 
-void Obj::Mgr::gc()
+void Obj::Arena::release()
 {
-    // 标记可达对象
-    gc_mark_dfs(this);
+    for (auto &&chunk : mChunks)
+        std::free(chunk);
+    mChunks.clear();
+    for (auto &&c : mClasses)
+        c = Class();
+}
 
-    // 清扫不可达对象
-    Obj *here = this;
-    while (true)
+void Obj::Arena::refill(std::size_t cls)
+{
+    auto chunk = std::aligned_alloc(kChunkSize, kChunkSize);
+    if (chunk == nullptr)
+        throw std::bad_alloc();
+    mChunks.push_back(chunk);
+
+    static_cast<Chunk *>(chunk)->cls = cls;
+
+    // 块头之后按对象大小切分，末尾不足一个对象的部分弃用
+    auto size = (cls + 1) * kGrain;
+    auto &c = mClasses[cls];
+    c.cur = static_cast<char *>(chunk) + round(sizeof(Chunk));
+    c.end = c.cur + (kChunkSize - round(sizeof(Chunk))) / size * size;
+}
+
+Obj::Mgr::~Mgr()
+{
+    // 只需逐个析构，内存随 mArena 整块归还
+    for (Obj *here = gc_next(this); here != this;)
     {
-        gc_unmark(here);
-        auto next = here->__next__;
-        if (next == this)
-            break;
+        auto next = gc_next(here);
+        here->~Obj();
+        here = next;
+    }
+}
+
+namespace
+{
+
+/// 当前线程正在进行的垃圾回收所用的标记栈
+thread_local std::vector<Obj *> *tMarkStack = nullptr;
+
+} // namespace
+
+void Obj::Mgr::gc(bool full)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    // 还没有老年代时，年轻代回收就是全量回收
+    full = full || mOldCnt == 0 || mOldCnt > kFullRatio * mOldAfterFull;
+    auto mark = full ? &gc_mark_any : &gc_mark_young;
+
+    std::vector<Obj *> stack;
+    tMarkStack = &stack;
+    std::size_t scanned = 0, remembered = 0;
+
+    // 根对象
+    __mark__(mark);
+
+    // 年轻代回收时，记忆集中的老对象也是根，只扫描一层
+    if (!full)
+    {
+        for (auto &&i : mRemembered)
+            i->__mark__(mark), ++remembered;
+        scanned = remembered;
+    }
+    mRemembered.clear();
+
+    while (!stack.empty())
+    {
+        auto obj = stack.back();
+        stack.pop_back();
+        obj->__mark__(mark), ++scanned;
+    }
+    tMarkStack = nullptr;
 
-        if (!gc_marked(next))
-            here->__next__ = next->__next__, delete next;
+    // 清扫：全量回收时清扫整个环，否则只清扫年轻代前缀
+    std::size_t survived = 0;
+    auto reclaimed = gc_sweep(full ? this : mOldHead, survived);
+
+    if (full)
+        mOldCnt = survived, mOldAfterFull = survived;
+    else
+        mOldCnt += survived;
+    mOldHead = gc_next(this);
+
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - begin;
+    mGcLog.push_back({full, scanned, remembered, reclaimed, ms.count()});
+}
+
+std::size_t Obj::Mgr::gc_sweep(Obj *end, std::size_t &survived)
+{
+    std::size_t reclaimed = 0;
+    Obj *here = this;
+    for (auto next = gc_next(here); next != end; next = gc_next(here))
+    {
+        if (gc_marked(next))
+        {
+            gc_unmark(next), gc_age(next);
+            here = next, ++survived;
+        }
         else
-            here = next;
+        {
+            gc_link(here, gc_next(next));
+            next->~Obj();
+            mArena.free(next);
+            ++reclaimed;
+        }
+    }
+    return reclaimed;
+}
+
+void Obj::Mgr::print_stats(std::FILE *out) const
+{
+    std::size_t objs = 0, bytes = 0;
+    std::fprintf(out, "%-16s %12s %14s\n", "phase", "objects", "bytes");
+    for (auto &&i : mStats)
+    {
+        std::fprintf(out, "%-16s %12zu %14zu\n", i.phase, i.objs, i.bytes);
+        objs += i.objs, bytes += i.bytes;
+    }
+    std::fprintf(out, "%-16s %12zu %14zu\n", "total", objs, bytes);
+    std::fprintf(out, "%-16s %12s %14zu\n", "arena", "", mArena.reserved());
+
+    std::fprintf(out, "\n%-16s %12s %12s %14s %10s\n", "gc", "scanned", "remembered", "reclaimed", "ms");
+    for (std::size_t i = 0; i < mGcLog.size(); ++i)
+    {
+        auto &log = mGcLog[i];
+        std::fprintf(out, "#%-3zu %-11s %12zu %12zu %14zu %10.3f\n", i, log.full ? "full" : "young", log.scanned,
+                     log.remembered, log.reclaimed, log.ms);
+    }
+}
+
+void Obj::Mgr::unpin(Obj *obj)
+{
+    for (auto i = mPins.size(); i-- != 0;)
+    {
+        if (mPins[i] == obj)
+        {
+            mPins.erase(mPins.begin() + i);
+            return;
+        }
     }
 }
 
 void Obj::Mgr::__mark__(Mark mark)
 {
     mark(mRoot);
+    for (auto &&i : mPins)
+        i->__mark__(mark);
 }
 
-void Obj::Mgr::gc_mark_dfs(Obj *obj)
+void Obj::Mgr::gc_mark_any(Obj *obj)
 {
     if (obj == nullptr || gc_marked(obj))
         return;
-    gc_mark(obj), obj->__mark__(&gc_mark_dfs);
+    gc_mark(obj), tMarkStack->push_back(obj);
+}
+
+void Obj::Mgr::gc_mark_young(Obj *obj)
+{
+    if (obj == nullptr || gc_old(obj) || gc_marked(obj))
+        return;
+    gc_mark(obj), tMarkStack->push_back(obj);
 }
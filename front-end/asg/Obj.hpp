@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <new>
 #include <vector>
 
 /// 错误断言，打印文件和行号，方便定位问题。
@@ -16,6 +18,7 @@
 struct alignas(ptrdiff_t) Obj
 {
     struct Mgr;
+    struct Arena;
     struct Walked;
 
     using Mark = void (*)(Obj *obj);
@@ -80,30 +83,223 @@ struct alignas(ptrdiff_t) Obj
     virtual void __mark__(Mark mark) = 0; /// 标记对象
 };
 
+/**
+ * @brief 分级内存池
+ *
+ * 按 kGrain 字节的粒度把对象大小划分为若干大小类，每个大小类独占若干按
+ * kChunkSize 对齐的内存块，在块内顺序切分对象，分配只需移动指针。回收的
+ * 对象挂到所属大小类的空闲链表上复用，所属大小类记录在块头中，由地址对齐
+ * 即可找到，因此对象本身不需要额外的头部。
+ */
+struct Obj::Arena
+{
+    static constexpr std::size_t kGrain = alignof(ptrdiff_t);
+    static constexpr std::size_t kClassCnt = 32;
+    static constexpr std::size_t kMaxSize = kGrain * kClassCnt;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << 16;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    void operator=(const Arena &) = delete;
+
+    ~Arena()
+    {
+        release();
+    }
+
+    /// 对齐到大小类后的实际占用字节数
+    static constexpr std::size_t round(std::size_t size)
+    {
+        return (size + kGrain - 1) / kGrain * kGrain;
+    }
+
+    void *alloc(std::size_t size)
+    {
+        auto cls = round(size) / kGrain - 1;
+        auto &c = mClasses[cls];
+        if (c.free)
+        {
+            auto p = c.free;
+            c.free = p->next;
+            return p;
+        }
+        if (c.cur == c.end)
+            refill(cls);
+        auto p = c.cur;
+        c.cur += (cls + 1) * kGrain;
+        return p;
+    }
+
+    void free(void *ptr)
+    {
+        auto chunk = reinterpret_cast<Chunk *>(reinterpret_cast<uintptr_t>(ptr) & ~(kChunkSize - 1));
+        auto p = static_cast<Free *>(ptr);
+        auto &c = mClasses[chunk->cls];
+        p->next = c.free, c.free = p;
+    }
+
+    /// 一次性归还所有内存块，调用前需自行析构其中的对象。
+    void release();
+
+    /// 向系统申请的总字节数
+    std::size_t reserved() const
+    {
+        return mChunks.size() * kChunkSize;
+    }
+
+  private:
+    struct Chunk
+    {
+        std::size_t cls;
+    };
+
+    struct Free
+    {
+        Free *next;
+    };
+
+    struct Class
+    {
+        char *cur{nullptr}, *end{nullptr};
+        Free *free{nullptr};
+    };
+
+    Class mClasses[kClassCnt];
+    std::vector<void *> mChunks;
+
+    void refill(std::size_t cls);
+};
+
 /// 对象管理器
 struct Obj::Mgr : Obj
 {
+    struct Phase;
+
+    /// 分配统计
+    struct Stats
+    {
+        const char *phase;
+        std::size_t objs{0};  /// 分配的对象数
+        std::size_t bytes{0}; /// 分配的字节数（按大小类对齐）
+    };
+
+    /// 单次垃圾回收的记录
+    struct GcLog
+    {
+        bool full;              /// 是否为全量回收
+        std::size_t scanned;    /// 被扫描（调用 __mark__）的对象数
+        std::size_t remembered; /// 其中记忆集中的老对象数，全量回收时为 0
+        std::size_t reclaimed;  /// 被回收的对象数
+        double ms;              /// 耗时（毫秒）
+    };
+
     Mgr() : Obj(this)
     {
+        mStats.push_back({"(none)"});
     }
 
+    /// 析构所有存活对象，然后整块归还内存
+    ~Mgr() override;
+
     template <typename T, typename... Args, typename = std::enable_if_t<std::is_convertible_v<T *, Obj *>>>
     T *make(Args... args)
     {
-        auto obj = new T(args...);
-        obj->__next__ = __next__, __next__ = obj;
+        static_assert(sizeof(T) <= Arena::kMaxSize, "对象大小超出内存池的最大大小类");
+        static_assert(alignof(T) <= Arena::kGrain, "对象对齐要求超出内存池的粒度");
+
+        auto obj = new (mArena.alloc(sizeof(T))) T(args...);
+        obj->__next__ = gc_next(this), gc_link(this, obj);
+
+        auto &stats = mStats[mPhase];
+        ++stats.objs, stats.bytes += Arena::round(sizeof(T));
         return obj;
     }
 
     Obj *mRoot{nullptr}; /// 根对象
 
-    /// 垃圾回收，使用标记-清扫算法
-    /// @warning 垃圾回收时调用栈上不能有对象的引用！
-    void gc();
+    /**
+     * @brief 钉住 \p obj ，使其引用的对象在垃圾回收时总是存活。
+     *
+     * 被钉住的对象本身不必由 Mgr 分配（比如类型缓存），垃圾回收时直接调用它
+     * 的 __mark__ 作为额外的根，对象析构前需要调用 unpin。
+     */
+    void pin(Obj *obj)
+    {
+        mPins.push_back(obj);
+    }
+
+    void unpin(Obj *obj);
+
+    /**
+     * @brief 写屏障：在 \p obj 的指针字段中写入 \p val 之后调用
+     *
+     * 年轻代回收只从根和记忆集出发标记，所以老对象指向年轻对象时要把老对象记
+     * 入记忆集。两次回收之间只改写本次新建的对象时不需要调用：各个解析器只在
+     * 解析阶段中链接自己新建的结点，期间不回收。需要调用的是改写上一阶段建立
+     * 的结点的遍历，比如 Typing 把操作数换成新的 ImplicitCastExpr。指向被钉住
+     * 的对象（如类型缓存中的类型）的字段也不需要。
+     */
+    void remember(Obj *obj, const Obj *val)
+    {
+        // 连续改写同一个对象的多个字段时只记一次，其余的重复无害，只是多扫描一次
+        if (val != nullptr && gc_old(obj) && !gc_old(val) && (mRemembered.empty() || mRemembered.back() != obj))
+            mRemembered.push_back(obj);
+    }
+
+    /**
+     * @brief 分代垃圾回收，使用标记-清扫算法
+     *
+     * 新对象总是插在环的头部，所以上次回收后分配的对象（年轻代）恰好是环
+     * 的一段前缀，存活过一次回收的对象（老年代）带有 old 标记。
+     *
+     * 默认只回收年轻代：从根和记忆集（见 remember）中的老对象出发，只标记、
+     * 追踪年轻对象，然后只清扫年轻代前缀，不访问其余的老对象。当老年代比上次
+     * 全量回收后增长超过 kFullRatio 倍，或 \p full 为真时，进行全量回收。
+     * 每次回收后年轻代的存活者都变为老对象，记忆集随之清空。
+     *
+     * 标记使用显式的标记栈，不会因为很深的表达式链而栈溢出。
+     *
+     * @warning 垃圾回收时调用栈上不能有对象的引用！
+     */
+    void gc(bool full = false);
+
+    static constexpr std::size_t kFullRatio = 2;
+
+    /// 按阶段统计的分配计数，第 0 项记录不属于任何阶段的分配
+    std::vector<Stats> mStats;
+
+    /// 每次垃圾回收的记录
+    std::vector<GcLog> mGcLog;
+
+    /// 打印各阶段的分配统计和垃圾回收记录
+    void print_stats(std::FILE *out) const;
 
   private:
+    Arena mArena;
+    std::size_t mPhase{0};
+    std::vector<Obj *> mPins;
+    std::vector<Obj *> mRemembered; /// 记忆集：上次回收后被写入了年轻对象的老对象
+
+    Obj *mOldHead{this};          /// 老年代在环中的第一个对象，年轻代为此前的前缀
+    std::size_t mOldCnt{0};       /// 老年代对象数
+    std::size_t mOldAfterFull{0}; /// 上次全量回收后的老年代对象数
+
     void __mark__(Mark mark) override;
 
+    static constexpr uintptr_t kFlags = 0b111;
+
+    static Obj *gc_next(const Obj *obj)
+    {
+        return reinterpret_cast<Obj *>(reinterpret_cast<uintptr_t>(obj->__next__) & ~kFlags);
+    }
+
+    /// 修改环形指针，保留 \p obj 自身的标记位
+    static void gc_link(Obj *obj, Obj *next)
+    {
+        auto &bits = reinterpret_cast<uintptr_t &>(obj->__next__);
+        bits = (bits & kFlags) | reinterpret_cast<uintptr_t>(next);
+    }
+
     static bool gc_marked(const Obj *obj)
     {
         return reinterpret_cast<uintptr_t>(obj->__next__) & uintptr_t(0b1);
@@ -119,7 +315,45 @@ struct Obj::Mgr : Obj
         reinterpret_cast<uintptr_t &>(obj->__next__) |= uintptr_t(0b1);
     }
 
-    static void gc_mark_dfs(Obj *obj);
+    static bool gc_old(const Obj *obj)
+    {
+        return reinterpret_cast<uintptr_t>(obj->__next__) & uintptr_t(0b100);
+    }
+
+    static void gc_age(Obj *obj)
+    {
+        reinterpret_cast<uintptr_t &>(obj->__next__) |= uintptr_t(0b100);
+    }
+
+    /// 全量回收的标记函数：标记并压入标记栈
+    static void gc_mark_any(Obj *obj);
+
+    /// 年轻代回收的标记函数：只标记并压入年轻对象
+    static void gc_mark_young(Obj *obj);
+
+    /// 清扫环中 [gc_next(this), end) 的前缀，返回回收的对象数，存活数累加到 \p survived
+    std::size_t gc_sweep(Obj *end, std::size_t &survived);
+};
+
+/**
+ * @brief 分配统计阶段，在作用域内通过 make 分配的对象都计入名为 \p name 的
+ * 阶段，离开作用域后恢复到外层阶段。
+ */
+struct Obj::Mgr::Phase
+{
+    Mgr &mMgr;
+    std::size_t mPrev;
+
+    Phase(Mgr &mgr, const char *name) : mMgr(mgr), mPrev(mgr.mPhase)
+    {
+        mgr.mPhase = mgr.mStats.size();
+        mgr.mStats.push_back({name});
+    }
+
+    ~Phase()
+    {
+        mMgr.mPhase = mPrev;
+    }
 };
 
 /// 检查循环引用，防止无限递归。
@@ -19,31 +19,35 @@ TranslationUnit *Typing::operator()(TranslationUnit *tu)
 
 Expr *Typing::operator()(Expr *obj)
 {
-    if (auto p = obj->dcst<IntegerLiteral>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Expr::Kind::kIntegerLiteral:
+        return self(obj->scst<IntegerLiteral>());
 
-    if (auto p = obj->dcst<StringLiteral>())
-        return self(p);
+    case Expr::Kind::kStringLiteral:
+        return self(obj->scst<StringLiteral>());
 
-    if (auto p = obj->dcst<DeclRefExpr>())
-        return self(p);
+    case Expr::Kind::kDeclRefExpr:
+        return self(obj->scst<DeclRefExpr>());
 
-    if (auto p = obj->dcst<ParenExpr>())
-        return self(p);
+    case Expr::Kind::kParenExpr:
+        return self(obj->scst<ParenExpr>());
 
-    if (auto p = obj->dcst<UnaryExpr>())
-        return self(p);
+    case Expr::Kind::kUnaryExpr:
+        return self(obj->scst<UnaryExpr>());
 
-    if (auto p = obj->dcst<BinaryExpr>())
-        return self(p);
+    case Expr::Kind::kBinaryExpr:
+        return self(obj->scst<BinaryExpr>());
 
-    if (auto p = obj->dcst<CallExpr>())
-        return self(p);
+    case Expr::Kind::kCallExpr:
+        return self(obj->scst<CallExpr>());
 
-    if (auto p = obj->dcst<ImplicitCastExpr>())
-        return self(p->sub);
+    case Expr::Kind::kImplicitCastExpr:
+        return self(obj->scst<ImplicitCastExpr>()->sub);
 
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
 Expr *Typing::operator()(IntegerLiteral *obj)
@@ -62,10 +66,8 @@ Expr *Typing::operator()(IntegerLiteral *obj)
 
 Expr *Typing::operator()(StringLiteral *obj)
 {
-    ArrayType arrTy;
-    arrTy.len = obj->val.size() + 1;
-
-    obj->type = mTypeCache(Type::Spec::kChar, Type::Qual{.const_ = true}, &arrTy);
+    auto arrTy = mTypeCache.array(obj->val.size() + 1, nullptr);
+    obj->type = mTypeCache(Type::Spec::kChar, Type::Qual{.const_ = true}, arrTy);
 
     obj->cate = Expr::Cate::kRValue;
     return obj;
@@ -89,6 +91,7 @@ Expr *Typing::operator()(ParenExpr *obj)
 {
     ASSERT(obj->sub);
     obj->sub = self(obj->sub);
+    mMgr.remember(obj, obj->sub);
     obj->type = obj->sub->type;
     obj->cate = obj->sub->cate;
     return obj;
@@ -104,6 +107,7 @@ Expr *Typing::operator()(UnaryExpr *obj)
     sub = ensure_rvalue(sub);
     sub = promote_integer(sub);
     obj->sub = sub;
+    mMgr.remember(obj, sub);
 
     Type::Spec spec;
     switch (obj->op)
@@ -128,10 +132,28 @@ Expr *Typing::operator()(UnaryExpr *obj)
 
 Expr *Typing::operator()(BinaryExpr *obj)
 {
-    ASSERT(obj->lft && obj->rht);
+    // 左深的长链（如 a + b + c + ...）沿 lft 压入 mSpine，再自底向上逐个推导，
+    // 递归深度只取决于各个 rht，不随链长增长
+    auto base = mSpine.size();
+    for (auto i = obj;; i = i->lft->scst<BinaryExpr>())
+    {
+        ASSERT(i->lft && i->rht);
+        mSpine.push_back(i);
+        if (i->lft->kind != Expr::Kind::kBinaryExpr)
+            break;
+    }
+
+    auto lft = self(mSpine.back()->lft);
+    for (auto i = mSpine.size(); i-- > base;)
+        lft = binary(mSpine[i], lft); // rht 中的 BinaryExpr 压在 mSpine 的上方，返回时已经弹出
+    mSpine.resize(base);
+    return lft;
+}
+
+Expr *Typing::binary(BinaryExpr *obj, Expr *lft)
+{
     Obj::Walked walked(obj);
 
-    auto lft = self(obj->lft);
     auto rht = self(obj->rht);
 
     switch (obj->op)
@@ -206,15 +228,7 @@ Expr *Typing::operator()(BinaryExpr *obj)
     break;
 
     case BinaryExpr::kIndex: {
-        auto arrayType = lft->type->texp->dcst<ArrayType>();
-        if (arrayType == nullptr)
-        {
-            // 指针需要取出其sub类型
-            auto pointerType = lft->type->texp->dcst<PointerType>();
-            if (pointerType == nullptr)
-                ABORT();
-            arrayType = pointerType->sub->dcst<ArrayType>();
-        }
+        auto elemTexp = element_texp(lft->type);
 
         if (rht->type->texp != nullptr)
             ABORT();
@@ -233,7 +247,7 @@ Expr *Typing::operator()(BinaryExpr *obj)
         lft = ensure_rvalue(lft);
         rht = ensure_rvalue(rht);
 
-        obj->type = mTypeCache(lft->type->spec, lft->type->qual, arrayType->sub);
+        obj->type = mTypeCache(lft->type->spec, lft->type->qual, elemTexp);
         obj->cate = Expr::Cate::kLValue; // 数组的索引是左值
     }
     break;
@@ -244,6 +258,8 @@ Expr *Typing::operator()(BinaryExpr *obj)
 
     obj->lft = lft;
     obj->rht = rht;
+    mMgr.remember(obj, lft);
+    mMgr.remember(obj, rht);
     return obj;
 }
 
@@ -252,23 +268,18 @@ Expr *Typing::operator()(CallExpr *obj)
     ASSERT(obj->head);
 
     obj->head = self(obj->head);
-    auto fexp = dynamic_cast<FunctionType *>(obj->head->type->texp);
+    auto fexp = kcst<FunctionType>(obj->head->type->texp);
     if (fexp == nullptr)
         ABORT();
 
     auto f2p = make<ImplicitCastExpr>();
-    f2p->kind = ImplicitCastExpr::kFunctionToPointerDecay;
+    f2p->castKind = ImplicitCastExpr::kFunctionToPointerDecay;
     // 加上指针类型
-    auto type = make<Type>();
-    auto pointerType = make<PointerType>();
-    type->spec = obj->head->type->spec;
-    type->qual = obj->head->type->qual;
-    pointerType->sub = obj->head->type->texp;
-    type->texp = pointerType;
-
-    f2p->type = type;
+    auto pointerType = mTypeCache.pointer(Type::Qual(), obj->head->type->texp);
+    f2p->type = mTypeCache(obj->head->type->spec, obj->head->type->qual, pointerType);
     f2p->sub = obj->head;
     obj->head = f2p;
+    mMgr.remember(obj, f2p);
 
     if (fexp->params.size() != obj->args.size())
         ABORT();
@@ -279,6 +290,7 @@ Expr *Typing::operator()(CallExpr *obj)
         lft.type = fexp->params[i];
         lft.cate = Expr::Cate::kLValue;
         obj->args[i] = assignment_cast(&lft, self(obj->args[i]));
+        mMgr.remember(obj, obj->args[i]);
     }
 
     obj->type = mTypeCache(obj->head->type->spec, Type::Qual(), fexp->sub);
@@ -293,37 +305,41 @@ Expr *Typing::operator()(CallExpr *obj)
 
 void Typing::operator()(Stmt *obj)
 {
-    if (auto p = obj->dcst<DeclStmt>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Stmt::Kind::kDeclStmt:
+        return self(obj->scst<DeclStmt>());
 
-    if (auto p = obj->dcst<ExprStmt>())
-        return self(p);
+    case Stmt::Kind::kExprStmt:
+        return self(obj->scst<ExprStmt>());
 
-    if (auto p = obj->dcst<CompoundStmt>())
-        return self(p);
+    case Stmt::Kind::kCompoundStmt:
+        return self(obj->scst<CompoundStmt>());
 
-    if (auto p = obj->dcst<IfStmt>())
-        return self(p);
+    case Stmt::Kind::kIfStmt:
+        return self(obj->scst<IfStmt>());
 
-    if (auto p = obj->dcst<WhileStmt>())
-        return self(p);
+    case Stmt::Kind::kWhileStmt:
+        return self(obj->scst<WhileStmt>());
 
-    if (auto p = obj->dcst<DoStmt>())
-        return self(p);
+    case Stmt::Kind::kDoStmt:
+        return self(obj->scst<DoStmt>());
 
-    if (auto p = obj->dcst<BreakStmt>())
-        return self(p);
+    case Stmt::Kind::kBreakStmt:
+        return self(obj->scst<BreakStmt>());
 
-    if (auto p = obj->dcst<ContinueStmt>())
-        return self(p);
+    case Stmt::Kind::kContinueStmt:
+        return self(obj->scst<ContinueStmt>());
 
-    if (auto p = obj->dcst<ReturnStmt>())
-        return self(p);
+    case Stmt::Kind::kReturnStmt:
+        return self(obj->scst<ReturnStmt>());
 
-    if (auto p = obj->dcst<NullStmt>())
+    case Stmt::Kind::kNullStmt:
         return;
 
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
 void Typing::operator()(DeclStmt *obj)
@@ -335,6 +351,7 @@ void Typing::operator()(DeclStmt *obj)
 void Typing::operator()(ExprStmt *obj)
 {
     obj->expr = ensure_rvalue(self(obj->expr));
+    mMgr.remember(obj, obj->expr);
 }
 
 void Typing::operator()(CompoundStmt *obj)
@@ -346,6 +363,7 @@ void Typing::operator()(CompoundStmt *obj)
 void Typing::operator()(IfStmt *obj)
 {
     obj->cond = ensure_rvalue(self(obj->cond));
+    mMgr.remember(obj, obj->cond);
     self(obj->then);
     if (obj->else_)
         self(obj->else_);
@@ -354,12 +372,14 @@ void Typing::operator()(IfStmt *obj)
 void Typing::operator()(WhileStmt *obj)
 {
     obj->cond = ensure_rvalue(self(obj->cond));
+    mMgr.remember(obj, obj->cond);
     self(obj->body);
 }
 
 void Typing::operator()(DoStmt *obj)
 {
     obj->cond = ensure_rvalue(self(obj->cond));
+    mMgr.remember(obj, obj->cond);
     self(obj->body);
 }
 
@@ -374,7 +394,7 @@ void Typing::operator()(ContinueStmt *obj)
 void Typing::operator()(ReturnStmt *obj)
 {
     auto &ftype = obj->func->type;
-    auto ftexp = dynamic_cast<FunctionType *>(ftype->texp);
+    auto ftexp = kcst<FunctionType>(ftype->texp);
     if (ftexp == nullptr || ftexp->sub != nullptr)
         ABORT();
 
@@ -397,6 +417,7 @@ void Typing::operator()(ReturnStmt *obj)
         lft.type = mTypeCache(ftype->spec, ftype->qual, nullptr);
         lft.cate = Expr::Cate::kLValue;
         obj->expr = assignment_cast(&lft, ensure_rvalue(self(obj->expr)));
+        mMgr.remember(obj, obj->expr);
     }
     break;
 
@@ -411,13 +432,17 @@ void Typing::operator()(ReturnStmt *obj)
 
 void Typing::operator()(Decl *obj)
 {
-    if (auto p = obj->dcst<VarDecl>())
-        return self(p);
+    switch (obj->kind)
+    {
+    case Decl::Kind::kVarDecl:
+        return self(obj->scst<VarDecl>());
 
-    if (auto p = obj->dcst<FunctionDecl>())
-        return self(p);
+    case Decl::Kind::kFunctionDecl:
+        return self(obj->scst<FunctionDecl>());
 
-    ABORT();
+    default:
+        ABORT();
+    }
 }
 
 void Typing::operator()(VarDecl *obj)
@@ -441,6 +466,16 @@ void Typing::operator()(VarDecl *obj)
         ty.type = obj->type;
         ty.cate = Expr::Cate::kLValue;
         obj->init = infer_init(obj->init, obj->type);
+        mMgr.remember(obj, obj->init);
+
+        // 类型是不可变的，未知长度的数组换成由初始化表达式确定长度的新类型
+        auto arrTy = kcst<ArrayType>(obj->type->texp);
+        if (arrTy != nullptr && arrTy->len == ArrayType::kUnLen)
+        {
+            auto initTy = kcst<ArrayType>(obj->init->type->texp);
+            ASSERT(initTy);
+            obj->type = mTypeCache(obj->type->spec, obj->type->qual, mTypeCache.array(initTy->len, arrTy->sub));
+        }
     }
 }
 
@@ -462,30 +497,26 @@ void Typing::operator()(FunctionDecl *obj)
     // 必须为函数类型
     if (obj->type->texp == nullptr)
         ABORT();
-    auto funcType = obj->type->texp->dcst<FunctionType>();
+    auto funcType = kcst<FunctionType>(obj->type->texp);
     if (funcType == nullptr)
         ABORT();
 
-    funcType->params.resize(obj->params.size());
+    std::vector<const Type *> params(obj->params.size());
     for (int i = obj->params.size(); --i != -1;)
     {
         self(obj->params[i]);
-        funcType->params[i] = obj->params[i]->type;
-        // 将此处Arraytype变为PointerType
-        if (obj->params[i]->type->texp->dcst<ArrayType>())
+        // 数组参数变为指向元素的指针
+        if (auto arrTy = kcst<ArrayType>(obj->params[i]->type->texp))
         {
-            auto type = make<Type>();
-            type->spec = obj->params[i]->type->spec;
-            type->qual = obj->params[i]->type->qual;
-            auto pointerType = make<PointerType>();
-            pointerType->sub = obj->params[i]->type->texp;
-            type->texp = pointerType;
-            // 两个都要改
-            funcType->params[i] = type;
-            obj->params[i]->type = type;
+            auto &ty = obj->params[i]->type;
+            ty = mTypeCache(ty->spec, ty->qual, mTypeCache.pointer(Type::Qual(), arrTy->sub));
         }
+        params[i] = obj->params[i]->type;
     }
 
+    // 类型是不可变的，参数类型变化时换成新的函数类型
+    obj->type = mTypeCache(obj->type->spec, obj->type->qual, mTypeCache.function(funcType->sub, std::move(params)));
+
     if (obj->body)
     {
         for (auto &&i : obj->body->subs)
@@ -499,20 +530,14 @@ void Typing::operator()(FunctionDecl *obj)
 
 Expr *Typing::ensure_rvalue(Expr *exp)
 {
-    if (exp->type->texp->dcst<ArrayType>())
+    if (auto arrTy = kcst<ArrayType>(exp->type->texp))
     {
         auto cst = make<ImplicitCastExpr>();
-        cst->kind = ImplicitCastExpr::kArrayToPointerDecay;
-
-        // 加上指针类型
-        auto type = make<Type>();
-        auto pointerType = make<PointerType>();
-        type->spec = exp->type->spec;
-        type->qual = exp->type->qual;
-        pointerType->sub = exp->type->texp;
-        type->texp = pointerType;
+        cst->castKind = ImplicitCastExpr::kArrayToPointerDecay;
 
-        cst->type = mTypeCache(type->spec, type->qual, type->texp);
+        // 退化为指向元素的指针，与 clang 的 JSON 解析出的类型一致
+        auto pointerType = mTypeCache.pointer(Type::Qual(), arrTy->sub);
+        cst->type = mTypeCache(exp->type->spec, exp->type->qual, pointerType);
         cst->cate = Expr::Cate::kRValue;
 
         cst->sub = exp;
@@ -523,7 +548,7 @@ Expr *Typing::ensure_rvalue(Expr *exp)
     {
     case Expr::Cate::kLValue: {
         auto cst = make<ImplicitCastExpr>();
-        cst->kind = cst->kLValueToRValue;
+        cst->castKind = cst->kLValueToRValue;
 
         cst->type = mTypeCache(exp->type->spec, Type::Qual(), exp->type->texp);
         cst->cate = Expr::Cate::kRValue;
@@ -542,6 +567,15 @@ Expr *Typing::ensure_rvalue(Expr *exp)
     }
 }
 
+TypeExpr *Typing::element_texp(const Type *type)
+{
+    if (auto arrTy = kcst<ArrayType>(type->texp))
+        return arrTy->sub;
+    if (auto ptrTy = kcst<PointerType>(type->texp))
+        return ptrTy->sub;
+    ABORT();
+}
+
 Expr *Typing::promote_integer(Expr *exp, Type::Spec to)
 {
     if (exp->type->texp != nullptr)
@@ -557,7 +591,7 @@ Expr *Typing::promote_integer(Expr *exp, Type::Spec to)
             return exp;
 
         auto cst = make<ImplicitCastExpr>();
-        cst->kind = cst->kIntegralCast;
+        cst->castKind = cst->kIntegralCast;
         cst->type = mTypeCache(to, Type::Qual(), exp->type->texp);
         cst->sub = exp;
         return cst;
@@ -600,26 +634,10 @@ Expr *Typing::assignment_cast(Expr *lft, Expr *rht)
 
     if (lft->type->texp != nullptr)
     {
-        // 最多只支持数组类型被赋值
-        auto arrTy = lft->type->texp->dcst<ArrayType>();
-        if (!arrTy)
-        {
-            auto pointerType = lft->type->texp->dcst<PointerType>();
-            if (pointerType == nullptr)
-                ABORT();
-            arrTy = pointerType->sub->dcst<ArrayType>();
-        }
-
-        auto arrTy2 = rht->type->texp->dcst<const ArrayType>();
-        if (arrTy2 == nullptr)
-        {
-            // 指针需要取出其sub类型
-            auto pointerType = rht->type->texp->dcst<PointerType>();
-            if (pointerType == nullptr)
-                ABORT();
-
-            arrTy2 = pointerType->sub->dcst<const ArrayType>();
-        }
+        // 最多只支持数组类型被赋值，右值此时已经退化为指针
+        auto elemTexp = element_texp(lft->type);
+        if (!kcst<PointerType>(rht->type->texp))
+            ABORT();
 
         // 声明符必须相同
         if (lft->type->spec != rht->type->spec)
@@ -629,18 +647,14 @@ Expr *Typing::assignment_cast(Expr *lft, Expr *rht)
         if (lft->type->qual.const_)
         {
             auto ccst = make<ImplicitCastExpr>();
-            ccst->kind = ccst->kNoOp;
+            ccst->castKind = ccst->kNoOp;
             ccst->type = mTypeCache(rht->type->spec, Type::Qual{.const_ = true}, rht->type->texp);
             ccst->sub = rht;
             rht = ccst;
         }
 
-        // 已知长度的数组可赋值给未知长度的数组
-        if (arrTy->len != ArrayType::kUnLen && arrTy2->len == ArrayType::kUnLen)
-            ABORT();
-
-        // 子类型必须相同
-        if (*arrTy->sub != *arrTy2->sub)
+        // 元素类型必须相同
+        if (elemTexp != rht->type->texp->sub)
             ABORT();
     }
 
@@ -650,7 +664,7 @@ Expr *Typing::assignment_cast(Expr *lft, Expr *rht)
     else if (rht->type->spec != lft->type->spec)
     {
         auto cst = make<ImplicitCastExpr>();
-        cst->kind = cst->kIntegralCast;
+        cst->castKind = cst->kIntegralCast;
         cst->type = lft->type;
         cst->sub = rht;
         rht = cst;
@@ -664,13 +678,13 @@ Expr *Typing::infer_init(Expr *init, const Type *to)
     // https://zh.cppreference.com/w/c/language/scalar_initialization
     if (to->texp == nullptr)
     {
-        if (auto p = init->dcst<ImplicitInitExpr>())
+        if (auto p = kcst<ImplicitInitExpr>(init))
         {
             p->type = to;
             return p;
         }
 
-        if (auto p = init->dcst<InitListExpr>())
+        if (auto p = kcst<InitListExpr>(init))
         {
             // 用多个值初始化一个变量时，只有第一个有用，其余的被忽略。
             if (!p->list.empty())
@@ -689,16 +703,16 @@ Expr *Typing::infer_init(Expr *init, const Type *to)
     }
 
     // https://zh.cppreference.com/w/c/language/array_initialization
-    if (auto arrTy = to->texp->dcst<ArrayType>())
+    if (auto arrTy = kcst<ArrayType>(to->texp))
     {
-        if (auto p = init->dcst<ImplicitInitExpr>())
+        if (auto p = kcst<ImplicitInitExpr>(init))
         {
             p->type = to;
             return p;
         }
 
         // 从花括号环绕列表初始化
-        if (auto initList = init->dcst<InitListExpr>())
+        if (auto initList = kcst<InitListExpr>(init))
         {
             auto [ret, _] = infer_initlist(initList->list, 0, to);
             return ret;
@@ -709,13 +723,12 @@ Expr *Typing::infer_init(Expr *init, const Type *to)
         {
             init = self(init);
 
-            auto p = init->type->texp->dcst<ArrayType>();
+            auto p = kcst<ArrayType>(init->type->texp);
             if (!p || p->sub != nullptr || init->type->spec != Type::Spec::kChar)
                 ABORT();
-            if (arrTy->len == -1)
-                arrTy->len = p->len;
-            else
-                p->len = arrTy->len;
+            // 长度未知时由调用者按字符串的长度补全，否则字符串取数组的长度
+            if (arrTy->len != ArrayType::kUnLen)
+                init->type = mTypeCache(init->type->spec, init->type->qual, mTypeCache.array(arrTy->len, nullptr));
 
             return init;
         }
@@ -738,41 +751,40 @@ std::pair<Expr *, std::size_t> Typing::infer_initlist(const std::vector<Expr *>
         return {ret, begin + 1};
     }
 
-    if (auto arrTy = to->texp->dcst<ArrayType>())
+    if (auto arrTy = kcst<ArrayType>(to->texp))
     {
         auto ret = make<InitListExpr>();
-        ret->type = mTypeCache(to->spec, to->qual, to->texp);
         ret->cate = Expr::Cate::kRValue;
 
-        Type elemTy;
-        elemTy.spec = to->spec;
-        elemTy.qual = to->qual;
-        elemTy.texp = arrTy->sub;
+        auto elemTy = mTypeCache(to->spec, to->qual, arrTy->sub);
+        auto len = arrTy->len;
 
-        if (arrTy->len == ArrayType::kUnLen)
+        if (len == ArrayType::kUnLen)
         {
-            arrTy->len = 0;
+            len = 0;
             while (begin < list.size())
             {
-                auto [expr, next] = infer_initlist(list, begin, &elemTy);
+                auto [expr, next] = infer_initlist(list, begin, elemTy);
                 ret->list.push_back(expr);
                 begin = next;
-                ++arrTy->len;
+                ++len;
             }
         }
 
         else
         {
-            for (int i = 0; i < arrTy->len; ++i)
+            for (int i = 0; i < len; ++i)
             {
                 if (begin == list.size())
                     break;
-                auto [expr, next] = infer_initlist(list, begin, &elemTy);
+                auto [expr, next] = infer_initlist(list, begin, elemTy);
                 ret->list.push_back(expr);
                 begin = next;
             }
         }
 
+        // 未知长度的数组由初始化列表补全长度
+        ret->type = mTypeCache(to->spec, to->qual, mTypeCache.array(len, arrTy->sub));
         return {ret, begin};
     }
 
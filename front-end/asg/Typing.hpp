@@ -10,15 +10,18 @@ class Typing
 {
   public:
     Obj::Mgr &mMgr;
-    Type::Cache mTypeCache;
+    Type::Cache &mTypeCache;
 
-    Typing(Obj::Mgr &mgr) : mMgr(mgr), mTypeCache(mgr)
+    Typing(Obj::Mgr &mgr, Type::Cache &typeCache) : mMgr(mgr), mTypeCache(typeCache)
     {
     }
 
     TranslationUnit *operator()(TranslationUnit *tu);
 
   private:
+    /// 正在推导的左深 BinaryExpr 链，见 operator()(BinaryExpr *)
+    std::vector<BinaryExpr *> mSpine;
+
     template <typename T, typename... Args> T *make(Args... args)
     {
         return mMgr.make<T>(args...);
@@ -42,6 +45,9 @@ class Typing
 
     Expr *operator()(BinaryExpr *obj);
 
+    /// 已推导出左操作数 \p lft 后，推导 \p obj 的右操作数和它本身
+    Expr *binary(BinaryExpr *obj, Expr *lft);
+
     Expr *operator()(CallExpr *obj);
 
     //============================================================================
@@ -84,6 +90,9 @@ class Typing
 
     Expr *ensure_rvalue(Expr *exp);
 
+    /// 数组或指针类型 \p type 的元素的类型表达式，其它类型中止
+    static TypeExpr *element_texp(const Type *type);
+
     /// 整数提升：https://zh.cppreference.com/w/c/language/conversion#%E6%95%B4%E6%95%B0%E6%8F%90%E5%8D%87
     Expr *promote_integer(Expr *exp, Type::Spec to = Type::Spec::kInt);
 
@@ -1,5 +1,7 @@
 #include "asg.hpp"
 
+#define self (*this)
+
 namespace asg
 {
 
@@ -7,97 +9,124 @@ namespace asg
 // 类型
 //==============================================================================
 
-bool Type::operator==(const Type &other) const
+void Type::__mark__(Mark mark)
 {
-    if (this == &other)
-        return true;
-    if (spec != other.spec || qual != other.qual)
-        return false;
-    return *texp == *other.texp;
+    mark(texp);
 }
 
-void Type::__mark__(Mark mark)
+void TypeExpr::__mark__(Mark mark)
 {
-    mark(texp);
+    mark(sub);
 }
 
-const Type *Type::Cache::operator()(Spec spec, Qual qual, TypeExpr *texp)
+void FunctionType::__mark__(Mark mark)
 {
-    for (auto &&i : *this)
-    {
-        if (i->spec == spec && i->qual == qual)
-        {
-            if (texp == i->texp)
-                return i;
-            if (texp == nullptr || i->texp == nullptr)
-                continue;
-            if (*texp == *i->texp)
-                return i;
-        }
-    }
-    auto ty = mMgr.make<Type>();
-    ty->spec = spec, ty->qual = qual, ty->texp = texp;
-    push_back(ty);
-    return ty;
+    for (auto &&i : params)
+        mark(const_cast<Type *>(i));
+    TypeExpr::__mark__(mark);
 }
 
-bool TypeExpr::__equal__(const TypeExpr &other) const
+std::size_t Type::Cache::Hash::operator()(const Key &key) const
 {
-    return *sub == *other.sub;
+    auto h = std::hash<const void *>()(key.sub);
+    auto mix = [&h](std::size_t v) { h ^= v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2); };
+    mix(std::size_t(key.kind) | std::size_t(key.spec) << 8 | std::size_t(key.const_) << 16);
+    mix(key.len);
+    for (auto &&i : key.params)
+        mix(std::hash<const void *>()(i));
+    return h;
 }
 
-void TypeExpr::__mark__(Mark mark)
+template <typename T, typename F> T *Type::Cache::intern(Key &&key, F make)
 {
-    mark(sub);
+    auto iter = mMap.find(key);
+    if (iter != mMap.end())
+        return static_cast<T *>(iter->second);
+
+    T *obj = make();
+    mMap.emplace(std::move(key), obj);
+    return obj;
 }
 
-bool PointerType::__equal__(const TypeExpr &other) const
+const Type *Type::Cache::operator()(Spec spec, Qual qual, TypeExpr *texp)
 {
-    if (this == &other)
-        return true;
-    auto p = dynamic_cast<const PointerType *>(&other);
-    if (p == nullptr)
-        return false;
+    texp = self(texp);
+    return intern<Type>({TypeExpr::Kind::kINVALID, spec, qual.const_, 0, texp}, [&] {
+        auto ty = mMgr.make<Type>();
+        ty->spec = spec, ty->qual = qual, ty->texp = texp;
+        return ty;
+    });
+}
+
+TypeExpr *Type::Cache::operator()(TypeExpr *texp)
+{
+    if (texp == nullptr)
+        return nullptr;
 
-    if (qual != p->qual)
-        return false;
-    return *sub == *p->sub;
+    // 规范的结点一定能按自身的字段找到自己，只有不规范时才需要向下规范化
+    switch (texp->kind)
+    {
+    case TypeExpr::Kind::kPointerType: {
+        auto p = texp->scst<PointerType>();
+        if (auto iter = mMap.find({p->kind, Spec::kINVALID, p->qual.const_, 0, p->sub}); iter != mMap.end())
+            return iter->second->scst<TypeExpr>();
+        return pointer(p->qual, p->sub);
+    }
+
+    case TypeExpr::Kind::kArrayType: {
+        auto p = texp->scst<ArrayType>();
+        if (auto iter = mMap.find({p->kind, Spec::kINVALID, false, p->len, p->sub}); iter != mMap.end())
+            return iter->second->scst<TypeExpr>();
+        return array(p->len, p->sub);
+    }
+
+    case TypeExpr::Kind::kFunctionType: {
+        auto p = texp->scst<FunctionType>();
+        return function(p->sub, p->params);
+    }
+
+    default:
+        ABORT();
+    }
 }
 
-bool ArrayType::__equal__(const TypeExpr &other) const
+PointerType *Type::Cache::pointer(Qual qual, TypeExpr *sub)
 {
-    if (this == &other)
-        return true;
-    auto p = dynamic_cast<const ArrayType *>(&other);
-    if (p == nullptr)
-        return false;
+    sub = self(sub);
+    return intern<PointerType>({TypeExpr::Kind::kPointerType, Spec::kINVALID, qual.const_, 0, sub}, [&] {
+        auto p = mMgr.make<PointerType>();
+        p->qual = qual, p->sub = sub;
+        return p;
+    });
+}
 
-    if (len != p->len)
-        return false;
-    return *sub == *p->sub;
+ArrayType *Type::Cache::array(std::uint32_t len, TypeExpr *sub)
+{
+    sub = self(sub);
+    return intern<ArrayType>({TypeExpr::Kind::kArrayType, Spec::kINVALID, false, len, sub}, [&] {
+        auto p = mMgr.make<ArrayType>();
+        p->len = len, p->sub = sub;
+        return p;
+    });
 }
 
-void FunctionType::__mark__(Mark mark)
+FunctionType *Type::Cache::function(TypeExpr *sub, std::vector<const Type *> params)
 {
+    sub = self(sub);
     for (auto &&i : params)
-        mark(const_cast<Type *>(i));
-    TypeExpr::__mark__(mark);
+        i = self(i->spec, i->qual, i->texp);
+    Key key{TypeExpr::Kind::kFunctionType, Spec::kINVALID, false, 0, sub, std::move(params)};
+    return intern<FunctionType>(std::move(key), [&] {
+        auto p = mMgr.make<FunctionType>();
+        p->sub = sub, p->params = key.params;
+        return p;
+    });
 }
 
-bool FunctionType::__equal__(const TypeExpr &other) const
+void Type::Cache::__mark__(Mark mark)
 {
-    if (this == &other)
-        return true;
-    auto p = dynamic_cast<const FunctionType *>(&other);
-    if (p == nullptr)
-        return false;
-
-    if (params.size() != p->params.size())
-        return false;
-    for (size_t i = 0; i < params.size(); ++i)
-        if (*params[i] != *p->params[i])
-            return false;
-    return true;
+    for (auto &&i : mMap)
+        mark(i.second);
 }
 
 //==============================================================================
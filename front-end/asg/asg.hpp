@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Ident.hpp"
 #include "Obj.hpp"
 #include <string>
+#include <unordered_map>
 
 namespace asg
 {
@@ -14,6 +16,18 @@ struct TypeExpr;
 struct Expr;
 struct Decl;
 
+/**
+ * @brief 按种类标签向下转换，种类不符时返回空指针。
+ *
+ * 每个叶子结点类型都有静态成员 kKind，其基类（TypeExpr、Expr、Stmt、Decl）
+ * 的 kind 字段在构造时被设为该值，所以判断类型只需比较一个字节，用来代替
+ * Obj::dcst 中开销较大的 dynamic_cast。只适用于叶子结点类型。
+ */
+template <typename T, typename U> T *kcst(U *obj)
+{
+    return obj != nullptr && obj->kind == T::kKind ? static_cast<T *>(obj) : nullptr;
+}
+
 struct Type : Obj
 {
     /// 说明（Specifier）
@@ -50,9 +64,13 @@ struct Type : Obj
 
     /**
      * @brief 类型等价性判断，等价性是类型系统最重要的性质，我们在这里而不是
-     * 在 Typing 中实现。
+     * 在 Typing 中实现。所有类型都经由 Cache 规范化，结构相同的类型是同一个
+     * 对象，所以只需比较指针。
      */
-    bool operator==(const Type &other) const;
+    bool operator==(const Type &other) const
+    {
+        return this == &other;
+    }
     bool operator!=(const Type &other) const
     {
         return !operator==(other);
@@ -62,76 +80,144 @@ struct Type : Obj
     void __mark__(Mark mark) override;
 
   public:
-    /**
-     * @brief 类型缓存
-     *
-     * 编译过程中，尤其是语法分析和类型推导阶段，会有大量的语义节点包含相同的
-     * 类型或子类型，重复创建这些类型节点会导致无谓的内存占用，因此使用这个类
-     * 型缓存器。考虑到我们测例中不会包含太多的类型种类，这里的实现采用了简单
-     * 的线性查找算法，更高级的做法是设计有唯一性的类型编码方法，然后使用哈希
-     * 表来映射和查找。
-     */
-    struct Cache : std::vector<const Type *>
-    {
-        Obj::Mgr &mMgr;
-
-        Cache(Obj::Mgr &mgr) : mMgr(mgr)
-        {
-        }
-
-        const Type *operator()(Spec spec, Qual qual, TypeExpr *texp);
-    };
+    struct Cache;
 };
 
 struct TypeExpr : Obj
 {
-    TypeExpr *sub{nullptr};
-
-    bool operator==(const TypeExpr &other) const
+    /// 种类标签
+    enum struct Kind : std::uint8_t
     {
-        if (this == &other)
-            return true;
-        if (this == nullptr || &other == nullptr)
-            return false;
-        return __equal__(other);
-    }
+        kINVALID,
+        kPointerType,
+        kArrayType,
+        kFunctionType,
+    };
 
-    bool operator!=(const TypeExpr &other) const
+    const Kind kind;
+    TypeExpr *sub{nullptr};
+
+    TypeExpr(Kind kind = Kind::kINVALID) : kind(kind)
     {
-        return !operator==(other);
     }
 
   protected:
     void __mark__(Mark mark) override;
-
-  private:
-    virtual bool __equal__(const TypeExpr &other) const = 0;
 };
 
 struct PointerType : TypeExpr
 {
-    Type::Qual qual;
+    static constexpr Kind kKind = Kind::kPointerType;
 
-  private:
-    bool __equal__(const TypeExpr &other) const override;
+    PointerType() : TypeExpr(kKind)
+    {
+    }
+
+    Type::Qual qual;
 };
 
 struct ArrayType : TypeExpr
 {
+    static constexpr Kind kKind = Kind::kArrayType;
+
+    ArrayType() : TypeExpr(kKind)
+    {
+    }
+
     std::uint32_t len{0}; /// 数组长度，kUnLen 表示未知
     static constexpr std::uint32_t kUnLen = UINT32_MAX;
-
-  private:
-    bool __equal__(const TypeExpr &other) const override;
 };
 
 struct FunctionType : TypeExpr
 {
+    static constexpr Kind kKind = Kind::kFunctionType;
+
+    FunctionType() : TypeExpr(kKind)
+    {
+    }
+
     std::vector<const Type *> params;
 
   private:
     void __mark__(Mark mark) override;
-    bool __equal__(const TypeExpr &other) const override;
+};
+
+/**
+ * @brief 类型缓存
+ *
+ * 编译过程中，尤其是语法分析和类型推导阶段，会有大量的语义节点包含相同的
+ * 类型或子类型，重复创建这些类型节点会导致无谓的内存占用，因此使用这个类
+ * 型缓存器。
+ *
+ * 缓存对类型做哈希联合（hash-consing）：以结点的种类、各字段和已规范化的
+ * 子结点指针作为唯一编码，结构相同的结点只创建一次。因此所有的 Type 和
+ * TypeExpr 都应当经由缓存创建，创建后不再修改，需要"改变"类型时构造新的
+ * 类型即可。Ast2Asg、Typing 和 Json2Asg 共用同一个缓存。
+ *
+ * 缓存在构造时钉在 Mgr 上，缓存中的类型在垃圾回收时总是存活。
+ */
+struct Type::Cache : Obj
+{
+    Obj::Mgr &mMgr;
+
+    Cache(Obj::Mgr &mgr) : mMgr(mgr)
+    {
+        mgr.pin(this);
+    }
+
+    ~Cache() override
+    {
+        mMgr.unpin(this);
+    }
+
+    /// 取得规范的类型，\p texp 不必是规范的
+    const Type *operator()(Spec spec, Qual qual, TypeExpr *texp);
+
+    /// 取得与 \p texp 结构相同的规范的类型表达式，找不到时按结构复制一份
+    TypeExpr *operator()(TypeExpr *texp);
+
+    /// 以下取得规范的类型表达式，参数不必是规范的
+    PointerType *pointer(Qual qual, TypeExpr *sub);
+
+    ArrayType *array(std::uint32_t len, TypeExpr *sub);
+
+    FunctionType *function(TypeExpr *sub, std::vector<const Type *> params);
+
+    /// 缓存中的结点数
+    std::size_t size() const
+    {
+        return mMap.size();
+    }
+
+  private:
+    /// 结点的唯一编码，种类为 kINVALID 的表示 Type 本身
+    struct Key
+    {
+        TypeExpr::Kind kind;
+        Spec spec{Spec::kINVALID};        /// Type 的说明
+        bool const_{false};               /// Type 或 PointerType 的限定
+        std::uint32_t len{0};             /// ArrayType 的长度
+        const Obj *sub{nullptr};          /// 规范的子结点
+        std::vector<const Type *> params; /// FunctionType 的规范参数类型
+
+        bool operator==(const Key &other) const
+        {
+            return kind == other.kind && spec == other.spec && const_ == other.const_ && len == other.len &&
+                   sub == other.sub && params == other.params;
+        }
+    };
+
+    struct Hash
+    {
+        std::size_t operator()(const Key &key) const;
+    };
+
+    std::unordered_map<Key, Obj *, Hash> mMap;
+
+    /// 查找 \p key，找不到时调用 \p make 创建并登记
+    template <typename T, typename F> T *intern(Key &&key, F make);
+
+    void __mark__(Mark mark) override;
 };
 
 //==============================================================================
@@ -149,8 +235,29 @@ struct Expr : Obj
         kLValue,
     };
 
-    const Type *type;
+    /// 种类标签
+    enum struct Kind : std::uint8_t
+    {
+        kINVALID,
+        kIntegerLiteral,
+        kStringLiteral,
+        kDeclRefExpr,
+        kParenExpr,
+        kUnaryExpr,
+        kBinaryExpr,
+        kCallExpr,
+        kInitListExpr,
+        kImplicitInitExpr,
+        kImplicitCastExpr,
+    };
+
+    const Type *type{nullptr};
     Cate cate{Cate::kINVALID};
+    const Kind kind;
+
+    Expr(Kind kind = Kind::kINVALID) : kind(kind)
+    {
+    }
 
   protected:
     void __mark__(Mark mark) override;
@@ -158,16 +265,34 @@ struct Expr : Obj
 
 struct IntegerLiteral : Expr
 {
+    static constexpr Kind kKind = Kind::kIntegerLiteral;
+
+    IntegerLiteral() : Expr(kKind)
+    {
+    }
+
     std::uint64_t val{0};
 };
 
 struct StringLiteral : Expr
 {
+    static constexpr Kind kKind = Kind::kStringLiteral;
+
+    StringLiteral() : Expr(kKind)
+    {
+    }
+
     std::string val;
 };
 
 struct DeclRefExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kDeclRefExpr;
+
+    DeclRefExpr() : Expr(kKind)
+    {
+    }
+
     Decl *decl{nullptr};
 
   private:
@@ -176,6 +301,12 @@ struct DeclRefExpr : Expr
 
 struct ParenExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kParenExpr;
+
+    ParenExpr() : Expr(kKind)
+    {
+    }
+
     Expr *sub{nullptr};
 
   private:
@@ -184,6 +315,12 @@ struct ParenExpr : Expr
 
 struct UnaryExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kUnaryExpr;
+
+    UnaryExpr() : Expr(kKind)
+    {
+    }
+
     enum Op
     {
         kINVALID,
@@ -201,6 +338,12 @@ struct UnaryExpr : Expr
 
 struct BinaryExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kBinaryExpr;
+
+    BinaryExpr() : Expr(kKind)
+    {
+    }
+
     enum Op
     {
         kINVALID,
@@ -231,6 +374,12 @@ struct BinaryExpr : Expr
 
 struct CallExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kCallExpr;
+
+    CallExpr() : Expr(kKind)
+    {
+    }
+
     Expr *head{nullptr};
     std::vector<Expr *> args;
 
@@ -240,6 +389,12 @@ struct CallExpr : Expr
 
 struct InitListExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kInitListExpr;
+
+    InitListExpr() : Expr(kKind)
+    {
+    }
+
     std::vector<Expr *> list;
 
   private:
@@ -248,10 +403,21 @@ struct InitListExpr : Expr
 
 struct ImplicitInitExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kImplicitInitExpr;
+
+    ImplicitInitExpr() : Expr(kKind)
+    {
+    }
 };
 
 struct ImplicitCastExpr : Expr
 {
+    static constexpr Kind kKind = Kind::kImplicitCastExpr;
+
+    ImplicitCastExpr() : Expr(kKind)
+    {
+    }
+
     enum
     {
         kINVALID,
@@ -260,7 +426,7 @@ struct ImplicitCastExpr : Expr
         kArrayToPointerDecay,
         kFunctionToPointerDecay,
         kNoOp,
-    } kind{kINVALID};
+    } castKind{kINVALID};
     Expr *sub{nullptr};
 
   private:
@@ -275,16 +441,49 @@ struct FunctionDecl;
 
 struct Stmt : Obj
 {
+    /// 种类标签
+    enum struct Kind : std::uint8_t
+    {
+        kINVALID,
+        kNullStmt,
+        kDeclStmt,
+        kExprStmt,
+        kCompoundStmt,
+        kIfStmt,
+        kWhileStmt,
+        kDoStmt,
+        kBreakStmt,
+        kContinueStmt,
+        kReturnStmt,
+    };
+
+    const Kind kind;
+
+    Stmt(Kind kind = Kind::kINVALID) : kind(kind)
+    {
+    }
 };
 
 struct NullStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kNullStmt;
+
+    NullStmt() : Stmt(kKind)
+    {
+    }
+
   protected:
     void __mark__(Mark mark) override;
 };
 
 struct DeclStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kDeclStmt;
+
+    DeclStmt() : Stmt(kKind)
+    {
+    }
+
     std::vector<Decl *> decls;
 
   private:
@@ -293,6 +492,12 @@ struct DeclStmt : Stmt
 
 struct ExprStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kExprStmt;
+
+    ExprStmt() : Stmt(kKind)
+    {
+    }
+
     Expr *expr{nullptr};
 
   private:
@@ -301,6 +506,12 @@ struct ExprStmt : Stmt
 
 struct CompoundStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kCompoundStmt;
+
+    CompoundStmt() : Stmt(kKind)
+    {
+    }
+
     std::vector<Stmt *> subs;
 
   private:
@@ -309,6 +520,12 @@ struct CompoundStmt : Stmt
 
 struct IfStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kIfStmt;
+
+    IfStmt() : Stmt(kKind)
+    {
+    }
+
     Expr *cond{nullptr};
     Stmt *then{nullptr}, *else_{nullptr};
 
@@ -318,6 +535,12 @@ struct IfStmt : Stmt
 
 struct WhileStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kWhileStmt;
+
+    WhileStmt() : Stmt(kKind)
+    {
+    }
+
     Expr *cond{nullptr};
     Stmt *body{nullptr};
 
@@ -327,6 +550,12 @@ struct WhileStmt : Stmt
 
 struct DoStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kDoStmt;
+
+    DoStmt() : Stmt(kKind)
+    {
+    }
+
     Stmt *body{nullptr};
     Expr *cond{nullptr};
 
@@ -336,6 +565,12 @@ struct DoStmt : Stmt
 
 struct BreakStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kBreakStmt;
+
+    BreakStmt() : Stmt(kKind)
+    {
+    }
+
     Stmt *loop{nullptr};
 
   private:
@@ -344,6 +579,12 @@ struct BreakStmt : Stmt
 
 struct ContinueStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kContinueStmt;
+
+    ContinueStmt() : Stmt(kKind)
+    {
+    }
+
     Stmt *loop{nullptr};
 
   private:
@@ -352,6 +593,12 @@ struct ContinueStmt : Stmt
 
 struct ReturnStmt : Stmt
 {
+    static constexpr Kind kKind = Kind::kReturnStmt;
+
+    ReturnStmt() : Stmt(kKind)
+    {
+    }
+
     FunctionDecl *func{nullptr};
     Expr *expr{nullptr};
 
@@ -365,8 +612,21 @@ struct ReturnStmt : Stmt
 
 struct Decl : Obj
 {
-    const Type *type;
-    std::string name;
+    /// 种类标签
+    enum struct Kind : std::uint8_t
+    {
+        kINVALID,
+        kVarDecl,
+        kFunctionDecl,
+    };
+
+    const Kind kind;
+    const Type *type{nullptr};
+    Ident name;
+
+    Decl(Kind kind = Kind::kINVALID) : kind(kind)
+    {
+    }
 
   protected:
     void __mark__(Mark mark) override;
@@ -374,6 +634,12 @@ struct Decl : Obj
 
 struct VarDecl : Decl
 {
+    static constexpr Kind kKind = Kind::kVarDecl;
+
+    VarDecl() : Decl(kKind)
+    {
+    }
+
     Expr *init{nullptr};
 
   private:
@@ -382,6 +648,12 @@ struct VarDecl : Decl
 
 struct FunctionDecl : Decl
 {
+    static constexpr Kind kKind = Kind::kFunctionDecl;
+
+    FunctionDecl() : Decl(kKind)
+    {
+    }
+
     std::vector<Decl *> params;
     CompoundStmt *body{nullptr};
 
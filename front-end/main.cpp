@@ -1,168 +1,912 @@
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include "antlr/CLexer.h"
 #include "antlr/CParser.h"
 
+#include "FastLexer.hpp"
+#include "IrCache.hpp"
+#include "TimeReport.hpp"
 #include "print_tokens.hpp"
 
 #include "asg/Obj.hpp"
 #include "asg/asg.hpp"
 #include "asg/Typing.hpp"
+#include "asg/Asg2Bin.hpp"
 #include "asg/Asg2Json.hpp"
+#include "asg/Bin2Asg.hpp"
 #include "asg/Json2Asg.hpp"
 #include "asg/EmitIR.hpp"
 #include "Ast2Asg.hpp"
+#include "Tok2Asg.hpp"
 
+#include "Optimizer.hpp"
+
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+
+namespace
+{
+
+llvm::cl::opt<std::string> optInput(llvm::cl::Positional, llvm::cl::desc("<input>"), llvm::cl::Required);
+llvm::cl::opt<std::string> optOutput(llvm::cl::Positional, llvm::cl::desc("<output>"), llvm::cl::Required);
+
+llvm::cl::opt<int> optTask("task", llvm::cl::desc("运行第几个实验：1 词法分析，2 语法分析，3 生成 LLVM IR"),
+                           llvm::cl::init(3));
+
+enum class LexerKind
+{
+    kAntlr,
+    kFast,
+};
+
+llvm::cl::opt<LexerKind> optLexer("lexer", llvm::cl::desc("实验一、二使用的词法分析器"),
+                                  llvm::cl::values(clEnumValN(LexerKind::kAntlr, "antlr", "ANTLR 生成的 CLexer"),
+                                                   clEnumValN(LexerKind::kFast, "fast", "手写的 FastLexer")),
+                                  llvm::cl::init(LexerKind::kAntlr));
+
+llvm::cl::opt<unsigned> optLexBench("lex-bench",
+                                    llvm::cl::desc("只做词法分析，重复 N 遍，输出 <字节数> <词法单元数> <秒数>"),
+                                    llvm::cl::value_desc("N"), llvm::cl::init(0));
+
+enum class ParserKind
+{
+    kAntlr,
+    kDirect,
+};
+
+llvm::cl::opt<ParserKind> optParser(
+    "parser", llvm::cl::desc("实验二使用的语法分析器"),
+    llvm::cl::values(clEnumValN(ParserKind::kAntlr, "antlr", "CParser 建立语法树，再由 Ast2Asg 转换为 ASG"),
+                     clEnumValN(ParserKind::kDirect, "direct", "手写的 Tok2Asg 直接从词法单元建立 ASG")),
+    llvm::cl::init(ParserKind::kAntlr));
+
+enum class ParseMode
+{
+    kLL,
+    kTwoStage,
+};
+
+llvm::cl::opt<ParseMode> optParseMode(
+    "parse-mode", llvm::cl::desc("实验二的语法分析方式"),
+    llvm::cl::values(clEnumValN(ParseMode::kLL, "ll", "直接使用完整的 LL 预测"),
+                     clEnumValN(ParseMode::kTwoStage, "two-stage", "先用 SLL 预测快速解析，失败时再用 LL 重新解析")),
+    llvm::cl::init(ParseMode::kTwoStage));
+
+enum class AsgFormat
+{
+    kJson,
+    kBinary,
+};
+
+llvm::cl::opt<AsgFormat> optAsgFormat(
+    "asg-format", llvm::cl::desc("实验二输出的 ASG 格式，实验二、三的输入是否为二进制 ASG 按文件头自动识别"),
+    llvm::cl::values(clEnumValN(AsgFormat::kJson, "json", "与 clang -ast-dump=json 兼容的 JSON"),
+                     clEnumValN(AsgFormat::kBinary, "bin", "紧凑的二进制格式，见 asg/AsgBin.hpp")),
+    llvm::cl::init(AsgFormat::kJson));
+
+enum class EmitKind
+{
+    kNone,
+    kTokens,
+    kAsgJson,
+    kLLVM,
+    kBitcode,
+    kObject,
+};
+
+llvm::cl::opt<EmitKind> optEmit(
+    "emit", llvm::cl::desc("一体化驱动：在一个进程内从预处理后的源码一路编译到指定的输出，忽略 -task"),
+    llvm::cl::values(clEnumValN(EmitKind::kTokens, "tokens", "词法单元，同实验一"),
+                     clEnumValN(EmitKind::kAsgJson, "asg-json", "ASG 的 JSON，同实验二"),
+                     clEnumValN(EmitKind::kLLVM, "llvm", "优化后的 LLVM IR 文本"),
+                     clEnumValN(EmitKind::kBitcode, "bc", "优化后的 LLVM 位码"),
+                     clEnumValN(EmitKind::kObject, "obj", "本机的目标文件")),
+    llvm::cl::init(EmitKind::kNone));
+
+llvm::cl::opt<bool> optNoOpt("O0", llvm::cl::desc("一体化驱动不运行优化流水线"));
+
+llvm::cl::opt<bool> optBatch(
+    "batch", llvm::cl::desc("批量模式：<input> 是每行一个源文件路径的列表，<output> 是输出目录，在线程池上编译，"
+                            "按 -emit 输出（默认为 llvm），结果汇总在输出目录的 summary.json 中"));
+
+llvm::cl::opt<std::string> optBatchRoot("batch-root",
+                                        llvm::cl::desc("批量模式中列表里相对路径的基准目录，默认为列表所在的目录"),
+                                        llvm::cl::value_desc("dir"));
+
+llvm::cl::opt<unsigned> optJobs("j", llvm::cl::desc("批量模式的工作线程数，0 表示与 CPU 核数相同"),
+                                llvm::cl::value_desc("N"), llvm::cl::init(0));
+
+llvm::cl::opt<unsigned> optIrJobs("ir-jobs",
+                                  llvm::cl::desc("EmitIR 并行发射函数体的线程数，0 表示与 CPU 核数相同，1 为串行发射"),
+                                  llvm::cl::value_desc("N"), llvm::cl::init(1));
+
+llvm::cl::opt<bool> optIrSsa("ir-ssa",
+                            llvm::cl::desc("EmitIR 直接构造 SSA，标量的局部变量和参数不分配 alloca，优化时不再运行 "
+                                           "Mem2Reg"));
+
+llvm::cl::opt<std::string> optIrCache("ir-cache",
+                                      llvm::cl::desc("一体化驱动按函数缓存优化后的 IR 的目录，函数未改变时跳过其 "
+                                                     "EmitIR 和优化，见 IrCache.hpp"),
+                                      llvm::cl::value_desc("dir"));
+
+llvm::cl::opt<unsigned> optIrCacheSize("ir-cache-size",
+                                       llvm::cl::desc("IR 缓存的大小上限（MiB），超过时淘汰最久未用的文件"),
+                                       llvm::cl::value_desc("MiB"), llvm::cl::init(512));
+
+llvm::cl::opt<bool> optTimeReport(
+    "time-report", llvm::cl::desc("在标准错误上报告各阶段（含每次垃圾回收和每个优化 pass）的墙钟时间、CPU 时间和峰值 "
+                                  "RSS，一体化驱动总是报告"));
+
+llvm::cl::opt<std::string> optTimeReportJson("time-report-json",
+                                             llvm::cl::desc("把各阶段的用时和内存以 JSON 格式写到指定的文件"),
+                                             llvm::cl::value_desc("file"));
+
+/// 读入整个文件
+bool read_file(const std::string &path, std::string &text)
+{
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile)
+        return false;
+    std::ostringstream oss;
+    oss << inFile.rdbuf();
+    text = std::move(oss).str();
+    return true;
+}
+
+/// 按 -lexer 选项创建词法分析器，\p input 是 \p text 对应的字符流，只有 CLexer 使用
+std::unique_ptr<antlr4::TokenSource> make_lexer(std::string_view text, antlr4::ANTLRInputStream &input,
+                                                const std::string &path = optInput)
+{
+    if (optLexer == LexerKind::kFast)
+        return std::make_unique<FastLexer>(text, path);
+    return std::make_unique<CLexer>(&input);
+}
 
-int main_task1(int argc, char *argv[])
+/**
+ * @brief 按 -parse-mode 选项解析整个编译单元，并报告每一阶段的结果和用时
+ *
+ * 两阶段解析时，先用 SLL 预测加 BailErrorStrategy 解析，遇到语法错误（可能是
+ * SLL 预测不够准确，也可能是输入本身有错）立即放弃；然后回到开头，恢复默认的
+ * 错误处理，用完整的 LL 预测重新解析。SLL 阶段移除了错误监听器，所以只有 LL
+ * 阶段报告语法错误，报告的内容与直接 LL 解析相同。
+ * 对于合法的输入，SLL 几乎总能成功，省去了 LL 预测中代价最大的全上下文回溯。
+ */
+CParser::CompilationUnitContext *parse(CParser &parser)
 {
-    if (argc != 3)
+    auto stage = [&](antlr4::atn::PredictionMode mode, const char *name) -> CParser::CompilationUnitContext *
     {
-        std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-        return -1;
+        parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(mode);
+        auto begin = std::chrono::steady_clock::now();
+        CParser::CompilationUnitContext *ret = nullptr;
+        try
+        {
+            ret = parser.compilationUnit();
+        }
+        catch (antlr4::ParseCancellationException &)
+        {
+        }
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - begin;
+        if (!optBatch) // 批量模式下各线程的输出会交错
+            std::cout << "解析 " << name << (ret ? " 成功 " : " 失败 ") << ms.count() << " ms" << std::endl;
+        return ret;
+    };
+
+    if (optParseMode == ParseMode::kTwoStage)
+    {
+        // SLL 阶段的语法错误不报告，只由 LL 阶段报告
+        auto listeners = parser.getErrorListeners();
+        parser.removeErrorListeners();
+        parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+        auto ret = stage(antlr4::atn::PredictionMode::SLL, "SLL");
+        for (auto listener : listeners)
+            parser.addErrorListener(listener);
+        if (ret)
+            return ret;
+
+        parser.reset();
+        parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
     }
 
-    std::ifstream inFile(argv[1]);
-    if (!inFile)
+    return stage(antlr4::atn::PredictionMode::LL, "LL");
+}
+
+/**
+ * @brief 按 -lexer、-parser 选项把 \p text 解析为 ASG，此时还没有推导类型
+ *
+ * 使用 CParser 时先 fill 整个 CommonTokenStream，词法分析和语法分析分开计时；
+ * 反正解析完 CommonTokenStream 里也会留着全部词法单元。Tok2Asg 边词法分析边
+ * 建立 ASG，两者计入同一个阶段。
+ */
+asg::TranslationUnit *parse_asg(std::string_view text, Obj::Mgr &mgr, asg::Type::Cache &typeCache,
+                                TimeReport &report, const std::string &path = optInput)
+{
+    antlr4::ANTLRInputStream input(text);
+    auto lexer = make_lexer(text, input, path);
+
+    if (optParser == ParserKind::kDirect)
     {
-        std::cout << "Error: unable to open input file: " << argv[1] << '\n';
-        return -2;
+        TimeReport::Scope scope(report, "Tok2Asg");
+        Obj::Mgr::Phase phase(mgr, "Tok2Asg");
+        asg::Tok2Asg tok2asg(mgr, typeCache, *lexer);
+        return tok2asg();
     }
 
-    std::ofstream outFile(argv[2]);
-    if (!outFile)
+    // 语法树在转换完后即可释放
+    antlr4::CommonTokenStream tokens(lexer.get());
     {
-        std::cout << "Error: unable to open output file: " << argv[2] << '\n';
-        return -3;
+        TimeReport::Scope scope(report, "lex");
+        tokens.fill();
     }
 
-    std::cout << "程序 '" << argv[0] << std::endl;
-    std::cout << "输入 '" << argv[1] << std::endl;
-    std::cout << "输出 '" << argv[2] << std::endl;
+    CParser parser(&tokens);
+    CParser::CompilationUnitContext *ast;
+    {
+        TimeReport::Scope scope(report, "parse");
+        ast = parse(parser);
+    }
 
-    antlr4::ANTLRInputStream input(inFile);
-    CLexer lexer(&input);
+    TimeReport::Scope scope(report, "Ast2Asg");
+    Obj::Mgr::Phase phase(mgr, "Ast2Asg");
+    asg::Ast2Asg ast2asg(mgr, typeCache);
+    return ast2asg(ast->translationUnit());
+}
+
+/// -ir-jobs 选项对应的线程数
+unsigned ir_jobs()
+{
+    return optIrJobs ? optIrJobs : std::max(1u, std::thread::hardware_concurrency());
+}
 
-    antlr4::CommonTokenStream tokens(&lexer);
-    tokens.fill();
+/// 垃圾回收，每次回收在 \p report 中单独记为一项
+void collect(Obj::Mgr &mgr, TimeReport &report, bool full = false)
+{
+    TimeReport::Scope scope(report, "gc #" + std::to_string(mgr.mGcLog.size() + 1));
+    mgr.gc(full);
+}
 
-    print_tokens_clang(tokens, outFile);
+/// 运行优化流水线，每个 pass 在 \p report 中记为 opt 下的一项
+void run_opt(llvm::Module &mod, llvm::raw_ostream &log, TimeReport &report)
+{
+    llvm::PassInstrumentationCallbacks pic;
+    report.instrument(pic);
 
-    return 0;
+    TimeReport::Scope scope(report, "opt");
+    opt(mod, log, &pic, !optIrSsa);
 }
 
-int main_task2(int argc, char *argv[])
+/// 按 -time-report、-time-report-json 选项输出 \p report，\p always 为真时总是打印表格
+bool print_time_report(const TimeReport &report, bool always = false)
 {
-    if (argc != 3)
+    if (optTimeReport || always)
+        report.print(llvm::errs());
+
+    if (optTimeReportJson.empty())
+        return true;
+
+    std::error_code ec;
+    llvm::raw_fd_ostream jsonFile(optTimeReportJson, ec, llvm::sys::fs::OF_Text);
+    if (ec)
     {
-        std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-        return -1;
+        std::cout << "Error: unable to open output file: " << optTimeReportJson << '\n';
+        return false;
     }
+    llvm::json::OStream json(jsonFile, 2);
+    report.print_json(json);
+    jsonFile << '\n';
+    return true;
+}
 
-    std::ifstream inFile(argv[1]);
-    if (!inFile)
+/// 创建本机的目标机器，失败时返回空指针并设置 \p err
+std::unique_ptr<llvm::TargetMachine> make_target_machine(std::string &err)
+{
+    // 批量模式下会被多个线程同时调用
+    static std::once_flag once;
+    std::call_once(once,
+                   []
+                   {
+                       llvm::InitializeNativeTarget();
+                       llvm::InitializeNativeTargetAsmPrinter();
+                   });
+
+    auto triple = llvm::sys::getDefaultTargetTriple();
+    auto target = llvm::TargetRegistry::lookupTarget(triple, err);
+    if (!target)
+        return nullptr;
+    return std::unique_ptr<llvm::TargetMachine>(
+        target->createTargetMachine(triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+}
+
+/// 一体化驱动编译一个文件的结果
+struct CompileResult
+{
+    int status{0};      /// 同单文件模式的退出码，0 表示成功
+    std::string error;  /// 失败的原因
+    TimeReport report;  /// 各阶段的用时和内存
+    IrCache::Stats cache; /// -ir-cache 的命中情况
+};
+
+/**
+ * @brief 一体化驱动：按 -emit 选项把预处理后的源码 \p input 编译到 \p output
+ *
+ * 在同一个 llvm::Module 上依次完成词法和语法分析、类型推导、IR 生成、优化和
+ * 输出，阶段之间不经过 JSON 或文本 IR，各阶段的用时和内存记在结果的 report
+ * 中。Obj::Mgr、语法分析器、LLVMContext 等状态都在函数内创建，也不写标准输出，
+ * 所以批量模式可以在多个线程中同时调用。
+ */
+CompileResult compile(const std::string &input, const std::string &output)
+{
+    CompileResult result;
+    auto fail = [&](int status, std::string error)
     {
-        std::cout << "Error: unable to open input file: " << argv[1] << '\n';
-        return -2;
+        result.status = status;
+        result.error = std::move(error);
+        return result;
+    };
+
+    std::string text;
+    if (!read_file(input, text))
+        return fail(-2, "unable to open input file: " + input);
+
+    auto &report = result.report;
+
+    if (optEmit == EmitKind::kTokens)
+    {
+        std::ofstream outFile(output);
+        if (!outFile)
+            return fail(-3, "unable to open output file: " + output);
+
+        TimeReport::Scope scope(report, "lex");
+        antlr4::ANTLRInputStream charStream(text);
+        auto lexer = make_lexer(text, charStream, input);
+        print_tokens_clang(*lexer, outFile);
+        return result;
     }
 
     std::error_code ec;
-    llvm::StringRef outPath(argv[2]);
-    llvm::raw_fd_ostream outFile(outPath, ec);
+    llvm::raw_fd_ostream outFile(output, ec, optEmit >= EmitKind::kBitcode ? llvm::sys::fs::OF_None
+                                                                           : llvm::sys::fs::OF_Text);
     if (ec)
+        return fail(-3, "unable to open output file: " + output);
+
+    Obj::Mgr mgr;
+    asg::Type::Cache typeCache(mgr);
+    asg::TranslationUnit *asg = parse_asg(text, mgr, typeCache, report, input);
+    mgr.mRoot = asg;
+    collect(mgr, report);
+
     {
-        std::cout << "Error: unable to open output file: " << argv[2] << '\n';
-        return -3;
+        TimeReport::Scope scope(report, "Typing");
+        Obj::Mgr::Phase phase(mgr, "Typing");
+        asg::Typing inferType(mgr, typeCache);
+        inferType(asg);
+    }
+    collect(mgr, report);
+
+    if (optEmit == EmitKind::kAsgJson)
+    {
+        TimeReport::Scope scope(report, "emit");
+        asg::Asg2Json asg2json(outFile);
+        asg2json(asg);
+        outFile << '\n';
+        return result;
     }
 
-    std::cout << "程序 '" << argv[0] << std::endl;
-    std::cout << "输入 '" << argv[1] << std::endl;
-    std::cout << "输出 '" << argv[2] << std::endl;
+    llvm::LLVMContext ctx;
+    EmitIR emitIR(mgr, ctx, input);
+    emitIR.mSsa = optIrSsa;
+    llvm::Module *mod = &emitIR.mMod;
+
+    // 生成目标文件时，发射和优化前就要确定目标的数据布局
+    std::string err;
+    std::unique_ptr<llvm::TargetMachine> tm;
+    llvm::legacy::PassManager codegen;
+    if (optEmit == EmitKind::kObject)
+    {
+        tm = make_target_machine(err);
+        if (!tm)
+            return fail(4, err);
+        if (tm->addPassesToEmitFile(codegen, outFile, nullptr, llvm::CodeGenFileType::ObjectFile))
+            return fail(4, "目标机器不能生成目标文件");
+        mod->setTargetTriple(tm->getTargetTriple().str());
+        mod->setDataLayout(tm->createDataLayout());
+    }
 
-    antlr4::ANTLRInputStream input(inFile);
-    CLexer lexer(&input);
+    // 批量模式下丢弃各个 pass 的统计信息，免得多个线程同时写 errs()
+    llvm::raw_null_ostream quiet;
+    auto &log = optBatch ? static_cast<llvm::raw_ostream &>(quiet) : llvm::errs();
 
-    antlr4::CommonTokenStream tokens(&lexer);
-    CParser parser(&tokens);
+    // 使用 IR 缓存时逐个函数发射并优化，读回的函数已经优化过
+    bool cached = !optIrCache.empty();
+    if (cached)
+    {
+        TimeReport::Scope scope(report, "IrCache");
+        Obj::Mgr::Phase phase(mgr, "IrCache");
+        IrCache cache(optIrCache, std::uint64_t(optIrCacheSize) << 20);
+        std::string config = optNoOpt ? "O0" : "O1";
+        if (optIrSsa)
+            config += " ssa";
+        config += ' ' + mod->getTargetTriple() + ' ' + mod->getDataLayoutStr();
+        bool ok = cache(emitIR, asg, config,
+                        [&](llvm::Module &m)
+                        {
+                            if (!optNoOpt)
+                                run_opt(m, log, report);
+                        },
+                        err);
+        result.cache = cache.stats();
+        if (!ok)
+            return fail(3, err);
+    }
+    else
+    {
+        TimeReport::Scope scope(report, "EmitIR");
+        Obj::Mgr::Phase phase(mgr, "EmitIR");
+        emitIR(asg, ir_jobs());
+    }
 
-    auto ast = parser.compilationUnit();
-    Obj::Mgr mgr;
+    // ASG 到此为止，优化和输出只用到模块
+    mgr.mRoot = nullptr;
+    collect(mgr, report, true);
 
-    asg::Ast2Asg ast2asg(mgr);
-    auto asg = ast2asg(ast->translationUnit());
-    mgr.mRoot = asg;
-    mgr.gc();
+    llvm::raw_string_ostream errStream(err);
+    {
+        TimeReport::Scope scope(report, "verify");
+        if (llvm::verifyModule(*mod, &errStream))
+            return fail(3, errStream.str());
+    }
 
-    asg::Typing inferType(mgr);
-    inferType(asg);
-    mgr.gc();
+    if (!optNoOpt && !cached)
+        run_opt(*mod, log, report);
+
+    TimeReport::Scope scope(report, "emit");
+    if (optEmit == EmitKind::kLLVM)
+        mod->print(outFile, nullptr, false, true);
+    else if (optEmit == EmitKind::kBitcode)
+        llvm::WriteBitcodeToFile(*mod, outFile);
+    else
+        codegen.run(*mod);
+    return result;
+}
+
+} // namespace
+
+int main_task1(const char *argv0)
+{
+    std::string text;
+    if (!read_file(optInput, text))
+    {
+        std::cout << "Error: unable to open input file: " << optInput << '\n';
+        return -2;
+    }
+
+    std::ofstream outFile(optOutput);
+    if (!outFile)
+    {
+        std::cout << "Error: unable to open output file: " << optOutput << '\n';
+        return -3;
+    }
 
-    asg::Asg2Json asg2json;
-    llvm::json::Value json = asg2json(asg);
+    std::cout << "程序 '" << argv0 << std::endl;
+    std::cout << "输入 '" << optInput << std::endl;
+    std::cout << "输出 '" << optOutput << std::endl;
 
-    outFile << json << '\n';
+    antlr4::ANTLRInputStream input(text);
+    auto lexer = make_lexer(text, input);
+
+    // 边词法分析边输出，不把词法单元全部留在 CommonTokenStream 里
+    print_tokens_clang(*lexer, outFile);
 
     return 0;
 }
 
-int main_task3(int argc, char *argv[])
+int main_task2(const char *argv0)
 {
-    if (argc != 3)
+    std::string text;
+    if (!read_file(optInput, text))
     {
-        std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-        return -1;
+        std::cout << "Error: unable to open input file: " << optInput << '\n';
+        return -2;
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream outFile(optOutput, ec);
+    if (ec)
+    {
+        std::cout << "Error: unable to open output file: " << optOutput << '\n';
+        return -3;
+    }
+
+    std::cout << "程序 '" << argv0 << std::endl;
+    std::cout << "输入 '" << optInput << std::endl;
+    std::cout << "输出 '" << optOutput << std::endl;
+
+    Obj::Mgr mgr;
+    asg::Type::Cache typeCache(mgr);
+    TimeReport report;
+
+    asg::TranslationUnit *asg;
+    if (asg::bin::is_asg_bin(text.data(), text.size()))
+    {
+        // 输入已经是类型检查过的 ASG，只做格式转换
+        TimeReport::Scope scope(report, "Bin2Asg");
+        Obj::Mgr::Phase phase(mgr, "Bin2Asg");
+        asg::Bin2Asg bin2asg(mgr, typeCache);
+        asg = bin2asg(text);
+        mgr.mRoot = asg;
+    }
+    else
+    {
+        asg = parse_asg(text, mgr, typeCache, report);
+        mgr.mRoot = asg;
+        collect(mgr, report);
+
+        {
+            TimeReport::Scope scope(report, "Typing");
+            Obj::Mgr::Phase phase(mgr, "Typing");
+            asg::Typing inferType(mgr, typeCache);
+            inferType(asg);
+        }
+    }
+    collect(mgr, report);
+
+    {
+        TimeReport::Scope scope(report, "emit");
+        if (optAsgFormat == AsgFormat::kBinary)
+        {
+            asg::Asg2Bin asg2bin(outFile);
+            asg2bin(asg);
+        }
+        else
+        {
+            // 边遍历边输出，不在内存中建立整棵 JSON 树
+            asg::Asg2Json asg2json(outFile);
+            asg2json(asg);
+            outFile << '\n';
+        }
     }
 
-    auto inFileOrErr = llvm::MemoryBuffer::getFile(argv[1]);
+    if (std::getenv("SYSUC_MGR_STATS"))
+        mgr.print_stats(stderr);
+
+    return print_time_report(report) ? 0 : -3;
+}
+
+int main_task3()
+{
+    auto inFileOrErr = llvm::MemoryBuffer::getFile(optInput);
     if (auto err = inFileOrErr.getError())
     {
-        std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+        std::cout << "Error: unable to open input file: " << optInput << '\n';
         return -2;
     }
     auto inFile = std::move(inFileOrErr.get());
     std::error_code ec;
-    llvm::StringRef outPath(argv[2]);
-    llvm::raw_fd_ostream outFile(outPath, ec);
+    llvm::raw_fd_ostream outFile(optOutput, ec);
     if (ec)
     {
-        std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+        std::cout << "Error: unable to open output file: " << optOutput << '\n';
         return -3;
     }
 
-    auto json = llvm::json::parse(inFile->getBuffer());
-    if (!json)
+    // 输入是 JSON 时边扫描边转换为 ASG，不建立 DOM
+    Obj::Mgr mgr;
+    asg::Type::Cache typeCache(mgr);
+    TimeReport report;
+    asg::TranslationUnit *asg;
     {
-        std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
-        return 1;
+        auto buffer = inFile->getBuffer();
+        if (asg::bin::is_asg_bin(buffer.data(), buffer.size()))
+        {
+            TimeReport::Scope scope(report, "Bin2Asg");
+            Obj::Mgr::Phase phase(mgr, "Bin2Asg");
+            asg::Bin2Asg bin2asg(mgr, typeCache);
+            asg = bin2asg(buffer);
+        }
+        else
+        {
+            TimeReport::Scope scope(report, "Json2Asg");
+            Obj::Mgr::Phase phase(mgr, "Json2Asg");
+            Json2Asg json2asg(mgr, typeCache);
+            asg = json2asg(buffer);
+        }
     }
-
-    // 读取 JSON，转换为 ASG
-    Obj::Mgr mgr;
-    Json2Asg json2asg(mgr);
-    auto asg = json2asg(json.get());
     mgr.mRoot = asg;
-    mgr.gc();
+    collect(mgr, report);
 
     // 从 ASG 发射到 LLVM IR
     llvm::LLVMContext ctx;
     EmitIR emitIR(mgr, ctx);
-    auto &mod = emitIR(asg);
-    mgr.gc();
+    emitIR.mSsa = optIrSsa;
+    llvm::Module *mod;
+    {
+        TimeReport::Scope scope(report, "EmitIR");
+        Obj::Mgr::Phase phase(mgr, "EmitIR");
+        mod = &emitIR(asg, ir_jobs());
+    }
+    collect(mgr, report);
+
+    if (std::getenv("SYSUC_MGR_STATS"))
+        mgr.print_stats(stderr);
 
     // 先把 LLVM IR 写出到文件里，再检查合不合法
-    mod.print(outFile, nullptr, false, true);
-    if (llvm::verifyModule(mod, &llvm::outs()))
-        return 3;
+    {
+        TimeReport::Scope scope(report, "emit");
+        mod->print(outFile, nullptr, false, true);
+    }
+    bool broken;
+    {
+        TimeReport::Scope scope(report, "verify");
+        broken = llvm::verifyModule(*mod, &llvm::outs());
+    }
+
+    if (!print_time_report(report))
+        return -3;
+    return broken ? 3 : 0;
+}
+
+/// 一体化驱动，由 -emit 选项启用，在标准错误上报告各阶段的用时和内存
+int main_compile()
+{
+    auto result = compile(optInput, optOutput);
+    if (result.status != 0)
+    {
+        std::cout << "Error: " << result.error << '\n';
+        return result.status;
+    }
+
+    if (!optIrCache.empty())
+    {
+        llvm::errs() << "IR 缓存：命中 " << result.cache.mHits << "，未命中 " << result.cache.mMisses << "，读入 "
+                     << result.cache.mBytesRead << " 字节，写入 " << result.cache.mBytesWritten << " 字节\n";
+        IrCache(optIrCache, std::uint64_t(optIrCacheSize) << 20).prune();
+    }
+
+    return print_time_report(result.report, true) ? 0 : -3;
+}
 
+/**
+ * @brief 批量模式，由 -batch 选项启用
+ *
+ * 工作线程从同一个原子计数器领取下一个文件，每个文件独立调用 compile，所以各
+ * 线程有自己的 Obj::Mgr、语法分析器和 LLVMContext；线程间共享的只有只读的选项、
+ * 加锁的标识符表和 ANTLR 的静态数据（在启动线程前初始化）。每个文件的结果按列表
+ * 的顺序写入输出目录下的 summary.json。
+ *
+ * 注意前端内部的 ABORT 仍会终止整个进程。
+ */
+int main_batch()
+{
+    std::string listText;
+    if (!read_file(optInput, listText))
+    {
+        std::cout << "Error: unable to open input file: " << optInput << '\n';
+        return -2;
+    }
+
+    if (auto ec = llvm::sys::fs::create_directories(optOutput))
+    {
+        std::cout << "Error: unable to create output directory: " << optOutput << '\n';
+        return -3;
+    }
+
+    llvm::SmallString<256> root(optBatchRoot);
+    if (root.empty())
+        root = llvm::sys::path::parent_path(optInput);
+
+    const char *ext = ".ll";
+    switch (optEmit)
+    {
+    case EmitKind::kTokens:
+        ext = ".tokens";
+        break;
+    case EmitKind::kAsgJson:
+        ext = ".json";
+        break;
+    case EmitKind::kBitcode:
+        ext = ".bc";
+        break;
+    case EmitKind::kObject:
+        ext = ".o";
+        break;
+    default:
+        optEmit = EmitKind::kLLVM;
+        break;
+    }
+
+    // 相对路径的输出保持列表中的目录结构，绝对路径只取文件名
+    std::vector<std::pair<std::string, std::string>> files;
+    for (llvm::StringRef rest = listText; !rest.empty();)
+    {
+        llvm::StringRef line;
+        std::tie(line, rest) = rest.split('\n');
+        line = line.trim();
+        if (line.empty() || line.starts_with("#"))
+            continue;
+
+        llvm::SmallString<256> in, out(optOutput.getValue());
+        if (llvm::sys::path::is_absolute(line))
+            in = line, llvm::sys::path::append(out, llvm::sys::path::filename(line));
+        else
+            in = root, llvm::sys::path::append(in, line), llvm::sys::path::append(out, line);
+        out += ext;
+
+        if (auto ec = llvm::sys::fs::create_directories(llvm::sys::path::parent_path(out)))
+        {
+            std::cout << "Error: unable to create output directory: " << out.str().str() << '\n';
+            return -3;
+        }
+        files.emplace_back(in.str(), out.str());
+    }
+
+    if (optParser == ParserKind::kAntlr || optLexer == LexerKind::kAntlr)
+    {
+        CLexer::initialize();
+        CParser::initialize();
+    }
+
+    unsigned jobs = optJobs ? optJobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<std::size_t>(jobs, std::max<std::size_t>(files.size(), 1));
+
+    std::vector<CompileResult> results(files.size());
+    std::atomic<std::size_t> next{0};
+    auto begin = std::chrono::steady_clock::now();
+    {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < jobs; ++i)
+            workers.emplace_back(
+                [&]
+                {
+                    for (std::size_t j; (j = next.fetch_add(1, std::memory_order_relaxed)) < files.size();)
+                        results[j] = compile(files[j].first, files[j].second);
+                });
+        for (auto &&i : workers)
+            i.join();
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - begin;
+
+    std::size_t failed = 0;
+    IrCache::Stats cache;
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        cache += results[i].cache;
+        if (results[i].status != 0)
+        {
+            ++failed;
+            std::cout << "FAIL " << files[i].first << ": " << results[i].error << '\n';
+        }
+    }
+    if (!optIrCache.empty())
+        IrCache(optIrCache, std::uint64_t(optIrCacheSize) << 20).prune();
+
+    llvm::SmallString<256> summaryPath(optOutput.getValue());
+    llvm::sys::path::append(summaryPath, "summary.json");
+    std::error_code ec;
+    llvm::raw_fd_ostream summary(summaryPath, ec, llvm::sys::fs::OF_Text);
+    if (ec)
+    {
+        std::cout << "Error: unable to open output file: " << summaryPath.str().str() << '\n';
+        return -3;
+    }
+
+    llvm::json::OStream json(summary, 2);
+    json.object(
+        [&]
+        {
+            json.attribute("jobs", jobs);
+            json.attribute("files", files.size());
+            json.attribute("failed", failed);
+            json.attribute("seconds", secs.count());
+            if (!optIrCache.empty())
+            {
+                json.attribute("cache_hits", cache.mHits);
+                json.attribute("cache_misses", cache.mMisses);
+            }
+            json.attributeArray("results",
+                                [&]
+                                {
+                                    for (std::size_t i = 0; i < files.size(); ++i)
+                                    {
+                                        auto &result = results[i];
+                                        json.object(
+                                            [&]
+                                            {
+                                                json.attribute("input", files[i].first);
+                                                json.attribute("output", files[i].second);
+                                                json.attribute("status", result.status);
+                                                if (result.status != 0)
+                                                    json.attribute("error", result.error);
+                                                if (!optIrCache.empty())
+                                                {
+                                                    json.attribute("cache_hits", result.cache.mHits);
+                                                    json.attribute("cache_misses", result.cache.mMisses);
+                                                }
+                                                json.attributeObject(
+                                                    "ms",
+                                                    [&]
+                                                    {
+                                                        for (auto &&i : result.report.entries())
+                                                            if (i.mDepth == 0)
+                                                                json.attribute(i.mName, i.mTime.getWallTime() * 1e3);
+                                                        json.attribute("total", result.report.total_ms());
+                                                    });
+                                            });
+                                    }
+                                });
+        });
+    summary << '\n';
+
+    std::cout << files.size() - failed << '/' << files.size() << " 个文件编译成功，" << jobs << " 个线程，用时 "
+              << secs.count() << " 秒\n";
+    if (!optIrCache.empty())
+        std::cout << "IR 缓存：命中 " << cache.mHits << "，未命中 " << cache.mMisses << '\n';
+    return failed ? 1 : 0;
+}
+
+/// 词法分析的吞吐量测试，输入文件通常是预处理后的测例
+int main_lex_bench()
+{
+    std::string text;
+    if (!read_file(optInput, text))
+    {
+        std::cout << "Error: unable to open input file: " << optInput << '\n';
+        return -2;
+    }
+
+    std::size_t tokens = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < optLexBench; ++i)
+    {
+        antlr4::ANTLRInputStream input(text);
+        auto lexer = make_lexer(text, input);
+        while (lexer->nextToken()->getType() != antlr4::Token::EOF)
+            ++tokens;
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - begin;
+
+    std::cout << text.size() * optLexBench << ' ' << tokens << ' ' << secs.count() << '\n';
     return 0;
 }
 
 int main(int argc, char *argv[])
 {
-    // main_task1(argc, argv);
-    // main_task2(argc, argv);
-    main_task3(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "SYSU 编译器\n");
+
+    if (optLexBench != 0)
+        return main_lex_bench();
+
+    if (optBatch)
+        return main_batch();
+
+    if (optEmit != EmitKind::kNone)
+        return main_compile();
+
+    switch (optTask)
+    {
+    case 1:
+        return main_task1(argv[0]);
+    case 2:
+        return main_task2(argv[0]);
+    case 3:
+        return main_task3();
+    default:
+        std::cout << "Error: unknown task: " << optTask << '\n';
+        return -1;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "print_tokens.hpp"
 
+#include <charconv>
 #include <sstream>
 
 const char *const tokenType2ClangStr[] = {
@@ -218,6 +219,107 @@ void print_tokens_clang(antlr4::CommonTokenStream &tokens, std::ofstream &outFil
     }
 }
 
+namespace
+{
+
+void append_uint(std::string &buf, std::size_t value)
+{
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    buf.append(digits, end);
+}
+
+/// 与 print_token_clang 的格式相同，但追加到 \p buf 中，不产生临时字符串
+void format_token_clang(std::string &buf, const antlr4::Token *token, const std::string &srcFileName, size_t line,
+                        bool startOfLine, bool leadingSpace)
+{
+    auto tokenType = token->getType();
+    buf.append(tokenType == antlr4::Token::EOF ? "eof" : tokenType2ClangStr[tokenType]);
+
+    buf.append(" '");
+    if (tokenType != antlr4::Token::EOF)
+        buf.append(token->getText());
+    buf.append("'\t");
+    if (startOfLine)
+        buf.append(" [StartOfLine]");
+    if (leadingSpace)
+        buf.append(" [LeadingSpace]");
+    buf.append("\tLoc=<").append(srcFileName).push_back(':');
+    append_uint(buf, line);
+    buf.push_back(':');
+    append_uint(buf, token->getCharPositionInLine() + 1);
+    buf.append(">\n");
+}
+
+} // namespace
+
+void print_tokens_clang(antlr4::TokenSource &source, std::ostream &out)
+{
+    // 缓冲区攒到这么大时写出一次
+    constexpr std::size_t kFlushSize = std::size_t(1) << 16;
+    std::string buf;
+    buf.reserve(kFlushSize * 2);
+
+    size_t line = 1;
+    std::string curFileName;
+    bool startOfLine = true;
+    bool lastIsWhitespace = false;
+    bool lastIsDirective = false;
+
+    while (true)
+    {
+        auto token = source.nextToken();
+        auto tokenType = token->getType();
+
+        if (tokenType == 115) // Directive
+        {
+            auto lm = parse_linemarker(token->getText());
+            line = lm.linenum;
+            curFileName = std::move(lm.filename);
+
+            startOfLine = false;
+            lastIsWhitespace = false;
+            lastIsDirective = true;
+        }
+        else if (tokenType == 117) // Whitespace
+        {
+            // 不影响 startOfLine
+            lastIsWhitespace = true;
+            lastIsDirective = false;
+        }
+        else if (tokenType == 118) // Newline
+        {
+            if (!lastIsDirective)
+            {
+                line += 1;
+            }
+
+            startOfLine = true;
+            lastIsWhitespace = false;
+            lastIsDirective = false;
+        }
+        else
+        {
+            format_token_clang(buf, token.get(), curFileName, line, startOfLine, lastIsWhitespace);
+            if (buf.size() >= kFlushSize)
+            {
+                out.write(buf.data(), buf.size());
+                buf.clear();
+            }
+
+            startOfLine = false;
+            lastIsWhitespace = false;
+            lastIsDirective = false;
+        }
+
+        if (tokenType == antlr4::Token::EOF)
+            break;
+    }
+
+    out.write(buf.data(), buf.size());
+    out.flush();
+}
+
 void print_token_antlr(const antlr4::Token *token, std::ofstream &outFile, std::string srcFileName, int line,
                        bool startOfLine, bool leadingSpace, const CLexer &lexer)
 {
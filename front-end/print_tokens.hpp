@@ -8,5 +8,13 @@
 
 void print_tokens_clang(antlr4::CommonTokenStream &tokens, std::ofstream &outFile);
 
+/**
+ * @brief 流式输出，格式与上面的相同
+ *
+ * 逐个从 \p source 拉取词法单元，格式化进一块复用的缓冲区后立即丢弃，缓冲区
+ * 攒满后整块写出。不需要先 fill 整个 CommonTokenStream，内存占用与输入大小无关。
+ */
+void print_tokens_clang(antlr4::TokenSource &source, std::ostream &out);
+
 // for debug
 void print_tokens_antlr(antlr4::CommonTokenStream &tokens, std::ofstream &outFile, const CLexer &lexer);
@@ -1,16 +0,0 @@
-#pragma once
-
-#include <llvm/IR/IRBuilder.h>
-#include <llvm/IR/PassManager.h>
-#include <llvm/Support/raw_ostream.h>
-
-class ConstantFolding : public llvm::PassInfoMixin<ConstantFolding> {
-public:
-  explicit ConstantFolding(llvm::raw_ostream &out) : mOut(out) {}
-
-  llvm::PreservedAnalyses run(llvm::Function &Func,
-                              llvm::FunctionAnalysisManager &FAM);
-
-private:
-  llvm::raw_ostream &mOut;
-};
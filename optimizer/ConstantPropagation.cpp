@@ -0,0 +1,392 @@
+#include "ConstantPropagation.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+using namespace llvm;
+
+namespace {
+
+/// 格中的值，只会沿 Unknown -> Const -> Overdefined 的方向变化
+struct LatticeVal {
+  enum Kind { Unknown, Const, Overdefined } K = Unknown;
+  ConstantInt *C = nullptr;
+};
+
+class Solver {
+public:
+  explicit Solver(Function &Func)
+      : mFunc(Func), mDL(Func.getParent()->getDataLayout()) {}
+
+  /// 从入口开始求不动点
+  void solve();
+
+  bool isExecutable(BasicBlock *BB) const { return mBlocks.count(BB); }
+
+  bool isEdgeFeasible(BasicBlock *From, BasicBlock *To) const {
+    return mEdges.count({From, To});
+  }
+
+  LatticeVal getState(Value *V) const;
+
+private:
+  Function &mFunc;
+  const DataLayout &mDL;
+
+  DenseMap<Value *, LatticeVal> mState;
+  SmallPtrSet<BasicBlock *, 32> mBlocks;
+  DenseSet<std::pair<BasicBlock *, BasicBlock *>> mEdges;
+  SmallVector<BasicBlock *, 32> mBlockWork;
+  SmallVector<Instruction *, 64> mInstWork;
+
+  void markConst(Instruction *I, ConstantInt *C);
+  void markOverdefined(Value *V);
+  void markEdge(BasicBlock *From, BasicBlock *To);
+
+  void visit(Instruction &I);
+  void visitPhi(PHINode &Phi);
+  void visitSelect(SelectInst &Sel);
+  void visitLoad(LoadInst &Load);
+  void visitTerminator(Instruction &Term);
+  void visitFoldable(Instruction &I);
+
+  /// 条件仍未定（只依赖 undef）的分支的各条出边都当作可执行，返回是否有
+  /// 这样的分支
+  bool resolveUndefBranches();
+};
+
+LatticeVal Solver::getState(Value *V) const {
+  if (auto It = mState.find(V); It != mState.end())
+    return It->second;
+
+  // undef 可以取任意值，视为未定；其他常量中只跟踪整数
+  if (isa<UndefValue>(V))
+    return {};
+  if (auto C = dyn_cast<ConstantInt>(V))
+    return {LatticeVal::Const, C};
+  if (isa<Instruction>(V))
+    return {};
+  return {LatticeVal::Overdefined};
+}
+
+void Solver::markConst(Instruction *I, ConstantInt *C) {
+  auto &S = mState[I];
+  if (S.K != LatticeVal::Unknown) {
+    // 同一条指令先后求出不同的常量时降为非常量
+    if (S.K == LatticeVal::Const && S.C != C)
+      markOverdefined(I);
+    return;
+  }
+  S = {LatticeVal::Const, C};
+  for (auto U : I->users())
+    mInstWork.push_back(cast<Instruction>(U));
+}
+
+void Solver::markOverdefined(Value *V) {
+  auto &S = mState[V];
+  if (S.K == LatticeVal::Overdefined)
+    return;
+  S = {LatticeVal::Overdefined};
+  for (auto U : V->users())
+    if (auto I = dyn_cast<Instruction>(U))
+      mInstWork.push_back(I);
+}
+
+void Solver::markEdge(BasicBlock *From, BasicBlock *To) {
+  if (!mEdges.insert({From, To}).second)
+    return;
+
+  if (mBlocks.insert(To).second)
+    mBlockWork.push_back(To);
+  else
+    // 已经求值过的基本块多了一条入边，只需重新合并 phi
+    for (auto &Phi : To->phis())
+      visitPhi(Phi);
+}
+
+void Solver::visit(Instruction &I) {
+  if (auto Phi = dyn_cast<PHINode>(&I))
+    return visitPhi(*Phi);
+  if (auto Sel = dyn_cast<SelectInst>(&I))
+    return visitSelect(*Sel);
+  if (auto Load = dyn_cast<LoadInst>(&I))
+    return visitLoad(*Load);
+  if (I.isTerminator())
+    return visitTerminator(I);
+  if (I.getType()->isIntegerTy() &&
+      (isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<CastInst>(I)))
+    return visitFoldable(I);
+
+  // 调用等指令的结果不作推断
+  if (!I.getType()->isVoidTy())
+    markOverdefined(&I);
+}
+
+void Solver::visitPhi(PHINode &Phi) {
+  if (getState(&Phi).K == LatticeVal::Overdefined)
+    return;
+
+  ConstantInt *C = nullptr;
+  for (unsigned i = 0, n = Phi.getNumIncomingValues(); i < n; ++i) {
+    if (!isEdgeFeasible(Phi.getIncomingBlock(i), Phi.getParent()))
+      continue;
+
+    auto S = getState(Phi.getIncomingValue(i));
+    if (S.K == LatticeVal::Unknown)
+      continue;
+    if (S.K == LatticeVal::Overdefined || (C && C != S.C))
+      return markOverdefined(&Phi);
+    C = S.C;
+  }
+
+  if (C)
+    markConst(&Phi, C);
+}
+
+void Solver::visitSelect(SelectInst &Sel) {
+  if (!Sel.getType()->isIntegerTy())
+    return markOverdefined(&Sel);
+
+  auto Cond = getState(Sel.getCondition());
+  if (Cond.K == LatticeVal::Unknown)
+    return;
+
+  // 条件已定时取相应的一边，否则两边是同一个常量时才是常量
+  auto T = getState(Sel.getTrueValue());
+  auto F = getState(Sel.getFalseValue());
+  if (Cond.K == LatticeVal::Const)
+    T = F = Cond.C->isOne() ? T : F;
+
+  if (T.K == LatticeVal::Overdefined || F.K == LatticeVal::Overdefined ||
+      (T.K == LatticeVal::Const && F.K == LatticeVal::Const && T.C != F.C))
+    return markOverdefined(&Sel);
+  if (T.K == LatticeVal::Const && F.K == LatticeVal::Const)
+    markConst(&Sel, T.C);
+}
+
+void Solver::visitLoad(LoadInst &Load) {
+  // 从 const 全局变量读出的是它的初始值，其他的读取不作推断
+  auto GV = dyn_cast<GlobalVariable>(Load.getPointerOperand());
+  if (GV && GV->isConstant() && GV->hasDefinitiveInitializer() &&
+      !Load.isVolatile())
+    if (auto C = dyn_cast_or_null<ConstantInt>(
+            ConstantFoldLoadFromConstPtr(GV, Load.getType(), mDL)))
+      return markConst(&Load, C);
+  markOverdefined(&Load);
+}
+
+void Solver::visitTerminator(Instruction &Term) {
+  auto BB = Term.getParent();
+
+  if (auto Br = dyn_cast<BranchInst>(&Term); Br && Br->isConditional()) {
+    auto S = getState(Br->getCondition());
+    if (S.K == LatticeVal::Unknown)
+      return;
+    if (S.K == LatticeVal::Const) {
+      // 第一个后继是条件为真时的目标
+      markEdge(BB, Br->getSuccessor(S.C->isZero() ? 1 : 0));
+      return;
+    }
+  }
+
+  if (auto Sw = dyn_cast<SwitchInst>(&Term)) {
+    auto S = getState(Sw->getCondition());
+    if (S.K == LatticeVal::Unknown)
+      return;
+    if (S.K == LatticeVal::Const) {
+      markEdge(BB, Sw->findCaseValue(S.C)->getCaseSuccessor());
+      return;
+    }
+  }
+
+  for (auto Succ : successors(BB))
+    markEdge(BB, Succ);
+}
+
+void Solver::visitFoldable(Instruction &I) {
+  if (getState(&I).K == LatticeVal::Overdefined)
+    return;
+
+  SmallVector<Constant *, 2> Ops;
+  bool Unknown = false, Overdefined = false;
+  for (auto &&Op : I.operands()) {
+    auto S = getState(Op);
+    if (S.K == LatticeVal::Unknown)
+      Unknown = true;
+    else if (S.K == LatticeVal::Overdefined)
+      Overdefined = true;
+    else
+      Ops.push_back(S.C);
+  }
+
+  // x & 0、x * 0 和 x | -1 不论 x 是什么都是常量
+  if (Unknown || Overdefined) {
+    auto Op = I.getOpcode();
+    for (auto C : Ops) {
+      auto CI = cast<ConstantInt>(C);
+      if (((Op == Instruction::And || Op == Instruction::Mul) &&
+           CI->isZero()) ||
+          (Op == Instruction::Or && CI->isMinusOne()))
+        return markConst(&I, CI);
+    }
+  }
+
+  if (Overdefined)
+    return markOverdefined(&I);
+  if (Unknown)
+    return;
+
+  // 除以零、有符号溢出的除法等折叠为 poison，不当作常量
+  Constant *Folded;
+  if (auto Cmp = dyn_cast<CmpInst>(&I))
+    Folded = ConstantFoldCompareInstOperands(Cmp->getPredicate(), Ops[0],
+                                             Ops[1], mDL);
+  else
+    Folded = ConstantFoldInstOperands(&I, Ops, mDL);
+  auto C = dyn_cast_or_null<ConstantInt>(Folded);
+  if (C)
+    markConst(&I, C);
+  else
+    markOverdefined(&I);
+}
+
+bool Solver::resolveUndefBranches() {
+  for (auto &BB : mFunc) {
+    if (!isExecutable(&BB))
+      continue;
+
+    auto Term = BB.getTerminator();
+    Value *Cond = nullptr;
+    if (auto Br = dyn_cast<BranchInst>(Term); Br && Br->isConditional())
+      Cond = Br->getCondition();
+    else if (auto Sw = dyn_cast<SwitchInst>(Term))
+      Cond = Sw->getCondition();
+
+    if (!Cond || getState(Cond).K != LatticeVal::Unknown ||
+        any_of(successors(&BB),
+               [&](BasicBlock *Succ) { return isEdgeFeasible(&BB, Succ); }))
+      continue;
+
+    for (auto Succ : successors(&BB))
+      markEdge(&BB, Succ);
+    return true;
+  }
+  return false;
+}
+
+void Solver::solve() {
+  auto Entry = &mFunc.getEntryBlock();
+  mBlocks.insert(Entry);
+  mBlockWork.push_back(Entry);
+
+  do {
+    while (!mBlockWork.empty() || !mInstWork.empty()) {
+      // 先处理值的变化，再求新变为可执行的基本块
+      while (!mInstWork.empty()) {
+        auto I = mInstWork.pop_back_val();
+        if (isExecutable(I->getParent()))
+          visit(*I);
+      }
+
+      while (!mBlockWork.empty()) {
+        auto BB = mBlockWork.pop_back_val();
+        for (auto &I : *BB)
+          visit(I);
+      }
+    }
+  } while (resolveUndefBranches());
+}
+
+} // namespace
+
+PreservedAnalyses ConstantPropagation::run(Function &Func,
+                                           FunctionAnalysisManager &FAM) {
+  Solver S(Func);
+  S.solve();
+
+  int FoldTimes = 0, BranchTimes = 0;
+
+  for (auto &BB : Func) {
+    if (!S.isExecutable(&BB))
+      continue;
+
+    // 用常量替换求出为常量的值
+    for (auto &I : make_early_inc_range(BB)) {
+      if (I.getType()->isVoidTy() || I.isTerminator())
+        continue;
+      auto V = S.getState(&I);
+      if (V.K != LatticeVal::Const)
+        continue;
+
+      I.replaceAllUsesWith(V.C);
+      if (isInstructionTriviallyDead(&I))
+        I.eraseFromParent();
+      ++FoldTimes;
+    }
+
+    // 只有一条出边可执行的分支改为无条件跳转
+    auto Term = BB.getTerminator();
+    if (Term->getNumSuccessors() < 2 ||
+        !(isa<BranchInst>(Term) || isa<SwitchInst>(Term)))
+      continue;
+
+    BasicBlock *Live = nullptr;
+    bool Single = true;
+    for (auto Succ : successors(&BB)) {
+      if (!S.isEdgeFeasible(&BB, Succ))
+        continue;
+      if (Live && Live != Succ)
+        Single = false;
+      Live = Succ;
+    }
+    if (!Live || !Single)
+      continue;
+
+    // 除了保留的一条边，其他出边对应的 phi 入值都要删去
+    bool Kept = false;
+    for (auto Succ : successors(&BB)) {
+      if (Succ == Live && !Kept)
+        Kept = true;
+      else
+        Succ->removePredecessor(&BB, Succ == Live);
+    }
+
+    Value *Cond = isa<BranchInst>(Term) ? cast<BranchInst>(Term)->getCondition()
+                                        : cast<SwitchInst>(Term)->getCondition();
+    BranchInst::Create(Live, Term);
+    Term->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(Cond);
+    ++BranchTimes;
+  }
+
+  // 删去不可达的基本块，同时删去可达的后继中来自它们的 phi 入值
+  SmallVector<BasicBlock *, 8> DeadBlocks;
+  for (auto &BB : Func)
+    if (!S.isExecutable(&BB))
+      DeadBlocks.push_back(&BB);
+  if (!DeadBlocks.empty())
+    DeleteDeadBlocks(DeadBlocks);
+
+  mOut << "ConstantPropagation running...\nTo fold " << FoldTimes
+       << " instructions and " << BranchTimes << " branches, remove "
+       << DeadBlocks.size() << " unreachable blocks\n";
+
+  if (BranchTimes == 0 && DeadBlocks.empty()) {
+    if (FoldTimes == 0)
+      return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+  }
+  return PreservedAnalyses::none();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/// 稀疏条件常量传播（Sparse Conditional Constant Propagation）。
+///
+/// 在 SSA 值的格（未定 < 常量 < 非常量）上求不动点，同时记录哪些控制流边
+/// 可执行：只有可执行的基本块中的指令才被求值，phi 只合并来自可执行边的入值，
+/// 条件已定的分支只有一条出边可执行。求出后把常量值替换到各个使用处，条件已定
+/// 的分支改为无条件跳转，删去不可达的基本块。
+class ConstantPropagation : public llvm::PassInfoMixin<ConstantPropagation> {
+public:
+  explicit ConstantPropagation(llvm::raw_ostream &out) : mOut(out) {}
+
+  llvm::PreservedAnalyses run(llvm::Function &Func,
+                              llvm::FunctionAnalysisManager &FAM);
+
+private:
+  llvm::raw_ostream &mOut;
+};
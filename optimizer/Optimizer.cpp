@@ -0,0 +1,40 @@
+#include "Optimizer.hpp"
+
+#include <llvm/Passes/PassBuilder.h>
+
+#include "ConstantPropagation.hpp"
+#include "Mem2Reg.hpp"
+#include "StrengthReduction.hpp"
+
+void opt(llvm::Module &mod, llvm::raw_ostream &log,
+         llvm::PassInstrumentationCallbacks *pic, bool promote) {
+  using namespace llvm;
+
+  // 定义分析pass的管理器
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+
+  // 注册分析pass的管理器
+  PassBuilder PB(nullptr, PipelineTuningOptions(), std::nullopt, pic);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  // 定义优化pass的管理器
+  ModulePassManager MPM;
+  FunctionPassManager FPM;
+
+  // 添加优化pass到管理器中
+  if (promote)
+    FPM.addPass(Mem2Reg());
+  FPM.addPass(ConstantPropagation(log));
+  FPM.addPass(StrengthReduction(log));
+
+  // 运行优化pass
+  MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+  MPM.run(mod, MAM);
+}
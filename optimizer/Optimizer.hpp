@@ -0,0 +1,13 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/raw_ostream.h>
+
+/// 在 mod 上原地运行整条优化流水线，optim 和 sysuc 的一体化驱动共用；
+/// 各个 pass 的统计信息写到 log，pic 非空时交给 PassBuilder 以便给各个 pass
+/// 计时（-time-report）；promote 为假时不运行 Mem2Reg，用于前端已直接构造
+/// SSA 的模块
+void opt(llvm::Module &mod, llvm::raw_ostream &log = llvm::errs(),
+         llvm::PassInstrumentationCallbacks *pic = nullptr,
+         bool promote = true);
@@ -3,71 +3,94 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IRReader/IRReader.h>
-#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/raw_ostream.h>
 
-#include "Mem2Reg.hpp"
-#include "ConstantFolding.hpp"
-#include "StrengthReduction.hpp"
+#include "Optimizer.hpp"
+#include "TimeReport.hpp"
 
-void opt(llvm::Module &mod) {
-  using namespace llvm;
+namespace {
 
-  // 定义分析pass的管理器
-  LoopAnalysisManager LAM;
-  FunctionAnalysisManager FAM;
-  CGSCCAnalysisManager CGAM;
-  ModuleAnalysisManager MAM;
+llvm::cl::opt<std::string> optInput(llvm::cl::Positional,
+                                    llvm::cl::desc("<input>"),
+                                    llvm::cl::Required);
+llvm::cl::opt<std::string> optOutput(llvm::cl::Positional,
+                                     llvm::cl::desc("<output>"),
+                                     llvm::cl::Required);
 
-  // 注册分析pass的管理器
-  PassBuilder PB;
-  PB.registerModuleAnalyses(MAM);
-  PB.registerCGSCCAnalyses(CGAM);
-  PB.registerFunctionAnalyses(FAM);
-  PB.registerLoopAnalyses(LAM);
-  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+// 与 sysuc 的同名选项相同，这里只有读入、各个优化 pass 和输出几个阶段
+llvm::cl::opt<bool> optTimeReport(
+    "time-report",
+    llvm::cl::desc("在标准错误上报告各阶段（含每个优化 pass）的墙钟时间、"
+                   "CPU 时间和峰值 RSS"));
 
-  // 定义优化pass的管理器
-  ModulePassManager MPM;
-  FunctionPassManager FPM;
+llvm::cl::opt<std::string> optTimeReportJson(
+    "time-report-json",
+    llvm::cl::desc("把各阶段的用时和内存以 JSON 格式写到指定的文件"),
+    llvm::cl::value_desc("file"));
 
-  // 添加优化pass到管理器中
-  FPM.addPass(Mem2Reg());
-  FPM.addPass(ConstantFolding(errs()));
-  FPM.addPass(StrengthReduction(errs()));
-
-  // 运行优化pass
-  MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
-  MPM.run(mod, MAM);
-}
+} // namespace
 
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
+  llvm::cl::ParseCommandLineOptions(argc, argv, "SYSU 优化器\n");
 
   llvm::LLVMContext ctx;
+  TimeReport report;
 
   llvm::SMDiagnostic err;
-  auto mod = llvm::parseIRFile(argv[1], err, ctx);
+  std::unique_ptr<llvm::Module> mod;
+  {
+    TimeReport::Scope scope(report, "parse");
+    mod = llvm::parseIRFile(optInput, err, ctx);
+  }
   if (!mod) {
-    std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to parse input file: " << optInput << '\n';
     err.print(argv[0], llvm::errs());
     return -2;
   }
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
-  llvm::raw_fd_ostream outFile(outPath, ec);
+  llvm::raw_fd_ostream outFile(optOutput, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << optOutput << '\n';
     return -3;
   }
 
-  opt(*mod); // IR的优化发生在这里
+  // IR的优化发生在这里
+  {
+    llvm::PassInstrumentationCallbacks pic;
+    report.instrument(pic);
+
+    TimeReport::Scope scope(report, "opt");
+    opt(*mod, llvm::errs(), &pic);
+  }
+
+  {
+    TimeReport::Scope scope(report, "print");
+    mod->print(outFile, nullptr, false, true);
+  }
+  bool broken;
+  {
+    TimeReport::Scope scope(report, "verify");
+    broken = llvm::verifyModule(*mod, &llvm::outs());
+  }
+
+  if (optTimeReport)
+    report.print(llvm::errs());
+  if (!optTimeReportJson.empty()) {
+    llvm::raw_fd_ostream jsonFile(optTimeReportJson, ec,
+                                  llvm::sys::fs::OF_Text);
+    if (ec) {
+      std::cout << "Error: unable to open output file: " << optTimeReportJson
+                << '\n';
+      return -3;
+    }
+    llvm::json::OStream json(jsonFile, 2);
+    report.print_json(json);
+    jsonFile << '\n';
+  }
 
-  mod->print(outFile, nullptr, false, true);
-  if (llvm::verifyModule(*mod, &llvm::outs()))
-    return 3;
+  return broken ? 3 : 0;
 }
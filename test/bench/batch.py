@@ -0,0 +1,107 @@
+"""比较逐个进程编译与批量模式（`sysuc -batch`）在不同线程数下的吞吐量。
+
+先对每个测例单独启动一次 `sysuc -emit=...`，作为基准；再以 `-j=1, 2, 4, ...`
+直到 CPU 核数运行批量模式，从输出目录的 summary.json 读出用时和失败数。输出
+每种方式的总耗时、每秒文件数和相对基准的加速比。任何一种方式有测例失败时
+视为错误。
+"""
+
+import sys
+import os
+import os.path as osp
+import time
+import json
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("批量编译吞吐量测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("--emit", default="obj", help="sysuc 的 -emit 选项")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    files = len(cases_helper.cases)
+    rows = []
+    failures = []
+
+    print("逐个进程编译...", end="", flush=True)
+    begin = time.perf_counter()
+    for case in cases_helper.cases:
+        out = cases_helper.of_case_bindir("batch.out", case, True)
+        proc = subps.run(
+            [args.sysuc, f"-emit={args.emit}", cases_helper.of_srcdir(case.name), out],
+            stdout=subps.DEVNULL,
+            stderr=subps.DEVNULL,
+        )
+        if proc.returncode != 0:
+            failures.append(f"process: {case.name}")
+    rows.append(("process", time.perf_counter() - begin))
+    print("完成")
+
+    # 批量模式的列表只需要测例名，路径相对于 -batch-root
+    list_path = cases_helper.of_bindir("batch.txt", True)
+    with open(list_path, "w", encoding="utf-8") as f:
+        for case in cases_helper.cases:
+            print(case.name, file=f)
+
+    jobs = 1
+    while True:
+        print(f"批量模式 -j={jobs}...", end="", flush=True)
+        outdir = cases_helper.of_bindir(f"batch-j{jobs}", True)
+        subps.run(
+            [
+                args.sysuc,
+                "-batch",
+                f"-emit={args.emit}",
+                f"-batch-root={args.srcdir}",
+                f"-j={jobs}",
+                list_path,
+                outdir,
+            ],
+            stdout=subps.DEVNULL,
+            stderr=subps.DEVNULL,
+        )
+        with open(osp.join(outdir, "summary.json"), "r", encoding="utf-8") as f:
+            summary = json.load(f)
+        for result in summary["results"]:
+            if result["status"] != 0:
+                failures.append(f"-j={jobs}: {result['input']}: {result.get('error', '')}")
+        rows.append((f"-j={jobs}", summary["seconds"]))
+        print("完成")
+
+        if jobs >= (os.cpu_count() or 1):
+            break
+        jobs = min(jobs * 2, os.cpu_count() or 1)
+
+    base = rows[0][1]
+    lines = [f"{'mode':<10} {'seconds':>10} {'files/s':>10} {'speedup':>10}"]
+    for mode, secs in rows:
+        lines.append(f"{mode:<10} {secs:>10.3f} {files / secs:>10.1f} {base / secs:>9.2f}x")
+    report = "\n".join(lines)
+
+    print()
+    print(report)
+    with open(cases_helper.of_bindir("batch-report.txt", True), "w", encoding="utf-8") as f:
+        f.write(report + "\n")
+
+    if failures:
+        print("\n以下测例编译失败：")
+        for name in failures:
+            print(" ", name)
+        sys.exit(1)
@@ -0,0 +1,265 @@
+"""编译器自身的编译时间测试：测例集加上按规模 N 生成的合成输入。
+
+对每个输入以 `sysuc -emit=... -time-report-json=...` 编译，重复若干次取最快的
+一次，记录各阶段（lex、parse、Ast2Asg、gc、Typing、EmitIR、verify、每个优化
+pass 等）的墙钟时间和进程的峰值内存（RSS）。
+
+合成输入模仿测例中的几类极端情形，各取 N = base, 2base, 4base, ...：
+
+  params      N 个参数的函数，参数都参与除法运算（integer-divide-optimization）
+  nested-if   N 层嵌套的 if（if-combine）
+  add-chain   N 项的 + 长链（hoist）
+  cond-chain  if 和 while 条件中 N 项的 &&、|| 长链（EmitIR::cond_br）
+  global-arr  N 个元素的全局数组初始化（fft）
+
+对每个族按最大的两个 N 估计各阶段用时的增长指数 log(t2 / t1) / log(N2 / N1)，
+超过 --max-exponent 时报告超线性增长，用来发现 Type::Cache、Symtbl 或优化器中
+的平方级行为。
+
+结果写到输出目录的 compile.json 和 compile.txt。给出 --baseline 时与其中的
+结果比较：用时或峰值内存比基准多出 --tolerance 倍以上（且用时至少多出
+--min-ms 毫秒）时报告退化；基准文件不存在时把本次结果存为基准，
+--update-baseline 时总是覆盖。有编译失败、退化或超线性增长时以 1 退出。
+"""
+
+import sys
+import os
+import os.path as osp
+import math
+import json
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+
+def gen_params(n: int) -> str:
+    params = ", ".join(f"int a{i}" for i in range(n))
+    body = " + ".join(f"a{i} / {i % 7 + 2}" for i in range(n))
+    args = ", ".join(str(i) for i in range(n))
+    return f"int f({params})\n{{\n  return {body};\n}}\n\nint main()\n{{\n  return f({args});\n}}\n"
+
+
+def gen_nested_if(n: int) -> str:
+    lines = ["int main()", "{", "  int x = 7;", "  int s = 0;"]
+    for i in range(n):
+        lines.append(f"  if (x > {i % 13}) {{")
+        lines.append(f"  s = s + {i};")
+    lines.extend(["  }"] * n)
+    lines.extend(["  return s;", "}", ""])
+    return "\n".join(lines)
+
+
+def gen_add_chain(n: int) -> str:
+    terms = " + ".join(f"a" if i % 2 == 0 else str(i) for i in range(n))
+    return f"int main()\n{{\n  int a = 1;\n  return {terms};\n}}\n"
+
+
+def gen_cond_chain(n: int) -> str:
+    terms = "".join(f" {'&&' if i % 3 else '||'} {'!' if i % 5 == 0 else ''}(a > {i % 11})" for i in range(1, n))
+    return (
+        f"int main()\n{{\n  int a = 5;\n  int s = 0;\n"
+        f"  if (a{terms}) s = 1;\n"
+        f"  while (s < 3 && (a{terms})) s = s + 1;\n"
+        f"  return s;\n}}\n"
+    )
+
+
+def gen_global_arr(n: int) -> str:
+    elems = ", ".join(str(i % 1000) for i in range(n))
+    return f"int g[{n}] = {{{elems}}};\n\nint main()\n{{\n  return g[{n - 1}];\n}}\n"
+
+
+FAMILIES = {
+    "params": (gen_params, 100),
+    "nested-if": (gen_nested_if, 50),
+    "add-chain": (gen_add_chain, 500),
+    "cond-chain": (gen_cond_chain, 500),
+    "global-arr": (gen_global_arr, 2000),
+}
+
+
+def run(sysuc: str, extra: list[str], src: str, out: str, repeat: int) -> dict[str, float]:
+    """返回最快一次的各阶段用时（毫秒），另有 total 和 peak_mib 两项；失败时返回 None"""
+    report = out + ".time.json"
+    best = None
+    for _ in range(repeat):
+        proc = subps.Popen(
+            [sysuc, *extra, f"-time-report-json={report}", src, out],
+            stdout=subps.DEVNULL,
+            stderr=subps.DEVNULL,
+        )
+        _, status, rusage = os.wait4(proc.pid, 0)
+        if os.waitstatus_to_exitcode(status) != 0:
+            return None
+
+        with open(report, "r", encoding="utf-8") as f:
+            data = json.load(f)
+        phases = {}
+        for phase in data["phases"]:
+            # 各次垃圾回收合为一项，优化 pass 加上 opt: 前缀
+            name = phase["name"]
+            if phase["depth"] > 0:
+                name = "opt:" + name
+            elif name.startswith("gc #"):
+                name = "gc"
+            phases[name] = phases.get(name, 0.0) + phase["wall_ms"]
+        phases["total"] = data["total_ms"]
+        phases["peak_mib"] = rusage.ru_maxrss / 1024
+
+        if best is None or phases["total"] < best["total"]:
+            best = phases
+    return best
+
+
+def exponent(n1: int, t1: float, n2: int, t2: float) -> float:
+    return math.log(t2 / t1) / math.log(n2 / n1)
+
+
+def compare(results: dict, baseline: dict, tolerance: float, min_ms: float) -> list[str]:
+    """返回相对基准退化的条目"""
+    ret = []
+    for group in ("corpus", "scaling"):
+        for key, phases in results.get(group, {}).items():
+            base = baseline.get(group, {}).get(key)
+            if base is None:
+                continue
+            for name, cur in phases.items():
+                old = base.get(name)
+                if old is None or cur <= old * (1 + tolerance):
+                    continue
+                if name != "peak_mib" and cur - old < min_ms:
+                    continue
+                unit = "MiB" if name == "peak_mib" else "ms"
+                ret.append(f"{key} {name}: {old:.3f} -> {cur:.3f} {unit}")
+    return ret
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("编译时间测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("--emit", default="llvm", help="sysuc 的 -emit 选项")
+    parser.add_argument("--sysuc-args", default="", help="传给 sysuc 的其他选项，以空格分隔")
+    parser.add_argument("--repeat", type=int, default=3, help="每个输入编译的次数，取最快的一次")
+    parser.add_argument("--steps", type=int, default=5, help="每族合成输入的规模个数")
+    parser.add_argument("--scale", type=float, default=1.0, help="合成输入的规模倍数")
+    parser.add_argument("--max-exponent", type=float, default=1.5, help="允许的最大增长指数")
+    parser.add_argument("--min-ms", type=float, default=5.0, help="估计增长指数和判断退化时忽略短于此的用时")
+    parser.add_argument("--baseline", default="", help="基准结果的路径")
+    parser.add_argument("--tolerance", type=float, default=0.25, help="允许比基准多出的比例")
+    parser.add_argument("--update-baseline", action="store_true", help="用本次结果覆盖基准")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    extra = [f"-emit={args.emit}", *args.sysuc_args.split()]
+    results = {"corpus": {}, "scaling": {}}
+    failures = []
+
+    for case in cases_helper.cases:
+        print(case.name, end=" ... ", flush=True)
+        src = cases_helper.of_srcdir(case.name)
+        out = cases_helper.of_case_bindir("compile.out", case, True)
+        phases = run(args.sysuc, extra, src, out, args.repeat)
+        if phases is None:
+            failures.append(case.name)
+            print("失败")
+        else:
+            results["corpus"][case.name] = phases
+            print(f"{phases['total']:.3f} ms")
+
+    lines = []
+    superlinear = []
+    for family, (gen, base) in FAMILIES.items():
+        rows = []
+        for step in range(args.steps):
+            n = max(1, int(base * args.scale)) << step
+            key = f"{family}-{n}"
+            print(key, end=" ... ", flush=True)
+            src = cases_helper.of_bindir(f"compile/{key}.sysu.c", True)
+            with open(src, "w", encoding="utf-8") as f:
+                f.write(gen(n))
+            phases = run(args.sysuc, extra, src, src + ".out", args.repeat)
+            if phases is None:
+                failures.append(key)
+                print("失败")
+                continue
+            results["scaling"][key] = phases
+            rows.append((n, phases))
+            print(f"{phases['total']:.3f} ms")
+
+        if not rows:
+            continue
+        names = [i for i in rows[-1][1] if i not in ("total", "peak_mib")]
+        lines.append(f"{family}:")
+        lines.append(f"  {'N':>8} {'total ms':>10} {'peak MiB':>10}  " + " ".join(f"{i:>10}" for i in names))
+        for n, phases in rows:
+            lines.append(
+                f"  {n:>8} {phases['total']:>10.3f} {phases['peak_mib']:>10.1f}  "
+                + " ".join(f"{phases.get(i, 0.0):>10.3f}" for i in names)
+            )
+
+        if len(rows) >= 2:
+            (n1, p1), (n2, p2) = rows[-2], rows[-1]
+            exps = []
+            for name in ["total", *names]:
+                t1, t2 = p1.get(name, 0.0), p2.get(name, 0.0)
+                if t1 <= 0 or t2 < args.min_ms:
+                    continue
+                e = exponent(n1, t1, n2, t2)
+                exps.append(f"{name} {e:.2f}")
+                if e > args.max_exponent:
+                    superlinear.append(f"{family} {name}: N {n1} -> {n2}, {t1:.3f} -> {t2:.3f} ms, 指数 {e:.2f}")
+            lines.append("  增长指数：" + ("，".join(exps) if exps else "用时过短，未估计"))
+
+    corpus_total = {}
+    for phases in results["corpus"].values():
+        for name, ms in phases.items():
+            if name != "peak_mib":
+                corpus_total[name] = corpus_total.get(name, 0.0) + ms
+    peak = max((i["peak_mib"] for i in results["corpus"].values()), default=0.0)
+    lines.insert(0, f"测例集（{len(results['corpus'])} 个），最大峰值内存 {peak:.1f} MiB：")
+    for i, (name, ms) in enumerate(sorted(corpus_total.items(), key=lambda x: -x[1])):
+        lines.insert(i + 1, f"  {name:<24} {ms:>10.3f} ms")
+
+    regressions = []
+    if args.baseline:
+        if osp.exists(args.baseline) and not args.update_baseline:
+            with open(args.baseline, "r", encoding="utf-8") as f:
+                regressions = compare(results, json.load(f), args.tolerance, args.min_ms)
+            lines.append(f"与基准 {args.baseline} 比较：{len(regressions)} 项退化")
+        else:
+            with open(args.baseline, "w", encoding="utf-8") as f:
+                json.dump(results, f, indent=2)
+            lines.append(f"已把本次结果存为基准 {args.baseline}")
+
+    report = "\n".join(lines)
+    print()
+    print(report)
+    with open(cases_helper.of_bindir("compile.txt", True), "w", encoding="utf-8") as f:
+        f.write(report + "\n")
+    with open(cases_helper.of_bindir("compile.json", True), "w", encoding="utf-8") as f:
+        json.dump(results, f, indent=2)
+
+    for title, items in (
+        ("以下输入编译失败：", failures),
+        ("以下阶段的用时超线性增长：", superlinear),
+        ("以下条目相对基准退化：", regressions),
+    ):
+        if items:
+            print("\n" + title)
+            for i in items:
+                print(" ", i)
+    if failures or superlinear or regressions:
+        sys.exit(1)
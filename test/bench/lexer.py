@@ -0,0 +1,101 @@
+"""在预处理后的测例上比较 CLexer 与 FastLexer 的吞吐量。
+
+对每个测例分别以 `-lexer=antlr` 和 `-lexer=fast` 调用 `sysuc -lex-bench=N`，
+汇总字节数、词法单元数和耗时，输出两者的 MB/s 与加速比。
+
+计时前先以 `-task=1` 分别输出两个词法分析器的词法单元（种类、文本、标志、
+文件、行号和列号），两份输出必须逐行相同；遇到第一处不同即打印该行并以 1
+退出。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+LEXERS = ["antlr", "fast"]
+
+
+def bench(sysuc: str, lexer: str, path: str, repeat: int) -> tuple[int, int, float]:
+    """返回 (字节数, 词法单元数, 秒数)"""
+    out = subps.run(
+        [sysuc, f"-lexer={lexer}", f"-lex-bench={repeat}", path, os.devnull],
+        stdout=subps.PIPE,
+        stderr=subps.DEVNULL,
+        check=True,
+        text=True,
+    ).stdout.split()
+    return int(out[0]), int(out[1]), float(out[2])
+
+
+def dump(sysuc: str, lexer: str, path: str, out: str) -> list[str]:
+    """返回实验一输出的各行"""
+    subps.run(
+        [sysuc, "-task=1", f"-lexer={lexer}", path, out],
+        stdout=subps.DEVNULL,
+        check=True,
+    )
+    with open(out, "r", encoding="utf-8") as f:
+        return f.read().splitlines()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("词法分析吞吐量测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("--repeat", type=int, default=20, help="每个测例重复的次数")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    totals = {lexer: [0, 0, 0.0] for lexer in LEXERS}
+    for case in cases_helper.cases:
+        path = cases_helper.of_srcdir(case.name)
+        print(case.name, end=" ... ", flush=True)
+
+        dumps = {
+            lexer: dump(args.sysuc, lexer, path, cases_helper.of_case_bindir(f"{lexer}.tokens", case, True))
+            for lexer in LEXERS
+        }
+        expected, actual = dumps["antlr"], dumps["fast"]
+        for lineno in range(max(len(expected), len(actual))):
+            want = expected[lineno] if lineno < len(expected) else "<无>"
+            got = actual[lineno] if lineno < len(actual) else "<无>"
+            if want != got:
+                print("词法单元不一致")
+                print(f"\n第 {lineno + 1} 行：")
+                print(f"  antlr: {want}")
+                print(f"  fast:  {got}")
+                sys.exit(1)
+
+        results = {lexer: bench(args.sysuc, lexer, path, args.repeat) for lexer in LEXERS}
+        for lexer, result in results.items():
+            for i, v in enumerate(result):
+                totals[lexer][i] += v
+        print("OK")
+
+    lines = [f"{'lexer':<8} {'bytes':>14} {'tokens':>12} {'seconds':>10} {'MB/s':>10}"]
+    for lexer, (nbytes, ntokens, secs) in totals.items():
+        mbps = nbytes / secs / 1e6 if secs > 0 else float("inf")
+        lines.append(f"{lexer:<8} {nbytes:>14} {ntokens:>12} {secs:>10.3f} {mbps:>10.2f}")
+    if totals["fast"][2] > 0:
+        lines.append(f"加速比：{totals['antlr'][2] / totals['fast'][2]:.2f}x")
+    report = "\n".join(lines)
+
+    print()
+    print(report)
+    with open(cases_helper.of_bindir("lexer.txt", True), "w", encoding="utf-8") as f:
+        f.write(report + "\n")
@@ -0,0 +1,90 @@
+"""在预处理后的测例上比较 ANTLR 语法分析（CParser + Ast2Asg）与手写的 Tok2Asg。
+
+对每个测例分别以 `-parser=antlr` 和 `-parser=direct` 运行实验二，记录墙钟时间
+和进程的峰值内存（RSS），输出两者的总耗时、最大峰值内存与加速比。两者输出的
+ASG 不一致时视为错误。
+"""
+
+import sys
+import os
+import os.path as osp
+import time
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+PARSERS = ["antlr", "direct"]
+
+
+def run(sysuc: str, parser: str, lexer: str, src: str, out: str) -> tuple[float, int]:
+    """返回 (秒数, 峰值内存字节数)"""
+    begin = time.perf_counter()
+    proc = subps.Popen(
+        [sysuc, "-task=2", f"-parser={parser}", f"-lexer={lexer}", src, out],
+        stdout=subps.DEVNULL,
+        stderr=subps.DEVNULL,
+    )
+    _, status, rusage = os.wait4(proc.pid, 0)
+    secs = time.perf_counter() - begin
+    if os.waitstatus_to_exitcode(status) != 0:
+        raise RuntimeError(f"{parser} 解析 {src} 失败")
+    return secs, rusage.ru_maxrss * 1024
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("语法分析性能测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("--lexer", default="antlr", help="使用的词法分析器")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    secs = {p: 0.0 for p in PARSERS}
+    peak = {p: 0 for p in PARSERS}
+    mismatches = []
+    for case in cases_helper.cases:
+        src = cases_helper.of_srcdir(case.name)
+        print(case.name, end=" ... ", flush=True)
+        outputs = {}
+        for p in PARSERS:
+            out = cases_helper.of_case_bindir(f"{p}.json", case, True)
+            s, m = run(args.sysuc, p, args.lexer, src, out)
+            secs[p] += s
+            peak[p] = max(peak[p], m)
+            with open(out, "rb") as f:
+                outputs[p] = f.read()
+        if len(set(outputs.values())) != 1:
+            mismatches.append(case.name)
+            print("ASG 不一致")
+        else:
+            print("OK")
+
+    lines = [f"{'parser':<8} {'seconds':>10} {'peak MiB':>10}"]
+    for p in PARSERS:
+        lines.append(f"{p:<8} {secs[p]:>10.3f} {peak[p] / 2**20:>10.2f}")
+    if secs["direct"] > 0:
+        lines.append(f"加速比：{secs['antlr'] / secs['direct']:.2f}x")
+    report = "\n".join(lines)
+
+    print()
+    print(report)
+    with open(cases_helper.of_bindir("parser.txt", True), "w", encoding="utf-8") as f:
+        f.write(report + "\n")
+
+    if mismatches:
+        print("\n以下测例两种解析方式得到的 ASG 不一致：")
+        for name in mismatches:
+            print(" ", name)
+        sys.exit(1)
@@ -0,0 +1,81 @@
+"""检查二进制 ASG 格式的往返一致性。
+
+对每个 functional 测例：先以 `-asg-format=json` 和 `-asg-format=bin` 分别运行
+实验二得到 JSON 和二进制 ASG，再把二进制 ASG 作为实验二的输入重新输出 JSON，
+两份 JSON 必须逐字节相同。同时统计两种格式的总大小和读回二进制 ASG 的耗时。
+"""
+
+import sys
+import os.path as osp
+import time
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+
+def run(sysuc: str, *args: str) -> float:
+    """返回秒数"""
+    begin = time.perf_counter()
+    subps.run([sysuc, "-task=2", *args], stdout=subps.DEVNULL, check=True)
+    return time.perf_counter() - begin
+
+
+def read(path: str) -> bytes:
+    with open(path, "rb") as f:
+        return f.read()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("二进制 ASG 往返测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    json_bytes = bin_bytes = 0
+    load_secs = 0.0
+    mismatches = []
+    for case in cases_helper.cases:
+        if not case.name.startswith("functional"):
+            continue
+        src = cases_helper.of_srcdir(case.name)
+        out_json = cases_helper.of_case_bindir("roundtrip.json", case, True)
+        out_bin = cases_helper.of_case_bindir("roundtrip.asg", case, True)
+        out_back = cases_helper.of_case_bindir("roundtrip.back.json", case, True)
+        print(case.name, end=" ... ", flush=True)
+
+        run(args.sysuc, src, out_json)
+        run(args.sysuc, "-asg-format=bin", src, out_bin)
+        load_secs += run(args.sysuc, out_bin, out_back)
+
+        expected = read(out_json)
+        json_bytes += len(expected)
+        bin_bytes += len(read(out_bin))
+        if read(out_back) != expected:
+            mismatches.append(case.name)
+            print("不一致")
+        else:
+            print("OK")
+
+    print()
+    print(f"JSON 总大小：{json_bytes / 2**10:.1f} KiB")
+    print(f"二进制总大小：{bin_bytes / 2**10:.1f} KiB")
+    print(f"读回二进制 ASG 的总耗时：{load_secs:.3f} 秒")
+
+    if mismatches:
+        print("\n以下测例经二进制格式往返后 ASG 不一致：")
+        for name in mismatches:
+            print(" ", name)
+        sys.exit(1)
@@ -0,0 +1,97 @@
+"""检查 IR 缓存（-ir-cache）的输出与不用缓存时逐字节相同。
+
+从测例表中均匀抽取若干测例，每个测例以 `-emit=llvm` 编译三次：不用缓存、用一个
+空的缓存目录（冷）、再用同一个目录（热）。三份 .ll 必须逐字节相同；冷编译时每
+个函数都未命中，热编译时每个函数都命中。
+"""
+
+import re
+import sys
+import shutil
+import os.path as osp
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+
+STATS_RE = re.compile(r"IR 缓存：命中 (\d+)，未命中 (\d+)")
+
+
+def emit(sysuc: str, src: str, out: str, *args: str) -> tuple[int, int]:
+    """返回缓存的命中数和未命中数，不用缓存时为 (0, 0)"""
+    proc = subps.run(
+        [sysuc, "-emit=llvm", *args, src, out],
+        stdout=subps.DEVNULL,
+        stderr=subps.PIPE,
+        encoding="utf-8",
+        check=True,
+    )
+    m = STATS_RE.search(proc.stderr)
+    return (int(m[1]), int(m[2])) if m else (0, 0)
+
+
+def read(path: str) -> bytes:
+    with open(path, "rb") as f:
+        return f.read()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("IR 缓存测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("--count", type=int, default=12, help="抽取的测例数")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    cases = cases_helper.cases
+    cases = cases[:: max(1, len(cases) // args.count)][: args.count]
+
+    failures = []
+    for case in cases:
+        src = cases_helper.of_srcdir(case.name)
+        cache_dir = cases_helper.of_case_bindir("ircache", case, True)
+        outs = [
+            cases_helper.of_case_bindir(f"ircache.{i}.ll", case, True)
+            for i in ("fresh", "cold", "warm")
+        ]
+        print(case.name, end=" ... ", flush=True)
+
+        shutil.rmtree(cache_dir, ignore_errors=True)
+        emit(args.sysuc, src, outs[0])
+        cold = emit(args.sysuc, src, outs[1], f"-ir-cache={cache_dir}")
+        warm = emit(args.sysuc, src, outs[2], f"-ir-cache={cache_dir}")
+
+        problems = []
+        expected = read(outs[0])
+        if read(outs[1]) != expected:
+            problems.append("冷缓存的输出不同")
+        if read(outs[2]) != expected:
+            problems.append("热缓存的输出不同")
+        funcs = cold[1]
+        if cold != (0, funcs) or funcs == 0:
+            problems.append(f"冷缓存命中 {cold[0]}，未命中 {cold[1]}")
+        if warm != (funcs, 0):
+            problems.append(f"热缓存命中 {warm[0]}，未命中 {warm[1]}，预期 {funcs}/0")
+
+        if problems:
+            failures.append(case.name)
+            print("；".join(problems))
+        else:
+            print(f"OK（{funcs} 个函数）")
+
+    if failures:
+        print("\n以下测例使用缓存后结果错误：")
+        for name in failures:
+            print(" ", name)
+        sys.exit(1)
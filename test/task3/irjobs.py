@@ -0,0 +1,82 @@
+"""检查并行发射函数体（-ir-jobs）的结果。
+
+分片有自己的 LLVMContext，不能使用主模块中的常量。下面的程序在函数体中用 const
+全局变量初始化局部数组，分别以 `-ir-jobs=1` 和 `-ir-jobs=2` 编译、链接并运行，
+返回值都必须等于预期值。
+"""
+
+import sys
+import os.path as osp
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+# (名字, 源码, 预期的返回值)
+PROGRAMS = [
+    (
+        "const-global-array-init",
+        """
+const int N = 3;
+const int M[2] = {N + 1, N * 2};
+
+int f() {
+  int a[2] = {N, N + 1};
+  return a[0] + a[1];
+}
+
+int g() {
+  int b[3][2] = {{M[0], N}, {N}};
+  return b[0][0] + b[0][1] + b[1][0] + b[2][1];
+}
+
+int h(int x) {
+  int c[4] = {x, N};
+  return c[0] + c[1] + c[3];
+}
+
+int main() {
+  return f() + g() + h(1);
+}
+""",
+        7 + 10 + 4,
+    ),
+]
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("并行发射测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("clang", help="clang 程序路径")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    failures = []
+    for name, src, expected in PROGRAMS:
+        src_path = osp.join(args.bindir, f"{name}.sysu.c")
+        with open(src_path, "w", encoding="utf-8") as f:
+            f.write(src)
+        for jobs in (1, 2):
+            print(f"{name} -ir-jobs={jobs}", end=" ... ", flush=True)
+            ll_path = osp.join(args.bindir, f"{name}.j{jobs}.ll")
+            exe_path = osp.join(args.bindir, f"{name}.j{jobs}.exe")
+            subps.run(
+                [args.sysuc, "-emit=llvm", "-O0", f"-ir-jobs={jobs}", src_path, ll_path],
+                stdout=subps.DEVNULL,
+                check=True,
+            )
+            subps.run([args.clang, "-o", exe_path, ll_path], check=True)
+            retn = subps.run([exe_path]).returncode
+            if retn != expected:
+                failures.append(f"{name} -ir-jobs={jobs}")
+                print(f"返回 {retn}，预期 {expected}")
+            else:
+                print("OK")
+
+    if failures:
+        print("\n以下程序的结果错误：")
+        for name in failures:
+            print(" ", name)
+        sys.exit(1)
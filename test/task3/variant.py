@@ -0,0 +1,113 @@
+"""以给定的选项运行一体化驱动，检查全部测例的运行结果。
+
+每个测例用 `sysuc -emit=llvm <选项>` 编译，与运行时库链接后运行，标准输出和返回
+值必须与实验三的标准答案相同（先构建 task3-answer）。用于检查实验三的评测没有
+覆盖的编译路径，如另一个语法分析器或直接构造 SSA。
+"""
+
+import re
+import sys
+import os.path as osp
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import CasesHelper, print_parsed_args
+from score import TIME_OUT
+
+
+class Error(Exception):
+    pass
+
+
+def run_one(args, cases_helper: CasesHelper, case: CasesHelper.Case):
+    src = osp.join(args.task0dir, case.name)
+    ll_path = cases_helper.of_case_bindir(f"{args.name}.ll", case, True)
+    exe_path = cases_helper.of_case_bindir(f"{args.name}.exe", case)
+
+    answer_out_path = cases_helper.of_case_bindir("answer.out", case)
+    answer_err_path = cases_helper.of_case_bindir("answer.err", case)
+    if not osp.exists(answer_out_path) or not osp.exists(answer_err_path):
+        raise Error("没有可参考的标准答案")
+
+    proc = subps.run(
+        [args.sysuc, "-emit=llvm", *args.options, src, ll_path],
+        stdout=subps.PIPE,
+        stderr=subps.DEVNULL,
+        encoding="utf-8",
+    )
+    if proc.returncode != 0:
+        raise Error(f"编译失败：{proc.stdout.strip()}")
+
+    proc = subps.run(
+        [args.clang, "-o", exe_path, "-O0", args.rtlib, ll_path],
+        stdout=subps.DEVNULL,
+        stderr=subps.DEVNULL,
+        timeout=TIME_OUT,
+    )
+    if proc.returncode != 0:
+        raise Error("编译输出结果时出错")
+
+    _, input_fp = cases_helper.open_case_input(case)
+    try:
+        proc = subps.run(
+            [exe_path],
+            stdin=input_fp,
+            stdout=subps.PIPE,
+            stderr=subps.DEVNULL,
+            encoding="utf-8",
+            timeout=TIME_OUT,
+        )
+    except subps.TimeoutExpired:
+        raise Error("运行输出结果超时")
+    finally:
+        if input_fp:
+            input_fp.close()
+
+    with open(answer_out_path, "r", encoding="utf-8") as f:
+        answer_out = f.read()
+    with open(answer_err_path, "r", encoding="utf-8") as f:
+        answer_ret = int(re.findall(r"Return Code: (-?\d+)", f.read())[-1])
+    if proc.stdout != answer_out:
+        raise Error("输出不匹配")
+    if proc.returncode != answer_ret:
+        raise Error(f"返回值不匹配：{proc.returncode}，预期 {answer_ret}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验三编译路径测试", description=__doc__)
+    parser.add_argument("srcdir", help="测例目录")
+    parser.add_argument("task0dir", help="预处理后的测例目录（实验零的输出目录）")
+    parser.add_argument("bindir", help="输出目录（实验三的输出目录）")
+    parser.add_argument("cases_file", help="测例表路径")
+    parser.add_argument("sysuc", help="sysuc 程序路径")
+    parser.add_argument("clang", help="编译器路径")
+    parser.add_argument("rtlib", help="运行时库路径")
+    parser.add_argument("name", help="变体名，用作输出文件名")
+    parser.add_argument("options", nargs=argparse.REMAINDER, help="sysuc 的选项")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    print("加载测例表...", end="", flush=True)
+    cases_helper = CasesHelper.load_file(
+        args.srcdir,
+        args.bindir,
+        args.cases_file,
+    )
+    print("完成")
+
+    failures = []
+    for case in cases_helper.cases:
+        print(case.name, end=" ... ", flush=True)
+        try:
+            run_one(args, cases_helper, case)
+            print("OK")
+        except Error as e:
+            failures.append(case.name)
+            print(e)
+
+    if failures:
+        print(f"\n以下测例在 {' '.join(args.options)} 下结果错误：")
+        for name in failures:
+            print(" ", name)
+        sys.exit(1)